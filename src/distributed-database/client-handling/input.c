@@ -172,74 +172,178 @@ static QueryTypes parseQueryTypes(cJSON *operationJson) {
     return queryTypes;
 }
 
-static Condition parseOneArgCondition(cJSON *conditionJson) {
+static void freeConditionTree(Condition condition) {
+    if (condition == NULL) {
+        return;
+    }
+
+    switch (condition->type) {
+        case AND:
+        case OR:
+            freeConditionTree(condition->value.binary.left);
+            freeConditionTree(condition->value.binary.right);
+            break;
+        case NOT:
+            free(condition->value.oneArg.op1);
+            freeConditionTree(condition->value.oneArg.child);
+            break;
+        case BETWEEN:
+            free(condition->value.between.op1);
+            free(condition->value.between.op2);
+            free(condition->value.between.op3);
+            break;
+        default:
+            free(condition->value.twoArg.op1);
+            free(condition->value.twoArg.op2);
+    }
+
+    free(condition);
+}
+
+static Operand parseAttributeOperand(cJSON *conditionJson) {
     cJSON *op1 = cJSON_GetObjectItemCaseSensitive(conditionJson, "op1");
     if (!cJSON_IsString(op1)) {
         return NULL;
     }
 
+    Operand operand = malloc(sizeof(struct Operand));
+    assert(operand != NULL);
+
+    operand->type = ATTR;
+    operand->value.strOp = strdup(op1->valuestring);
+
+    return operand;
+}
+
+static Condition parseConditionJson(cJSON *conditionJson, unsigned depth);
+
+static Condition parseOneArgCondition(cJSON *conditionJson, unsigned depth) {
     Condition condition = malloc(sizeof(struct Condition));
     assert(condition != NULL);
 
-    condition->value.oneArg.op1->type = ATTR;
-    condition->value.oneArg.op1->value.strOp = strdup(op1->valuestring);
+    condition->type = NOT;
+    condition->value.oneArg.op1 = NULL;
+    condition->value.oneArg.child = NULL;
+
+    // NOT negates either a nested condition or a boolean attribute
+    cJSON *child = cJSON_GetObjectItemCaseSensitive(conditionJson, "condition");
+    if (child != NULL) {
+        condition->value.oneArg.child = parseConditionJson(child, depth + 1);
+    } else {
+        condition->value.oneArg.op1 = parseAttributeOperand(conditionJson);
+    }
+
+    if (condition->value.oneArg.op1 == NULL &&
+        condition->value.oneArg.child == NULL) {
+        free(condition);
+        return NULL;
+    }
 
     return condition;
 }
 
-static Condition parseTwoArgCondition(cJSON *conditionJson) {
-    cJSON *op1 = cJSON_GetObjectItemCaseSensitive(conditionJson, "op1");
-    if (!cJSON_IsString(op1)) {
+static Condition parseTwoArgCondition(cJSON *conditionJson,
+                                      ConditionType type) {
+    Operand op1Operand = parseAttributeOperand(conditionJson);
+    if (op1Operand == NULL) {
         return NULL;
     }
     cJSON *op2 = cJSON_GetObjectItemCaseSensitive(conditionJson, "op2");
     Operand op2Operand = parseOperand(op2);
     if (op2Operand == NULL) {
+        free(op1Operand);
         return NULL;
     }
 
     Condition condition = malloc(sizeof(struct Condition));
     assert(condition != NULL);
 
-    condition->value.twoArg.op1->type = ATTR;
-    condition->value.twoArg.op1->value.strOp = strdup(op1->valuestring);
+    condition->type = type;
+    condition->value.twoArg.op1 = op1Operand;
     condition->value.twoArg.op2 = op2Operand;
 
     return condition;
 }
 
 static Condition parseThreeArgCondition(cJSON *conditionJson) {
-    cJSON *op1 = cJSON_GetObjectItemCaseSensitive(conditionJson, "op1");
-    if (!cJSON_IsString(op1)) {
+    Operand op1Operand = parseAttributeOperand(conditionJson);
+    if (op1Operand == NULL) {
         return NULL;
     }
     cJSON *op2 = cJSON_GetObjectItemCaseSensitive(conditionJson, "op2");
     Operand op2Operand = parseOperand(op2);
     if (op2Operand == NULL) {
+        free(op1Operand);
         return NULL;
     }
     cJSON *op3 = cJSON_GetObjectItemCaseSensitive(conditionJson, "op3");
     Operand op3Operand = parseOperand(op3);
     if (op3Operand == NULL) {
+        free(op1Operand);
+        free(op2Operand);
         return NULL;
     }
 
     Condition condition = malloc(sizeof(struct Condition));
     assert(condition != NULL);
 
-    condition->value.between.op1->type = ATTR;
-    condition->value.between.op1->value.strOp = strdup(op1->valuestring);
+    condition->type = BETWEEN;
+    condition->value.between.op1 = op1Operand;
     condition->value.between.op2 = op2Operand;
     condition->value.between.op3 = op3Operand;
 
     return condition;
 }
 
-static Condition parseCondition(cJSON *operationJson) {
-    cJSON *conditionJson =
-        cJSON_GetObjectItemCaseSensitive(operationJson, "condition");
-    if (conditionJson == NULL) {
-        LOG("Parse condition did not have a condition object passed into it");
+static Condition parseLogicalCondition(cJSON *conditionJson,
+                                       ConditionType type, unsigned depth) {
+    cJSON *conditions =
+        cJSON_GetObjectItemCaseSensitive(conditionJson, "conditions");
+    int conditionsLength = getJsonArrayLength(conditions);
+
+    if (!cJSON_IsArray(conditions) || conditionsLength < 2) {
+        LOG("Logical condition needs an array of at least two conditions");
+        return NULL;
+    }
+
+    // Operands are chained leaning right, so a AND b AND c is a AND (b AND c)
+    Condition root = NULL;
+    Condition *tail = &root;
+
+    cJSON *element;
+    int i = 0;
+    cJSON_ArrayForEach(element, conditions) {
+        Condition child = parseConditionJson(element, depth + 1);
+        if (child == NULL) {
+            *tail = NULL;
+            freeConditionTree(root);
+            return NULL;
+        }
+
+        if (i == conditionsLength - 1) {
+            *tail = child;
+            break;
+        }
+
+        Condition node = malloc(sizeof(struct Condition));
+        assert(node != NULL);
+
+        node->type = type;
+        node->value.binary.left = child;
+        node->value.binary.right = NULL;
+
+        *tail = node;
+        tail = &node->value.binary.right;
+        i++;
+    }
+
+    return root;
+}
+
+static Condition parseConditionJson(cJSON *conditionJson, unsigned depth) {
+    if (depth > MAX_CONDITION_DEPTH) {
+        LOG("Condition is nested more than %d levels deep",
+            MAX_CONDITION_DEPTH);
         return NULL;
     }
 
@@ -250,41 +354,23 @@ static Condition parseCondition(cJSON *operationJson) {
     }
 
     if (strcmp(type->valuestring, "EQUALS") == 0) {
-        Condition condition = parseTwoArgCondition(conditionJson);
-        condition->type = EQUALS;
-        return condition;
+        return parseTwoArgCondition(conditionJson, EQUALS);
     } else if (strcmp(type->valuestring, "LESS_THAN") == 0) {
-        Condition condition = parseTwoArgCondition(conditionJson);
-        condition->type = LESS_THAN;
-        return condition;
+        return parseTwoArgCondition(conditionJson, LESS_THAN);
     } else if (strcmp(type->valuestring, "GREATER_THAN") == 0) {
-        Condition condition = parseTwoArgCondition(conditionJson);
-        condition->type = GREATER_THAN;
-        return condition;
+        return parseTwoArgCondition(conditionJson, GREATER_THAN);
     } else if (strcmp(type->valuestring, "AND") == 0) {
-        Condition condition = parseTwoArgCondition(conditionJson);
-        condition->type = AND;
-        return condition;
+        return parseLogicalCondition(conditionJson, AND, depth);
     } else if (strcmp(type->valuestring, "OR") == 0) {
-        Condition condition = parseTwoArgCondition(conditionJson);
-        condition->type = OR;
-        return condition;
+        return parseLogicalCondition(conditionJson, OR, depth);
     } else if (strcmp(type->valuestring, "LESS_EQUALS") == 0) {
-        Condition condition = parseTwoArgCondition(conditionJson);
-        condition->type = LESS_EQUALS;
-        return condition;
+        return parseTwoArgCondition(conditionJson, LESS_EQUALS);
     } else if (strcmp(type->valuestring, "GREATER_EQUALS") == 0) {
-        Condition condition = parseTwoArgCondition(conditionJson);
-        condition->type = GREATER_EQUALS;
-        return condition;
+        return parseTwoArgCondition(conditionJson, GREATER_EQUALS);
     } else if (strcmp(type->valuestring, "NOT") == 0) {
-        Condition condition = parseOneArgCondition(conditionJson);
-        condition->type = NOT;
-        return condition;
+        return parseOneArgCondition(conditionJson, depth);
     } else if (strcmp(type->valuestring, "BETWEEN") == 0) {
-        Condition condition = parseThreeArgCondition(conditionJson);
-        condition->type = BETWEEN;
-        return condition;
+        return parseThreeArgCondition(conditionJson);
     } else {
         LOG("Type in condition did not have a valid type it was: %s",
             type->valuestring);
@@ -292,6 +378,17 @@ static Condition parseCondition(cJSON *operationJson) {
     }
 }
 
+static Condition parseCondition(cJSON *operationJson) {
+    cJSON *conditionJson =
+        cJSON_GetObjectItemCaseSensitive(operationJson, "condition");
+    if (conditionJson == NULL) {
+        LOG("Parse condition did not have a condition object passed into it");
+        return NULL;
+    }
+
+    return parseConditionJson(conditionJson, 0);
+}
+
 static Operation parseSelectOperation(Operation operation,
                                       cJSON *operationJson) {
     operation->queryType = SELECT;
@@ -385,6 +482,25 @@ static Operation parseCreateTableOperation(Operation operation,
     return operation;
 }
 
+static Operation parseCreateIndexOperation(Operation operation,
+                                           cJSON *operationJson) {
+    operation->queryType = CREATE_INDEX;
+
+    const cJSON *attribute =
+        cJSON_GetObjectItemCaseSensitive(operationJson, "attribute");
+    if (!cJSON_IsString(attribute)) {
+        LOG("CREATE_INDEX operation did not have an attribute");
+        free(operation->tableName);
+        free(operation);
+
+        return NULL;
+    }
+
+    operation->query.createIndex.attribute = strdup(attribute->valuestring);
+
+    return operation;
+}
+
 Operation parseOperationJson(const char *jsonString) {
     cJSON *operationJson = cJSON_Parse(jsonString);
     if (operationJson == NULL) {
@@ -421,6 +537,8 @@ Operation parseOperationJson(const char *jsonString) {
         operation = parseDeleteOperation(operation, operationJson);
     } else if (strcmp(queryType->valuestring, "CREATE_TABLE") == 0) {
         operation = parseCreateTableOperation(operation, operationJson);
+    } else if (strcmp(queryType->valuestring, "CREATE_INDEX") == 0) {
+        operation = parseCreateIndexOperation(operation, operationJson);
     } else {
         LOG("Invalid input into parseOperationJson. Did not have queryType "
             "correctly set");
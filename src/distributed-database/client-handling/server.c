@@ -1,6 +1,9 @@
 #include "server.h"
 
+#include <assert.h>
 #include <math.h>
+#include <pthread.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <third-party/mongoose.h>
 
@@ -9,12 +12,62 @@
 #include "networking/msg.h"
 #include "raft/callbacks.h"
 #include "raft/raft-node.h"
+#include "table/core/bufferPool.h"
 
 #define OK_RESPONSE_CODE 200
 #define BAD_REQUEST_RESPONSE_CODE 400
 #define NOT_FOUND_RESPONSE_CODE 404
 #define METHOD_NOT_ALLOWED_RESPONSE_CODE 405
 
+#define RESPONSE_BODY_SIZE 128
+
+static struct mg_mgr mgr;
+
+// Write waiting on its own thread to be appended to the log, so the event
+// loop keeps accepting writes that join the same batch
+typedef struct WriteRequest *WriteRequest;
+struct WriteRequest {
+    unsigned long connectionId;
+    Operation operation;
+};
+
+static void *runWriteRequest(void *arg) {
+    WriteRequest request = arg;
+    int leaderId = handleClientRequest(request->operation);
+
+    char body[RESPONSE_BODY_SIZE];
+    if (leaderId == NULL_NODE_ID) {
+        snprintf(body, sizeof(body),
+                 "{\"success\": \"The write operation was successful\"}");
+    } else if (leaderId == REQUEST_NOT_APPENDED) {
+        snprintf(body, sizeof(body),
+                 "{\"error\": \"The write operation was not appended, "
+                 "retry it\"}");
+    } else {
+        snprintf(body, sizeof(body),
+                 "{\"error\": \"This is a follower node\", "
+                 "\"leaderId\": %d}",
+                 leaderId);
+    }
+
+    // Reply is sent by the event loop, which owns the connection
+    mg_wakeup(&mgr, request->connectionId, body, strlen(body));
+    free(request);
+    return NULL;
+}
+
+static void handleClientWriteRequest(struct mg_connection *c,
+                                     Operation operation) {
+    WriteRequest request = malloc(sizeof(struct WriteRequest));
+    assert(request != NULL);
+    request->connectionId = c->id;
+    request->operation = operation;
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, runWriteRequest, request);
+    pthread_detach(thread);
+}
+
 static void handleClientQueryRequest(struct mg_connection *c,
                                      struct mg_http_message *hm) {
     char body[hm->body.len + 1];
@@ -28,17 +81,7 @@ static void handleClientQueryRequest(struct mg_connection *c,
         mg_http_reply(c, BAD_REQUEST_RESPONSE_CODE, "",
                       "{\"error\": \"Invalid operation passed in\"}");
     } else if (isWriteOperation(operation)) {
-        int leaderId = handleClientRequest(operation);
-        if (leaderId == NULL_NODE_ID) {
-            mg_http_reply(
-                c, OK_RESPONSE_CODE, "",
-                "{\"success\": \"The write operation was successful\"}");
-        } else {
-            mg_http_reply(
-                c, OK_RESPONSE_CODE, "",
-                "{\"error\": \"This is a follower node\", \"leaderId\": %d}",
-                leaderId);
-        }
+        handleClientWriteRequest(c, operation);
     } else {
         QueryResult queryResult = executeOperation(operation);
 
@@ -57,7 +100,24 @@ static void handleLeaderQueryRequest(struct mg_connection *c,
     mg_http_reply(c, OK_RESPONSE_CODE, "", "%d", getLeaderId());
 }
 
+static void handleStatsRequest(struct mg_connection *c,
+                               struct mg_http_message *hm) {
+    BufferPoolStats stats = getBufferPoolStats();
+    mg_http_reply(c, OK_RESPONSE_CODE, "",
+                  "{\"bufferPool\": {\"hits\": %lu, \"misses\": %lu, "
+                  "\"evictions\": %lu, \"writeBacks\": %lu}}",
+                  (unsigned long)stats.hits, (unsigned long)stats.misses,
+                  (unsigned long)stats.evictions,
+                  (unsigned long)stats.writeBacks);
+}
+
 static void handler(struct mg_connection *c, int ev, void *ev_data) {
+    if (ev == MG_EV_WAKEUP) {
+        struct mg_str *body = (struct mg_str *)ev_data;
+        mg_http_reply(c, OK_RESPONSE_CODE, "", "%.*s", (int)body->len,
+                      body->buf);
+        return;
+    }
     if (ev != MG_EV_HTTP_MSG) return;
 
     struct mg_http_message *hm = (struct mg_http_message *)ev_data;
@@ -74,8 +134,15 @@ static void handler(struct mg_connection *c, int ev, void *ev_data) {
         return;
     }
 
+    if (mg_match(hm->uri, mg_str("/stats"), NULL) &&
+        mg_strcmp(hm->method, mg_str("GET")) == 0) {
+        handleStatsRequest(c, hm);
+        return;
+    }
+
     if (!mg_match(hm->uri, mg_str("/"), NULL) &&
-        !mg_match(hm->uri, mg_str("/leader"), NULL)) {
+        !mg_match(hm->uri, mg_str("/leader"), NULL) &&
+        !mg_match(hm->uri, mg_str("/stats"), NULL)) {
         mg_http_reply(c, NOT_FOUND_RESPONSE_CODE, "", "");
         return;
     }
@@ -88,8 +155,8 @@ static void startServer(int port) {
     char listenAddr[32];
     snprintf(listenAddr, sizeof(listenAddr), "https://0.0.0.0:%d", port);
 
-    struct mg_mgr mgr;
     mg_mgr_init(&mgr);
+    mg_wakeup_init(&mgr);
     mg_http_listen(&mgr, listenAddr, handler, NULL);
 
     for (;;) mg_mgr_poll(&mgr, 1000);
@@ -37,7 +37,29 @@ void execute(Msg msg, int senderId) {
                 senderId, msg->data.appendEntriesResponse.prevLogIndex,
                 msg->data.appendEntriesResponse.numEntries,
                 msg->data.appendEntriesResponse.term,
-                msg->data.appendEntriesResponse.success);
+                msg->data.appendEntriesResponse.success,
+                msg->data.appendEntriesResponse.conflictTerm,
+                msg->data.appendEntriesResponse.conflictIndex);
+            break;
+        case INSTALL_SNAPSHOT:
+            handleInstallSnapshot(senderId, msg->data.installSnapshot.term,
+                                  msg->data.installSnapshot.lastIncludedIndex,
+                                  msg->data.installSnapshot.lastIncludedTerm,
+                                  msg->data.installSnapshot.fileIdx,
+                                  msg->data.installSnapshot.fileName,
+                                  msg->data.installSnapshot.offset,
+                                  msg->data.installSnapshot.numBytes,
+                                  msg->data.installSnapshot.data,
+                                  msg->data.installSnapshot.done);
+            break;
+        case INSTALL_SNAPSHOT_RESPONSE:
+            handleInstallSnapshotResponse(
+                senderId, msg->data.installSnapshotResponse.term,
+                msg->data.installSnapshotResponse.lastIncludedIndex,
+                msg->data.installSnapshotResponse.fileIdx,
+                msg->data.installSnapshotResponse.offset,
+                msg->data.installSnapshotResponse.success,
+                msg->data.installSnapshotResponse.done);
             break;
     }
 }
@@ -15,6 +15,10 @@ void freeMsgShallow(Msg msg) {
         msg->data.appendEntries.entries != NULL) {
         free(msg->data.appendEntries.entries);
     }
+    if (msg->type == INSTALL_SNAPSHOT) {
+        free(msg->data.installSnapshot.fileName);
+        free(msg->data.installSnapshot.data);
+    }
     free(msg);
 }
 
@@ -45,7 +49,7 @@ Msg parse(ReadBuff readBuff) {
     assert(ptrs != NULL);
     ptrs[ptrsSize++] = msg;
 
-    MSG(PARSE, PARSE_STRING, PARSE_MALLOC, PARSE_FREE, msg);
+    MSG(PARSE, PARSE_STRING, PARSE_BYTES, PARSE_MALLOC, PARSE_FREE, msg);
 
     free(ptrs);
 
@@ -61,7 +65,7 @@ EncodeRes encode(Msg msg) {
 
     uint8_t *buff = buffBase;
 
-    MSG(ENCODE, ENCODE_STRING, ENCODE_MALLOC, ENCODE_FREE, msg);
+    MSG(ENCODE, ENCODE_STRING, ENCODE_BYTES, ENCODE_MALLOC, ENCODE_FREE, msg);
 
     EncodeRes res = malloc(sizeof(struct EncodeRes));
     assert(res != NULL);
@@ -72,7 +76,7 @@ EncodeRes encode(Msg msg) {
 }
 
 void *printMsg(Msg msg) {
-    MSG(PRINT, PRINT_STRING, PRINT_MALLOC, PRINT_FREE, msg);
+    MSG(PRINT, PRINT_STRING, PRINT_BYTES, PRINT_MALLOC, PRINT_FREE, msg);
     return NULL;
 }
 
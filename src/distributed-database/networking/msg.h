@@ -14,7 +14,7 @@
 
 #define DEFAULT_READ_BUFFER_CAPACITY 1024
 // Should be equal to the largest non variable message
-#define DEFAULT_ENCODE_BUFFER_CAPACITY 14
+#define DEFAULT_ENCODE_BUFFER_CAPACITY 22
 #define DEFAULT_PTRS_ARRAY_CAPACITY 8
 
 typedef struct ReadBuff *ReadBuff;
@@ -47,9 +47,16 @@ struct ReadBuff {
         v[len] = '\0';                   \
         readBuff->buff += len;           \
     }
+#define PARSE_BYTES(v, n)             \
+    {                                 \
+        PARSE_CHECK(n);               \
+        PARSE_MALLOC(uint8_t, v, n);  \
+        memcpy(v, readBuff->buff, n); \
+        readBuff->buff += n;          \
+    }
 #define PARSE_MALLOC(t, v, n)                                    \
     {                                                            \
-        v = malloc(n * sizeof(t));                               \
+        v = calloc(n, sizeof(t));                                \
         assert(v != NULL);                                       \
         if (ptrsSize == ptrsCapacity) {                          \
             ptrsCapacity *= 2;                                   \
@@ -67,7 +74,7 @@ struct ReadBuff {
 
 #define ENCODE_CHECK(s)                             \
     {                                               \
-        if (size + s > capacity) {                  \
+        while (size + s > capacity) {               \
             capacity *= 2;                          \
             buffBase = realloc(buffBase, capacity); \
             buff = buffBase + size;                 \
@@ -88,6 +95,12 @@ struct ReadBuff {
         memcpy(buff, v, len);             \
         buff += len;                      \
     }
+#define ENCODE_BYTES(v, n)  \
+    {                       \
+        ENCODE_CHECK(n);    \
+        memcpy(buff, v, n); \
+        buff += n;          \
+    }
 #define ENCODE_MALLOC(t, v, n)  // Empty
 #define ENCODE_FREE()           // Empty
 
@@ -108,6 +121,7 @@ struct ReadBuff {
     printf(FORMAT_CODE(v), v); \
     printf("\n");
 #define PRINT_STRING(v) LOG("%s: \"%s\" (length: %lu)", #v, v, strlen(v));
+#define PRINT_BYTES(v, n) LOG("%s: (length: %d)", #v, n);
 #define PRINT_MALLOC(t, v, n)  // Empty
 #define PRINT_FREE()           // Empty
 
@@ -137,7 +151,8 @@ struct ReadBuff {
             break;                                         \
         }                                                  \
         case STR:                                          \
-        case VARSTR: {                                     \
+        case VARSTR:                                       \
+        case ATTR: {                                       \
             PROCS(operand->value.strOp);                   \
             break;                                         \
         }                                                  \
@@ -162,38 +177,82 @@ struct ReadBuff {
         MALLOC(struct Operand, queryValues->values[j], 1);          \
         OPERAND(PROC, PROCS, MALLOC, FREE, queryValues->values[j]); \
     }
-#define CONDITION(PROC, PROCS, MALLOC, FREE, condition)                       \
-    PROC(condition->type);                                                    \
-    switch (condition->type) {                                                \
-        case NOT: {                                                           \
-            PROCS(condition->value.oneArg.op1->value.strOp);                  \
-            break;                                                            \
-        }                                                                     \
-        case EQUALS:                                                          \
-        case LESS_THAN:                                                       \
-        case GREATER_THAN:                                                    \
-        case LESS_EQUALS:                                                     \
-        case GREATER_EQUALS:                                                  \
-        case AND:                                                             \
-        case OR: {                                                            \
-            PROCS(condition->value.twoArg.op1->value.strOp);                  \
-            MALLOC(struct Operand, condition->value.twoArg.op2, 1);           \
-            OPERAND(PROC, PROCS, MALLOC, FREE, condition->value.twoArg.op2);  \
-            break;                                                            \
-        }                                                                     \
-        case BETWEEN: {                                                       \
-            PROCS(condition->value.between.op1->value.strOp);                 \
-            MALLOC(struct Operand, condition->value.between.op2, 1);          \
-            OPERAND(PROC, PROCS, MALLOC, FREE, condition->value.between.op2); \
-            MALLOC(struct Operand, condition->value.between.op3, 1);          \
-            OPERAND(PROC, PROCS, MALLOC, FREE, condition->value.between.op3); \
-            break;                                                            \
-        }                                                                     \
-        default: {                                                            \
-            LOG("Invalid condition type %d", condition->type);                \
-            FREE();                                                           \
-            return NULL;                                                      \
-        }                                                                     \
+// Each level of nesting leaves at most the right operands of an OR and an AND
+// pending while the condition tree is walked
+#define CONDITION_STACK_SIZE (2 * MAX_CONDITION_DEPTH + 4)
+
+// Walks the condition tree in pre-order with an explicit stack of the slots
+// holding pending subconditions, since macros cannot recurse
+#define CONDITION(PROC, PROCS, MALLOC, FREE, condition)                        \
+    {                                                                          \
+        uint8_t hasCondition = condition != NULL;                              \
+        PROC(hasCondition);                                                    \
+        Condition *pending[CONDITION_STACK_SIZE];                              \
+        int numPending = 0;                                                    \
+        if (hasCondition) {                                                    \
+            pending[numPending++] = &condition;                                \
+        }                                                                      \
+        while (numPending > 0) {                                               \
+            Condition *slot = pending[--numPending];                           \
+            MALLOC(struct Condition, *slot, 1);                                \
+            Condition node = *slot;                                            \
+            PROC(node->type);                                                  \
+            if (numPending + 2 > CONDITION_STACK_SIZE) {                       \
+                LOG("Condition is nested too deeply");                         \
+                FREE();                                                        \
+                return NULL;                                                   \
+            }                                                                  \
+            switch (node->type) {                                              \
+                case AND:                                                      \
+                case OR: {                                                     \
+                    pending[numPending++] = &node->value.binary.right;         \
+                    pending[numPending++] = &node->value.binary.left;          \
+                    break;                                                     \
+                }                                                              \
+                case NOT: {                                                    \
+                    uint8_t negatesAttr = node->value.oneArg.op1 != NULL;      \
+                    PROC(negatesAttr);                                         \
+                    if (negatesAttr) {                                         \
+                        MALLOC(struct Operand, node->value.oneArg.op1, 1);     \
+                        OPERAND(PROC, PROCS, MALLOC, FREE,                     \
+                                node->value.oneArg.op1);                       \
+                    } else {                                                   \
+                        pending[numPending++] = &node->value.oneArg.child;     \
+                    }                                                          \
+                    break;                                                     \
+                }                                                              \
+                case EQUALS:                                                   \
+                case LESS_THAN:                                                \
+                case GREATER_THAN:                                             \
+                case LESS_EQUALS:                                              \
+                case GREATER_EQUALS: {                                         \
+                    MALLOC(struct Operand, node->value.twoArg.op1, 1);         \
+                    OPERAND(PROC, PROCS, MALLOC, FREE,                         \
+                            node->value.twoArg.op1);                           \
+                    MALLOC(struct Operand, node->value.twoArg.op2, 1);         \
+                    OPERAND(PROC, PROCS, MALLOC, FREE,                         \
+                            node->value.twoArg.op2);                           \
+                    break;                                                     \
+                }                                                              \
+                case BETWEEN: {                                                \
+                    MALLOC(struct Operand, node->value.between.op1, 1);        \
+                    OPERAND(PROC, PROCS, MALLOC, FREE,                         \
+                            node->value.between.op1);                          \
+                    MALLOC(struct Operand, node->value.between.op2, 1);        \
+                    OPERAND(PROC, PROCS, MALLOC, FREE,                         \
+                            node->value.between.op2);                          \
+                    MALLOC(struct Operand, node->value.between.op3, 1);        \
+                    OPERAND(PROC, PROCS, MALLOC, FREE,                         \
+                            node->value.between.op3);                          \
+                    break;                                                     \
+                }                                                              \
+                default: {                                                     \
+                    LOG("Invalid condition type %d", node->type);              \
+                    FREE();                                                    \
+                    return NULL;                                               \
+                }                                                              \
+            }                                                                  \
+        }                                                                      \
     }
 #define QUERY_TYPES(PROC, PROCS, MALLOC, FREE, queryTypes)    \
     PROC(queryTypes->numTypes);                               \
@@ -235,17 +294,19 @@ struct ReadBuff {
             MALLOC(struct QueryValues, operation->query.update.values, 1);     \
             QUERY_VALUES(PROC, PROCS, MALLOC, FREE,                            \
                          operation->query.update.values);                      \
-            MALLOC(struct Condition, operation->query.update.condition, 1);    \
             CONDITION(PROC, PROCS, MALLOC, FREE,                               \
                       operation->query.update.condition);                      \
             break;                                                             \
         }                                                                      \
         case DELETE: {                                                         \
-            MALLOC(struct Condition, operation->query.delete.condition, 1);    \
             CONDITION(PROC, PROCS, MALLOC, FREE,                               \
                       operation->query.delete.condition);                      \
             break;                                                             \
         }                                                                      \
+        case CREATE_INDEX: {                                                   \
+            PROCS(operation->query.createIndex.attribute);                     \
+            break;                                                             \
+        }                                                                      \
         }
         // case CREATE_TABLE: {                                                   \
         //    MALLOC(struct QueryTypes,                                     \
@@ -285,9 +346,33 @@ struct ReadBuff {
     PROC(appendEntriesResponse.prevLogIndex);              \
     PROC(appendEntriesResponse.numEntries);                \
     PROC(appendEntriesResponse.term);                      \
-    PROC(appendEntriesResponse.success);
+    PROC(appendEntriesResponse.success);                   \
+    PROC(appendEntriesResponse.conflictTerm);              \
+    PROC(appendEntriesResponse.conflictIndex);
+
+// Chunk of the file at position fileIdx among the snapshot files, sorted by
+// name. The snapshot holds no files if fileName is empty
+#define INSTALL_SNAPSHOT(PROC, PROCS, PROCB, MALLOC, FREE, installSnapshot) \
+    PROC(installSnapshot.term);                                             \
+    PROC(installSnapshot.lastIncludedIndex);                                \
+    PROC(installSnapshot.lastIncludedTerm);                                 \
+    PROC(installSnapshot.fileIdx);                                          \
+    PROCS(installSnapshot.fileName);                                        \
+    PROC(installSnapshot.offset);                                           \
+    PROC(installSnapshot.numBytes);                                         \
+    PROCB(installSnapshot.data, installSnapshot.numBytes);                  \
+    PROC(installSnapshot.done);
+
+#define INSTALL_SNAPSHOT_RESPONSE(PROC, PROCS, MALLOC, FREE, \
+                                  installSnapshotResponse)   \
+    PROC(installSnapshotResponse.term);                      \
+    PROC(installSnapshotResponse.lastIncludedIndex);         \
+    PROC(installSnapshotResponse.fileIdx);                   \
+    PROC(installSnapshotResponse.offset);                    \
+    PROC(installSnapshotResponse.success);                   \
+    PROC(installSnapshotResponse.done);
 
-#define MSG(PROC, PROCS, MALLOC, FREE, msg)                                 \
+#define MSG(PROC, PROCS, PROCB, MALLOC, FREE, msg)                          \
     PROC(msg->type);                                                        \
     switch (msg->type) {                                                    \
         case CLIENT_IDENTIFY:                                               \
@@ -317,6 +402,16 @@ struct ReadBuff {
                                     msg->data.appendEntriesResponse);       \
             break;                                                          \
         }                                                                   \
+        case INSTALL_SNAPSHOT: {                                            \
+            INSTALL_SNAPSHOT(PROC, PROCS, PROCB, MALLOC, FREE,              \
+                             msg->data.installSnapshot);                    \
+            break;                                                          \
+        }                                                                   \
+        case INSTALL_SNAPSHOT_RESPONSE: {                                   \
+            INSTALL_SNAPSHOT_RESPONSE(PROC, PROCS, MALLOC, FREE,            \
+                                      msg->data.installSnapshotResponse);   \
+            break;                                                          \
+        }                                                                   \
         default: {                                                          \
             LOG("Invalid message type %d", msg->type);                      \
             FREE();                                                         \
@@ -332,6 +427,8 @@ typedef enum {
     REQUEST_VOTE_RESPONSE,
     APPEND_ENTRIES,
     APPEND_ENTRIES_RESPONSE,
+    INSTALL_SNAPSHOT,
+    INSTALL_SNAPSHOT_RESPONSE,
 } MsgType;
 
 typedef struct Msg *Msg;
@@ -363,12 +460,33 @@ struct Msg {
             int numEntries;
             int term;
             bool success;
+            int conflictTerm;   // Term of conflicting entry, or UNKNOWN_TERM
+            int conflictIndex;  // First index of conflictTerm or log length
         } appendEntriesResponse;
+        struct {
+            int term;
+            int lastIncludedIndex;
+            int lastIncludedTerm;
+            int fileIdx;
+            char *fileName;
+            int offset;
+            int numBytes;
+            uint8_t *data;
+            bool done;  // Chunk is the last of the snapshot
+        } installSnapshot;
+        struct {
+            int term;
+            int lastIncludedIndex;
+            int fileIdx;
+            int offset;  // End of the acknowledged chunk in its file
+            bool success;
+            bool done;  // Snapshot is installed
+        } installSnapshotResponse;
     } data;
 };
 
 /**
- * Free the given message and the log entries array
+ * Free the given message and the log entries array or snapshot chunk
  * @param msg the Msg to free
  */
 extern void freeMsgShallow(Msg msg);
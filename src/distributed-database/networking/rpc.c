@@ -152,12 +152,18 @@ int checkReadBuff(ReadBuff readBuff, int nBytes) {
 
         if (freeBytes + availableBytes < nBytes) {
             if (readBuff->capacity < nBytes) {
+                // Grows to hold values read whole, such as snapshot chunks
+                uint8_t *base = malloc(nBytes);
+                assert(base != NULL);
+                memcpy(base, readBuff->buff, availableBytes);
+                free(readBuff->base);
+
                 readBuff->capacity = nBytes;
-                readBuff->base = malloc(readBuff->capacity);
-                assert(readBuff->base != NULL);
+                readBuff->base = base;
+            } else {
+                memmove(readBuff->base, readBuff->buff, availableBytes);
             }
 
-            memmove(readBuff->base, readBuff->buff, availableBytes);
             readBuff->buff = readBuff->base;
             readBuff->size = availableBytes;
 
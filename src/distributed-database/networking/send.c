@@ -44,11 +44,43 @@ void sendAppendEntries(int followerId, int term, int prevLogIndex,
 }
 
 void sendAppendEntriesResponse(int leaderId, int prevLogIndex, int numEntries,
-                               int term, bool success) {
+                               int term, bool success, int conflictTerm,
+                               int conflictIndex) {
     Msg msg = makeMsg(APPEND_ENTRIES_RESPONSE);
     msg->data.appendEntriesResponse.prevLogIndex = prevLogIndex;
     msg->data.appendEntriesResponse.numEntries = numEntries;
     msg->data.appendEntriesResponse.term = term;
     msg->data.appendEntriesResponse.success = success;
+    msg->data.appendEntriesResponse.conflictTerm = conflictTerm;
+    msg->data.appendEntriesResponse.conflictIndex = conflictIndex;
+    nodeSend(leaderId, msg);
+}
+
+void sendInstallSnapshot(int followerId, int term, int lastIncludedIndex,
+                         int lastIncludedTerm, int fileIdx, char *fileName,
+                         int offset, int numBytes, uint8_t *data, bool done) {
+    Msg msg = makeMsg(INSTALL_SNAPSHOT);
+    msg->data.installSnapshot.term = term;
+    msg->data.installSnapshot.lastIncludedIndex = lastIncludedIndex;
+    msg->data.installSnapshot.lastIncludedTerm = lastIncludedTerm;
+    msg->data.installSnapshot.fileIdx = fileIdx;
+    msg->data.installSnapshot.fileName = fileName;
+    msg->data.installSnapshot.offset = offset;
+    msg->data.installSnapshot.numBytes = numBytes;
+    msg->data.installSnapshot.data = data;
+    msg->data.installSnapshot.done = done;
+    nodeSend(followerId, msg);
+}
+
+void sendInstallSnapshotResponse(int leaderId, int term, int lastIncludedIndex,
+                                 int fileIdx, int offset, bool success,
+                                 bool done) {
+    Msg msg = makeMsg(INSTALL_SNAPSHOT_RESPONSE);
+    msg->data.installSnapshotResponse.term = term;
+    msg->data.installSnapshotResponse.lastIncludedIndex = lastIncludedIndex;
+    msg->data.installSnapshotResponse.fileIdx = fileIdx;
+    msg->data.installSnapshotResponse.offset = offset;
+    msg->data.installSnapshotResponse.success = success;
+    msg->data.installSnapshotResponse.done = done;
     nodeSend(leaderId, msg);
 }
@@ -2,6 +2,7 @@
 #define SEND_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "raft/log-entry.h"
 
@@ -43,8 +44,46 @@ extern void sendAppendEntries(int followerId, int term, int prevLogIndex,
  * @param numEntries the number of entries sent
  * @param term the current term
  * @param success indicates if the operation was successful
+ * @param conflictTerm the term of the entry at prevLogIndex if it conflicts
+ * with the leader's, or UNKNOWN_TERM if the log is too short
+ * @param conflictIndex the first index of conflictTerm in the log, or the
+ * log length if the log is too short
  */
 extern void sendAppendEntriesResponse(int leaderId, int prevLogIndex,
-                                      int numEntries, int term, bool success);
+                                      int numEntries, int term, bool success,
+                                      int conflictTerm, int conflictIndex);
+
+/**
+ * Send chunk of a snapshot file to a follower node, which takes ownership of
+ * fileName and data
+ * @param followerId the follower node to send the message to
+ * @param term the current term
+ * @param lastIncludedIndex the last log index included in the snapshot
+ * @param lastIncludedTerm the term of the last log included in the snapshot
+ * @param fileIdx the position of the file among the snapshot files
+ * @param fileName the name of the file
+ * @param offset the offset of the chunk in the file
+ * @param numBytes the number of bytes in the chunk
+ * @param data the bytes of the chunk
+ * @param done indicates if the chunk is the last of the snapshot
+ */
+extern void sendInstallSnapshot(int followerId, int term,
+                                int lastIncludedIndex, int lastIncludedTerm,
+                                int fileIdx, char *fileName, int offset,
+                                int numBytes, uint8_t *data, bool done);
+
+/**
+ * Send InstallSnapshot response from the follower to the leader
+ * @param leaderId the id of the node to send the message to
+ * @param term the current term
+ * @param lastIncludedIndex the last log index included in the snapshot
+ * @param fileIdx the position of the file of the chunk received
+ * @param offset the end of the chunk received in its file
+ * @param success indicates if the chunk was written
+ * @param done indicates if the snapshot has been installed
+ */
+extern void sendInstallSnapshotResponse(int leaderId, int term,
+                                        int lastIncludedIndex, int fileIdx,
+                                        int offset, bool success, bool done);
 
 #endif  // SEND_H
@@ -3,6 +3,7 @@
 #include <assert.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <string.h>
 
 #include "callbacks.h"
 #include "int-list.h"
@@ -12,14 +13,14 @@
 #include "raft/log-table.h"
 #include "raft/raft-node.h"
 #include "raft/raft.h"
+#include "raft/snapshot.h"
 #include "utils.h"
 
 static void checkTerm(int term) {
     acquireRaftNodeLock();
     if (term > node->currentTerm) {
-        setCurrentTerm(term);
+        setCurrentTerm(term, NULL_NODE_ID);
         setRaftNodeState(FOLLOWER);
-        setVotedFor(NULL_NODE_ID);
     }
     releaseRaftNodeLock();
 }
@@ -29,8 +30,7 @@ void handleRequestVote(int senderId, int senderTerm, int senderLastLogIndex,
     acquireRaftNodeLock();
     checkTerm(senderTerm);
     const int lastLogIndex = logTableLength(node->log) - 1;
-    const int lastLogTerm =
-        lastLogIndex == -1 ? 0 : logTableGet(node->log, lastLogIndex)->term;
+    const int lastLogTerm = logTableTerm(node->log, lastLogIndex);
     const bool logAtLeastAsUpToDate = (senderLastLogTerm > lastLogTerm ||
                                        (senderLastLogTerm == lastLogTerm &&
                                         senderLastLogIndex >= lastLogIndex));
@@ -53,21 +53,12 @@ void handleRequestVoteResponse(int voterId, int term, bool voteGranted) {
     }
     if (voteGranted) {
         node->numVotes++;
+        wakeRaftMain();
     }
     releaseRaftNodeLock();
 }
 
-void handleAppendEntries(int leaderId, int term, int prevLogIndex,
-                         int prevLogTerm, int leaderCommit, int numEntries,
-                         LogEntry *entries) {
-    acquireRaftNodeLock();
-    checkTerm(term);
-    if (term < node->currentTerm) {
-        sendAppendEntriesResponse(leaderId, prevLogIndex, numEntries,
-                                  node->currentTerm, false);
-        releaseRaftNodeLock();
-        return;
-    }
+static void followLeader(int leaderId, int term) {
     assert(term == node->currentTerm);
     assert(node->state != LEADER);
     if (node->state == CANDIDATE) {
@@ -79,27 +70,52 @@ void handleAppendEntries(int leaderId, int term, int prevLogIndex,
         setLeaderId(leaderId);
     }
     setInteractionTime();
-    if (prevLogIndex > -1) {
-        if (prevLogIndex >= logTableLength(node->log)) {
-            sendAppendEntriesResponse(leaderId, prevLogIndex, numEntries,
-                                      node->currentTerm, false);
-            releaseRaftNodeLock();
-            return;
-        }
-        const LogEntry ourPrevLogEntry = logTableGet(node->log, prevLogIndex);
-        if (!(ourPrevLogEntry != NULL &&
-              ourPrevLogEntry->term == prevLogTerm)) {
-            sendAppendEntriesResponse(leaderId, prevLogIndex, numEntries,
-                                      node->currentTerm, false);
-            releaseRaftNodeLock();
-            return;
+}
+
+void handleAppendEntries(int leaderId, int term, int prevLogIndex,
+                         int prevLogTerm, int leaderCommit, int numEntries,
+                         LogEntry *entries) {
+    acquireRaftNodeLock();
+    checkTerm(term);
+    if (term < node->currentTerm) {
+        sendAppendEntriesResponse(leaderId, prevLogIndex, numEntries,
+                                  node->currentTerm, false, UNKNOWN_TERM,
+                                  logTableLength(node->log));
+        releaseRaftNodeLock();
+        return;
+    }
+    followLeader(leaderId, term);
+
+    if (prevLogIndex >= logTableLength(node->log)) {
+        sendAppendEntriesResponse(leaderId, prevLogIndex, numEntries,
+                                  node->currentTerm, false, UNKNOWN_TERM,
+                                  logTableLength(node->log));
+        releaseRaftNodeLock();
+        return;
+    }
+
+    // Entries up to the snapshot are committed, so they match the leader's
+    // and only later entries are checked
+    const int snapshotIndex = logTableSnapshotIndex(node->log);
+    if (prevLogIndex >= snapshotIndex &&
+        logTableTerm(node->log, prevLogIndex) != prevLogTerm) {
+        const int conflictTerm = logTableTerm(node->log, prevLogIndex);
+        int conflictIndex = prevLogIndex;
+        while (conflictIndex - 1 > snapshotIndex &&
+               logTableTerm(node->log, conflictIndex - 1) == conflictTerm) {
+            conflictIndex--;
         }
+        sendAppendEntriesResponse(leaderId, prevLogIndex, numEntries,
+                                  node->currentTerm, false, conflictTerm,
+                                  conflictIndex);
+        releaseRaftNodeLock();
+        return;
     }
 
     // Iterates over entries to append. If an existing entry conflicts with a
     // new one delete the existing entry and all that follow it
     int numEntriesToPop = 0;
-    int addIndex = 0;
+    int addIndex = MIN(MAX(snapshotIndex - prevLogIndex, 0), numEntries);
     for (; addIndex < numEntries; addIndex++) {
         const int tableIndex = prevLogIndex + 1 + addIndex;
         LogEntry entry = logTableGet(node->log, tableIndex);
@@ -115,14 +131,13 @@ void handleAppendEntries(int leaderId, int term, int prevLogIndex,
             break;
         }
     }
-    for (int i = 0; i < numEntriesToPop; i++) {
+    if (numEntriesToPop > 0) {
         // MUST NOT DELETE LOG ENTRIES THAT WERE COMMITTED
-        assert(logTableLength(node->log) - 1 < node->commitIndex);
-        logTablePop(node->log);
-    }
-    for (; addIndex < numEntries; addIndex++) {
-        logTablePush(node->log, entries[addIndex]);
+        const int fromIndex = logTableLength(node->log) - numEntriesToPop;
+        assert(fromIndex > node->commitIndex);
+        logTableTruncate(node->log, fromIndex);
     }
+    logTablePushBatch(node->log, entries + addIndex, numEntries - addIndex);
 
     if (leaderCommit > node->commitIndex) {
         const int indexOfLastNewEntry = prevLogIndex + numEntries;
@@ -130,50 +145,183 @@ void handleAppendEntries(int leaderId, int term, int prevLogIndex,
     }
 
     sendAppendEntriesResponse(leaderId, prevLogIndex, numEntries,
-                              node->currentTerm, true);
+                              node->currentTerm, true, UNKNOWN_TERM,
+                              logTableLength(node->log));
     if (numEntries > 0) {
         LOG("Finished successfully AppendEntries of non-zero entries");
     }
     releaseRaftNodeLock();
 }
 
+// Finds where the follower's log diverges from the leader's after it
+// rejected entries following prevLogIndex
+static int getConflictNextIndex(int prevLogIndex, int conflictTerm,
+                                int conflictIndex) {
+    if (conflictTerm == UNKNOWN_TERM) {
+        return conflictIndex;
+    }
+
+    // Follower's entries of conflictTerm match the leader's up to the last
+    // one the leader holds. Terms only increase along the log
+    const int snapshotIndex = logTableSnapshotIndex(node->log);
+    for (int i = MIN(prevLogIndex, logTableLength(node->log) - 1);
+         i > snapshotIndex; i--) {
+        const int entryTerm = logTableTerm(node->log, i);
+        if (entryTerm == conflictTerm) {
+            return i + 1;
+        }
+        if (entryTerm < conflictTerm) {
+            break;
+        }
+    }
+
+    return conflictIndex;
+}
+
+static bool takeInFlightBatch(Replication *replication, int prevLogIndex,
+                              int numEntries) {
+    for (int i = 0; i < replication->numInFlight; i++) {
+        InFlightBatch *batch = &replication->inFlight[i];
+        if (batch->prevLogIndex != prevLogIndex ||
+            batch->numEntries != numEntries) {
+            continue;
+        }
+
+        replication->numInFlight--;
+        memmove(batch, batch + 1,
+                sizeof(InFlightBatch) * (replication->numInFlight - i));
+        return true;
+    }
+    return false;
+}
+
 void handleAppendEntriesResponse(int followerId, int prevLogIndex,
-                                 int numEntries, int term, bool success) {
+                                 int numEntries, int term, bool success,
+                                 int conflictTerm, int conflictIndex) {
     acquireRaftNodeLock();
     checkTerm(term);
     if (node->state != LEADER) {
         releaseRaftNodeLock();
         return;
     }
+    Replication *replication = &node->replication[followerId];
+    // Batches sent before the window was cleared, on a timeout or on moving
+    // nextIndex back, are answered by those sent after it
+    if (numEntries > 0 &&
+        !takeInFlightBatch(replication, prevLogIndex, numEntries)) {
+        releaseRaftNodeLock();
+        return;
+    }
+    if (!success && prevLogIndex >= intListGet(node->nextIndex, followerId)) {
+        releaseRaftNodeLock();
+        return;
+    }
+    if (numEntries > 0) {
+        gettimeofday(&replication->lastProgressTime, NULL);
+    }
     if (success) {
         int newMatchIndex = MAX(prevLogIndex + numEntries,
                                 intListGet(node->matchIndex, followerId));
         intListSet(node->matchIndex, followerId, newMatchIndex);
-        intListSet(node->nextIndex, followerId, newMatchIndex + 1);
+        intListSet(node->nextIndex, followerId,
+                   MAX(newMatchIndex + 1,
+                       intListGet(node->nextIndex, followerId)));
+        // Commit index may advance
+        wakeRaftMain();
+
+        // Window has room for the next batch
+        if (numEntries > 0 && intListGet(node->nextIndex, followerId) <
+                                  logTableLength(node->log)) {
+            runAppendEntries(followerId);
+        }
     } else {
-        intListSet(node->nextIndex, followerId, MAX(prevLogIndex - 1, 0));
+        // Entry at prevLogIndex was rejected, and entries up to matchIndex
+        // are known to match. Entries in flight past it will be rejected
+        int nextIndex = MIN(
+            getConflictNextIndex(prevLogIndex, conflictTerm, conflictIndex),
+            prevLogIndex);
+        nextIndex =
+            MAX(nextIndex, intListGet(node->matchIndex, followerId) + 1);
+        intListSet(node->nextIndex, followerId, nextIndex);
+        replication->numInFlight = 0;
         runAppendEntries(followerId);
     }
     releaseRaftNodeLock();
 }
 
-static void leaderHandleClientRequest(Operation operation) {
-    LogEntry entry =
-        createLogEntry(node->currentTerm, logTableLength(node->log), operation);
-    LOG("Pushing operation at index %d to leader log", entry->logIndex);
-    logTablePush(node->log, entry);
-    intListSet(node->matchIndex, node->id, entry->logIndex);
-    sendAllAppendEntries();
+void handleInstallSnapshot(int leaderId, int term, int lastIncludedIndex,
+                           int lastIncludedTerm, int fileIdx, char *fileName,
+                           int offset, int numBytes, uint8_t *data,
+                           bool done) {
+    acquireRaftNodeLock();
+    checkTerm(term);
+    if (term < node->currentTerm) {
+        sendInstallSnapshotResponse(leaderId, node->currentTerm,
+                                    lastIncludedIndex, fileIdx,
+                                    offset + numBytes, false, false);
+        releaseRaftNodeLock();
+        return;
+    }
+    followLeader(leaderId, term);
+
+    // Entries in the snapshot have already been applied, so the leader can
+    // carry on from its end
+    if (lastIncludedIndex <= node->lastApplied) {
+        sendInstallSnapshotResponse(leaderId, node->currentTerm,
+                                    lastIncludedIndex, fileIdx,
+                                    offset + numBytes, true, true);
+        releaseRaftNodeLock();
+        return;
+    }
+
+    bool success = receiveSnapshotChunk(lastIncludedIndex, fileIdx, fileName,
+                                        offset, numBytes, data);
+    if (success && done) {
+        installSnapshot(lastIncludedIndex, lastIncludedTerm);
+    }
+
+    sendInstallSnapshotResponse(leaderId, node->currentTerm,
+                                lastIncludedIndex, fileIdx, offset + numBytes,
+                                success, success && done);
+    releaseRaftNodeLock();
+}
+
+void handleInstallSnapshotResponse(int followerId, int term,
+                                   int lastIncludedIndex, int fileIdx,
+                                   int offset, bool success, bool done) {
+    acquireRaftNodeLock();
+    checkTerm(term);
+    if (node->state != LEADER) {
+        releaseRaftNodeLock();
+        return;
+    }
+    if (done) {
+        int newMatchIndex =
+            MAX(lastIncludedIndex, intListGet(node->matchIndex, followerId));
+        intListSet(node->matchIndex, followerId, newMatchIndex);
+        intListSet(node->nextIndex, followerId, newMatchIndex + 1);
+        wakeRaftMain();
+    }
+    acknowledgeSnapshotChunk(followerId, lastIncludedIndex, fileIdx, offset,
+                             success, done);
+    if (done) {
+        runAppendEntries(followerId);
+    }
+    releaseRaftNodeLock();
 }
 
 int handleClientRequest(Operation operation) {
-    acquireRaftNodeLock();
-    int res = NULL_NODE_ID;
-    if (node->state == LEADER) {
-        leaderHandleClientRequest(operation);
-    } else {
-        res = node->leaderId;
+    if (appendClientOperation(operation)) {
+        return NULL_NODE_ID;
     }
+
+    acquireRaftNodeLock();
+    int leaderId = node->leaderId;
     releaseRaftNodeLock();
-    return res;
+
+    // Without another leader to redirect to, the client can only retry
+    if (leaderId == NULL_NODE_ID || leaderId == node->id) {
+        return REQUEST_NOT_APPENDED;
+    }
+    return leaderId;
 }
@@ -2,10 +2,15 @@
 #define RAFT_CALLBACKS_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "log-entry.h"
 #include "table/operations/operation.h"
 
+// Returned for a write that was not appended to the log, such as when the
+// leader handling it lost leadership before appending it
+#define REQUEST_NOT_APPENDED (-2)
+
 /**
  * Handle the request for a vote from the sender node
  * @param senderId the sender node's id
@@ -33,18 +38,39 @@ extern void handleAppendEntries(int leaderId, int term, int prevLogIndex,
                                 int numEntries, LogEntry *entries);
 
 /**
- * Handle a response from a follower node to append entries
+ * Handle a response from a follower node to append entries. A rejection
+ * carries the conflicting term and its first index in the follower's log, so
+ * that nextIndex skips every entry of the term at once
  */
 extern void handleAppendEntriesResponse(int followerId, int prevLogIndex,
-                                        int numEntries, int term, bool success);
+                                        int numEntries, int term, bool success,
+                                        int conflictTerm, int conflictIndex);
+
+/**
+ * Handle a chunk of the leader's snapshot, installing the snapshot once its
+ * last chunk is received
+ */
+extern void handleInstallSnapshot(int leaderId, int term,
+                                  int lastIncludedIndex, int lastIncludedTerm,
+                                  int fileIdx, char *fileName, int offset,
+                                  int numBytes, uint8_t *data, bool done);
+
+/**
+ * Handle a response from a follower node to a snapshot chunk
+ */
+extern void handleInstallSnapshotResponse(int followerId, int term,
+                                          int lastIncludedIndex, int fileIdx,
+                                          int offset, bool success, bool done);
 
 /**
  * Handles a request from a client. Read operations can be handled by any node.
  * Write operations must be handled by the leader. If the operation given
  * is a write and the node is not the leader, it will return the leader id.
+ * Returns once the operation is appended to the log of the leader
  * @param operation the client operation
- * @return the node that the request needs to be sent to or null node id if the
- * current node has handled the request
+ * @return the node that the request needs to be sent to, null node id if the
+ * current node has handled the request, or REQUEST_NOT_APPENDED if it was not
+ * appended and there is no known leader to send it to
  */
 extern int handleClientRequest(Operation operation);
 
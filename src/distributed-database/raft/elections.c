@@ -27,17 +27,15 @@ void setElectionTimeout(void) {
 void commenceElection(void) {
     acquireRaftNodeLock();
     setInteractionTime();
-    setCurrentTerm(node->currentTerm + 1);
+    setCurrentTerm(node->currentTerm + 1, node->id);
     LOG("(commenceElection) Commencing election with new term of %d",
         node->currentTerm);
-    setVotedFor(node->id);
     node->numVotes = 1;
     setRaftNodeState(CANDIDATE);
     setLeaderId(NULL_NODE_ID);
     int logLength = logTableLength(node->log);
-    LogEntry lastEntry = logTableGet(node->log, logLength - 1);
     sendRequestVote(node->currentTerm, logLength - 1,
-                    (lastEntry == NULL) ? 0 : lastEntry->term);
+                    logTableTerm(node->log, logLength - 1));
     releaseRaftNodeLock();
 }
 
@@ -48,6 +46,7 @@ void electionWon(void) {
     setLeaderId(node->id);
     for (int i = 0; i < intListLength(node->nextIndex); i++) {
         intListSet(node->nextIndex, i, logTableLength(node->log));
+        node->replication[i].numInFlight = 0;
     }
     sendAllAppendEntries();
     releaseRaftNodeLock();
@@ -77,3 +76,9 @@ bool shouldCallElection(void) {
     releaseRaftNodeLock();
     return result;
 }
+
+void getElectionDeadline(struct timeval *deadline) {
+    acquireRaftNodeLock();
+    timeradd(&node->lastInteractionTime, &randomTime, deadline);
+    releaseRaftNodeLock();
+}
@@ -2,6 +2,7 @@
 #define ELECTIONS_H
 
 #include <stdbool.h>
+#include <sys/time.h>
 
 extern void setElectionTimeout(void);
 
@@ -29,4 +30,11 @@ extern bool checkElectionWon(void);
  */
 extern bool shouldCallElection(void);
 
+/**
+ * Get the time at which shouldCallElection becomes true if the node hears
+ * nothing more from a leader or candidate
+ * @param deadline set to the time of the election timeout
+ */
+extern void getElectionDeadline(struct timeval *deadline);
+
 #endif  // ELECTIONS_H
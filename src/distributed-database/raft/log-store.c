@@ -0,0 +1,588 @@
+#include "raft/log-store.h"
+
+#include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "log.h"
+#include "networking/msg.h"
+#include "networking/rpc.h"
+#include "raft/persistent-store.h"
+#include "utils.h"
+
+#define LOG_DIRECTORY_NAME "log"
+#define LEGACY_LOG_FILE_NAME "logtable"
+#define SEGMENT_FILE_FORMAT "%s/segment-%010d"
+#define SEGMENT_NAME_FORMAT "segment-%d%n"
+
+// Segments are rolled once they reach this size, so compaction deletes whole
+// files and truncation only ever rewrites the end of the last few
+#define SEGMENT_SIZE (4 * 1024 * 1024)
+
+#define PATH_SIZE 256
+#define INITIAL_NUM_SEGMENTS 16
+#define INITIAL_NUM_OFFSETS 64
+
+#define DIR_MODE 0755
+#define FILE_MODE 0644
+
+#define FILE_OPEN_ERROR -1
+
+// Entries of a segment have consecutive indices from firstIndex. offsets holds
+// the start of each entry followed by the end of the last one
+typedef struct Segment Segment;
+struct Segment {
+    int firstIndex;
+    int numEntries;
+    off_t *offsets;
+    int capacity;
+};
+
+static char logDirectory[PATH_SIZE];
+
+static Segment *segments;
+static int numSegments;
+static int segmentsCapacity;
+
+// Only the last segment is written to, and it stays open between appends
+static int activeFd = FILE_OPEN_ERROR;
+
+static LogSyncPolicy syncPolicy = LOG_SYNC_BATCH;
+static int syncIntervalMs = DEFAULT_LOG_SYNC_INTERVAL_MS;
+static bool unsynced;
+static struct timeval lastSyncTime;
+
+static LogStoreStats stats;
+
+void setLogSyncPolicy(LogSyncPolicy policy, int intervalMs) {
+    assert(intervalMs >= 0);
+    syncPolicy = policy;
+    syncIntervalMs = intervalMs;
+}
+
+bool parseLogSyncPolicy(const char *name, LogSyncPolicy *policy) {
+    if (strcmp(name, "always") == 0) {
+        *policy = LOG_SYNC_ALWAYS;
+    } else if (strcmp(name, "batch") == 0) {
+        *policy = LOG_SYNC_BATCH;
+    } else if (strcmp(name, "interval") == 0) {
+        *policy = LOG_SYNC_INTERVAL;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static void getSegmentPath(int firstIndex, char *dest, size_t size) {
+    int len = snprintf(dest, size, SEGMENT_FILE_FORMAT, logDirectory,
+                       firstIndex);
+    assert(len < size);
+}
+
+static void syncLogDirectory(void) {
+    int fd = open(logDirectory, O_RDONLY);
+    if (fd == FILE_OPEN_ERROR) {
+        LOG_PERROR("Failed to open log directory");
+    }
+    fsync(fd);
+    close(fd);
+}
+
+static Segment *lastSegment(void) {
+    return numSegments == 0 ? NULL : &segments[numSegments - 1];
+}
+
+static off_t segmentSize(Segment *segment) {
+    return segment->offsets[segment->numEntries];
+}
+
+static Segment *addSegment(int firstIndex) {
+    if (numSegments == segmentsCapacity) {
+        segmentsCapacity =
+            segmentsCapacity == 0 ? INITIAL_NUM_SEGMENTS : segmentsCapacity * 2;
+        segments = realloc(segments, sizeof(Segment) * segmentsCapacity);
+        assert(segments != NULL);
+    }
+
+    Segment *segment = &segments[numSegments++];
+    segment->firstIndex = firstIndex;
+    segment->numEntries = 0;
+    segment->capacity = INITIAL_NUM_OFFSETS;
+    segment->offsets = malloc(sizeof(off_t) * segment->capacity);
+    assert(segment->offsets != NULL);
+    segment->offsets[0] = 0;
+
+    return segment;
+}
+
+static void addOffset(Segment *segment, off_t end) {
+    if (segment->numEntries + 1 == segment->capacity) {
+        segment->capacity *= 2;
+        segment->offsets =
+            realloc(segment->offsets, sizeof(off_t) * segment->capacity);
+        assert(segment->offsets != NULL);
+    }
+    segment->offsets[++segment->numEntries] = end;
+}
+
+static void syncActiveSegment(void) {
+    if (!unsynced) return;
+
+    fdatasync(activeFd);
+    stats.syncs++;
+    unsynced = false;
+    gettimeofday(&lastSyncTime, NULL);
+}
+
+static void openActiveSegment(bool create) {
+    char path[PATH_SIZE];
+    getSegmentPath(lastSegment()->firstIndex, path, sizeof(path));
+
+    int flags = create ? O_WRONLY | O_CREAT | O_TRUNC : O_WRONLY;
+    activeFd = open(path, flags, FILE_MODE);
+    if (activeFd == FILE_OPEN_ERROR) {
+        LOG_PERROR("Failed to open log segment");
+    }
+
+    if (create) {
+        syncLogDirectory();
+    }
+}
+
+static void closeActiveSegment(void) {
+    if (activeFd == FILE_OPEN_ERROR) return;
+
+    syncActiveSegment();
+    close(activeFd);
+    activeFd = FILE_OPEN_ERROR;
+}
+
+static void removeLastSegment(void) {
+    // Entries of a removed segment need not reach disk
+    unsynced = false;
+    closeActiveSegment();
+
+    char path[PATH_SIZE];
+    getSegmentPath(lastSegment()->firstIndex, path, sizeof(path));
+    unlink(path);
+
+    free(lastSegment()->offsets);
+    numSegments--;
+}
+
+static void syncAfterWrite(void) {
+    unsynced = true;
+    if (syncPolicy == LOG_SYNC_INTERVAL) {
+        syncLogTableStore();
+    } else {
+        syncActiveSegment();
+    }
+}
+
+void syncLogTableStore(void) {
+    if (!unsynced) return;
+
+    struct timeval now;
+    struct timeval elapsed;
+    gettimeofday(&now, NULL);
+    timersub(&now, &lastSyncTime, &elapsed);
+
+    long elapsedMs = elapsed.tv_sec * 1000 + elapsed.tv_usec / 1000;
+    if (elapsedMs >= syncIntervalMs) {
+        syncActiveSegment();
+    }
+}
+
+bool getLogSyncDeadline(struct timeval *deadline) {
+    if (!unsynced) return false;
+
+    struct timeval interval = {
+        .tv_sec = syncIntervalMs / 1000,
+        .tv_usec = syncIntervalMs % 1000 * 1000,
+    };
+    timeradd(&lastSyncTime, &interval, deadline);
+    return true;
+}
+
+static LogEntry parseLogEntry(ReadBuff readBuff) {
+    LogEntry logEntry = malloc(sizeof(struct LogEntry));
+    assert(logEntry != NULL);
+
+    int ptrsCapacity = DEFAULT_PTRS_ARRAY_CAPACITY;
+    int ptrsSize = 0;
+    void **ptrs = malloc(ptrsCapacity * sizeof(void *));
+
+    LOG_ENTRY(PARSE, PARSE_STRING, PARSE_MALLOC, PARSE_FREE, logEntry);
+
+    free(ptrs);
+
+    return logEntry;
+}
+
+static EncodeRes encodeLogEntry(LogEntry logEntry) {
+    uint64_t size = 0;
+    uint64_t capacity = DEFAULT_ENCODE_BUFFER_CAPACITY;
+
+    uint8_t *buffBase = malloc(capacity);
+    assert(buffBase != NULL);
+
+    uint8_t *buff = buffBase;
+
+    LOG_ENTRY(ENCODE, ENCODE_STRING, ENCODE_MALLOC, ENCODE_FREE, logEntry);
+
+    EncodeRes res = malloc(sizeof(struct EncodeRes));
+    assert(res != NULL);
+    res->size = size;
+    res->buff = buffBase;
+
+    return res;
+}
+
+/**
+ * Read the entries of the last segment, recording their offsets and pushing
+ * those past the snapshot to l
+ * @return false if the segment ends in an incomplete entry or holds entries
+ * that do not follow on from the log, which are cut off
+ */
+static bool loadSegment(LogTable l) {
+    Segment *segment = lastSegment();
+    char path[PATH_SIZE];
+    getSegmentPath(segment->firstIndex, path, sizeof(path));
+
+    int fd = open(path, O_RDWR);
+    if (fd == FILE_OPEN_ERROR) {
+        LOG_PERROR("Failed to open log segment");
+    }
+
+    struct stat st;
+    fstat(fd, &st);
+    uint8_t *data = malloc(st.st_size + 1);
+    assert(data != NULL);
+    off_t bytesRead = 0;
+    while (bytesRead < st.st_size) {
+        ssize_t n = read(fd, data + bytesRead, st.st_size - bytesRead);
+        if (n <= 0) break;
+        bytesRead += n;
+    }
+
+    // Segment is read whole, so the buffer never refills from the descriptor
+    struct ReadBuff readBuff = {
+        .fd = FILE_OPEN_ERROR,
+        .base = data,
+        .buff = data,
+        .size = bytesRead,
+        .capacity = bytesRead,
+    };
+
+    bool complete = true;
+    while (readBuff.buff - data < bytesRead) {
+        off_t start = readBuff.buff - data;
+        LogEntry logEntry = parseLogEntry(&readBuff);
+        if (logEntry == NULL) {
+            complete = false;
+            break;
+        }
+
+        uint64_t size;
+        off_t end = readBuff.buff - data;
+        if (bytesRead - end < sizeof(size)) {
+            freeLogEntry(logEntry);
+            complete = false;
+            break;
+        }
+        memcpy(&size, readBuff.buff, sizeof(size));
+        readBuff.buff += sizeof(size);
+
+        int expectedIndex = segment->firstIndex + segment->numEntries;
+        bool followsLog = logEntry->logIndex <= logTableSnapshotIndex(l) ||
+                          logEntry->logIndex == logTableLength(l);
+        if (size != end - start || logEntry->logIndex != expectedIndex ||
+            !followsLog) {
+            freeLogEntry(logEntry);
+            complete = false;
+            break;
+        }
+
+        addOffset(segment, readBuff.buff - data);
+
+        // Segment may still hold entries compacted before the last ones
+        if (logEntry->logIndex <= logTableSnapshotIndex(l)) {
+            freeLogEntry(logEntry);
+        } else {
+            logTablePushDirect(l, logEntry);
+        }
+    }
+
+    if (!complete) {
+        LOG("Cutting log segment %s back to %d entries", path,
+            segment->numEntries);
+        ftruncate(fd, segmentSize(segment));
+        fdatasync(fd);
+    }
+
+    // Buffer is only replaced once an entry is known to be incomplete
+    if (readBuff.base != data) {
+        free(readBuff.base);
+    }
+    free(data);
+    close(fd);
+    return complete;
+}
+
+static int compareIndices(const void *a, const void *b) {
+    return *(const int *)a - *(const int *)b;
+}
+
+static int listSegments(int **firstIndices) {
+    DIR *dir = opendir(logDirectory);
+    if (dir == NULL) {
+        LOG_PERROR("Failed to open log directory");
+    }
+
+    int count = 0;
+    int capacity = INITIAL_NUM_SEGMENTS;
+    *firstIndices = malloc(sizeof(int) * capacity);
+    assert(*firstIndices != NULL);
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        int firstIndex;
+        int len = 0;
+        int matched =
+            sscanf(entry->d_name, SEGMENT_NAME_FORMAT, &firstIndex, &len);
+        if (matched != 1 || entry->d_name[len] != '\0') {
+            continue;
+        }
+
+        if (count == capacity) {
+            capacity *= 2;
+            *firstIndices = realloc(*firstIndices, sizeof(int) * capacity);
+            assert(*firstIndices != NULL);
+        }
+        (*firstIndices)[count++] = firstIndex;
+    }
+    closedir(dir);
+
+    qsort(*firstIndices, count, sizeof(int), compareIndices);
+    return count;
+}
+
+// Entries written before the store was split into segments are moved into
+// the first segment, after which the old file is removed
+static void migrateLegacyLogTable(LogTable l) {
+    char path[PATH_SIZE];
+    getNodeStorePath(LEGACY_LOG_FILE_NAME, path, sizeof(path));
+
+    int fd = open(path, O_RDONLY);
+    if (fd == FILE_OPEN_ERROR) return;
+
+    ReadBuff readBuff = createReadBuff(fd);
+    int firstIndex = logTableLength(l);
+    for (;;) {
+        LogEntry logEntry = parseLogEntry(readBuff);
+        if (logEntry == NULL) break;
+
+        if (logEntry->logIndex <= logTableSnapshotIndex(l)) {
+            freeLogEntry(logEntry);
+        } else {
+            logTablePushDirect(l, logEntry);
+        }
+
+        // Advance past the bytes storing the size of the log entry
+        if (checkReadBuff(readBuff, sizeof(uint64_t)) ==
+            CHECK_READ_BUFF_FAIL) {
+            break;
+        }
+        readBuff->buff += sizeof(uint64_t);
+    }
+    freeReadBuff(readBuff);
+    close(fd);
+
+    int numEntries = logTableLength(l) - firstIndex;
+    if (numEntries > 0) {
+        LogEntry entries[numEntries];
+        for (int i = 0; i < numEntries; i++) {
+            entries[i] = logTableGet(l, firstIndex + i);
+        }
+        pushLogTableStore(entries, numEntries);
+        syncActiveSegment();
+    }
+
+    unlink(path);
+    syncLogDirectory();
+}
+
+void loadLogTable(LogTable l) {
+    getNodeStorePath(LOG_DIRECTORY_NAME, logDirectory, sizeof(logDirectory));
+    if (mkdir(logDirectory, DIR_MODE) != 0 && errno != EEXIST) {
+        LOG_PERROR("Failed to create log directory");
+    }
+
+    int *firstIndices;
+    int count = listSegments(&firstIndices);
+
+    // Segments after one that was cut off were written before the crash that
+    // tore it and no longer follow on from the log
+    bool complete = true;
+    for (int i = 0; i < count; i++) {
+        Segment *prev = lastSegment();
+        bool follows = prev == NULL ||
+                       firstIndices[i] == prev->firstIndex + prev->numEntries;
+        if (complete && follows) {
+            addSegment(firstIndices[i]);
+            complete = loadSegment(l);
+            if (lastSegment()->numEntries == 0) {
+                removeLastSegment();
+            }
+        } else {
+            char path[PATH_SIZE];
+            getSegmentPath(firstIndices[i], path, sizeof(path));
+            unlink(path);
+            complete = false;
+        }
+    }
+    free(firstIndices);
+
+    // A crash may come between storing the snapshot and compacting the store
+    compactLogTableStore(logTableSnapshotIndex(l));
+
+    if (numSegments > 0) {
+        openActiveSegment(false);
+    } else {
+        migrateLegacyLogTable(l);
+    }
+    gettimeofday(&lastSyncTime, NULL);
+}
+
+static void writeActiveSegment(uint8_t *buff, size_t size, off_t offset) {
+    if (size == 0) return;
+
+    ssize_t bytesWritten = pwrite(activeFd, buff, size, offset);
+    if (bytesWritten != size) {
+        LOG_PERROR("Failed to write log entries");
+    }
+
+    // Segment is synced before it is closed on roll, whatever the policy
+    unsynced = true;
+}
+
+void pushLogTableStore(LogEntry *entries, int numEntries) {
+    uint8_t *buff = NULL;
+    size_t capacity = 0;
+    size_t size = 0;
+    off_t offset = 0;
+
+    // Entries of a segment are gathered into one buffer, so under the batch
+    // policy the batch costs one write and one sync however many it holds
+    for (int i = 0; i < numEntries; i++) {
+        Segment *segment = lastSegment();
+        if (segment == NULL || segmentSize(segment) >= SEGMENT_SIZE) {
+            writeActiveSegment(buff, size, offset);
+            size = 0;
+            closeActiveSegment();
+            segment = addSegment(entries[i]->logIndex);
+            openActiveSegment(true);
+            stats.rolls++;
+        } else if (activeFd == FILE_OPEN_ERROR) {
+            openActiveSegment(false);
+        }
+        assert(entries[i]->logIndex ==
+               segment->firstIndex + segment->numEntries);
+
+        if (size == 0) {
+            offset = segmentSize(segment);
+        }
+
+        EncodeRes res = encodeLogEntry(entries[i]);
+        size_t entrySize = res->size + sizeof(res->size);
+        if (size + entrySize > capacity) {
+            capacity = MAX(capacity * 2, size + entrySize);
+            buff = realloc(buff, capacity);
+            assert(buff != NULL);
+        }
+        memcpy(buff + size, res->buff, res->size);
+        memcpy(buff + size + res->size, &res->size, sizeof(res->size));
+        size += entrySize;
+        addOffset(segment, segmentSize(segment) + entrySize);
+        free(res->buff);
+        free(res);
+
+        if (syncPolicy == LOG_SYNC_ALWAYS) {
+            writeActiveSegment(buff, size, offset);
+            size = 0;
+            syncAfterWrite();
+        }
+    }
+
+    writeActiveSegment(buff, size, offset);
+    free(buff);
+    if (numEntries > 0) {
+        syncAfterWrite();
+    }
+}
+
+LogStoreStats getLogStoreStats(void) { return stats; }
+
+void truncateLogTableStore(int fromIndex) {
+    bool removed = false;
+    while (numSegments > 0 && lastSegment()->firstIndex >= fromIndex) {
+        removeLastSegment();
+        removed = true;
+    }
+    if (removed) {
+        syncLogDirectory();
+    }
+
+    Segment *segment = lastSegment();
+    if (segment == NULL ||
+        fromIndex >= segment->firstIndex + segment->numEntries) {
+        return;
+    }
+
+    if (activeFd == FILE_OPEN_ERROR) {
+        openActiveSegment(false);
+    }
+    segment->numEntries = fromIndex - segment->firstIndex;
+    if (ftruncate(activeFd, segmentSize(segment)) != 0) {
+        LOG_PERROR("Failed to truncate log segment");
+    }
+    syncAfterWrite();
+}
+
+void compactLogTableStore(int snapshotIndex) {
+    int numRemoved = 0;
+    while (numRemoved < numSegments) {
+        Segment *segment = &segments[numRemoved];
+        if (segment->firstIndex + segment->numEntries - 1 > snapshotIndex) {
+            break;
+        }
+
+        if (numRemoved == numSegments - 1) {
+            // Compacted entries need not reach disk
+            unsynced = false;
+            closeActiveSegment();
+        }
+
+        // Oldest segments are deleted first, so a crash leaves the store
+        // holding consecutive entries
+        char path[PATH_SIZE];
+        getSegmentPath(segment->firstIndex, path, sizeof(path));
+        unlink(path);
+        free(segment->offsets);
+        numRemoved++;
+    }
+
+    if (numRemoved == 0) return;
+
+    numSegments -= numRemoved;
+    memmove(segments, segments + numRemoved, sizeof(Segment) * numSegments);
+    syncLogDirectory();
+}
@@ -0,0 +1,89 @@
+#ifndef LOG_STORE_H
+#define LOG_STORE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/time.h>
+
+#include "raft/log-entry.h"
+#include "raft/log-table.h"
+
+#define DEFAULT_LOG_SYNC_INTERVAL_MS 10
+
+typedef struct LogStoreStats LogStoreStats;
+struct LogStoreStats {
+    size_t syncs;
+    size_t rolls;
+};
+
+typedef enum {
+    LOG_SYNC_ALWAYS,    // Sync after every entry
+    LOG_SYNC_BATCH,     // Sync once per appended batch
+    LOG_SYNC_INTERVAL,  // Sync at most once per interval
+} LogSyncPolicy;
+
+/**
+ * Set when appended entries are forced to disk. Entries not yet synced under
+ * LOG_SYNC_INTERVAL may be lost on a crash of the machine
+ * @param policy the sync policy
+ * @param intervalMs the minimum time between syncs under LOG_SYNC_INTERVAL
+ */
+extern void setLogSyncPolicy(LogSyncPolicy policy, int intervalMs);
+
+/**
+ * Read a sync policy from its name
+ * @param name one of "always", "batch" or "interval"
+ * @param policy set to the policy named
+ * @return false if the name is not a policy
+ */
+extern bool parseLogSyncPolicy(const char *name, LogSyncPolicy *policy);
+
+/**
+ * Open the log store of the node, initialising the passed in log table with
+ * the stored entries past its snapshot. Segments torn by a crash are cut back
+ * to their last complete entry
+ * @param l the log table to initialise
+ */
+extern void loadLogTable(LogTable l);
+
+/**
+ * Append log entries to the last segment of the store, rolling to a new
+ * segment once it is full, and sync them according to the sync policy
+ * @param entries the log entries to append, in order of index
+ * @param numEntries the number of entries
+ */
+extern void pushLogTableStore(LogEntry *entries, int numEntries);
+
+/**
+ * Remove the stored entries from fromIndex onwards, using the offsets held for
+ * each segment rather than reading the store
+ * @param fromIndex the index of the first entry to remove
+ */
+extern void truncateLogTableStore(int fromIndex);
+
+/**
+ * Delete the segments holding only entries compacted into the snapshot
+ * @param snapshotIndex the last index included in the snapshot
+ */
+extern void compactLogTableStore(int snapshotIndex);
+
+/**
+ * Sync entries appended under LOG_SYNC_INTERVAL once the interval has passed
+ * since the last sync
+ */
+extern void syncLogTableStore(void);
+
+/**
+ * Returns the number of segment syncs and of segments started since the store
+ * was opened
+ */
+extern LogStoreStats getLogStoreStats(void);
+
+/**
+ * Get the time by which entries appended under LOG_SYNC_INTERVAL are synced
+ * @param deadline set to the time of the next sync
+ * @return false if there are no entries waiting to be synced
+ */
+extern bool getLogSyncDeadline(struct timeval *deadline);
+
+#endif  // LOG_STORE_H
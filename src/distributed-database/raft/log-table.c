@@ -1,17 +1,24 @@
 #include "log-table.h"
 
 #include <assert.h>
+#include <string.h>
 
 #include "log.h"
 #include "persistent-store.h"
+#include "raft/log-store.h"
 #include "raft/log-entry.h"
+#include "utils.h"
 
 #define INITIAL_CAPACITY 128
 
+// Entries up to snapshotIndex are compacted into the snapshot, so the entry
+// at index i is held at i - snapshotIndex - 1 and indices stay stable
 struct LogTable {
     size_t length;
     size_t capacity;
     LogEntry *logEntries;
+    int snapshotIndex;
+    int snapshotTerm;
 };
 
 LogTable createLogTable() {
@@ -23,6 +30,7 @@ LogTable createLogTable() {
     l->logEntries = malloc(sizeof(LogEntry) * l->capacity);
     assert(l->logEntries != NULL);
 
+    readStoredSnapshotInfo(&l->snapshotIndex, &l->snapshotTerm);
     loadLogTable(l);
 
     return l;
@@ -38,11 +46,12 @@ void freeLogTable(LogTable l) {
 }
 
 LogEntry logTableGet(LogTable l, size_t index) {
-    if (index < 0 || index >= l->length) {
+    int idx = index;
+    if (idx <= l->snapshotIndex || idx >= logTableLength(l)) {
         return NULL;
     }
 
-    return l->logEntries[index];
+    return l->logEntries[idx - l->snapshotIndex - 1];
 }
 
 static void resize(LogTable l) {
@@ -56,7 +65,7 @@ static void resize(LogTable l) {
 }
 
 void logTablePushDirect(LogTable l, LogEntry entry) {
-    assert(entry->logIndex == l->length);
+    assert(entry->logIndex == logTableLength(l));
 
     if (l->length >= l->capacity) {
         resize(l);
@@ -66,14 +75,64 @@ void logTablePushDirect(LogTable l, LogEntry entry) {
 }
 
 void logTablePush(LogTable l, LogEntry entry) {
-    logTablePushDirect(l, entry);
-    pushLogTableStore(entry);
+    logTablePushBatch(l, &entry, 1);
 }
 
-void logTablePop(LogTable l) {
-    l->length--;
-    freeLogEntry(l->logEntries[l->length]);
-    popLogTableStore();
+void logTablePushBatch(LogTable l, LogEntry *entries, int numEntries) {
+    if (numEntries == 0) return;
+
+    for (int i = 0; i < numEntries; i++) {
+        logTablePushDirect(l, entries[i]);
+    }
+    pushLogTableStore(entries, numEntries);
 }
 
-int logTableLength(LogTable l) { return l->length; }
+void logTablePop(LogTable l) { logTableTruncate(l, logTableLength(l) - 1); }
+
+void logTableTruncate(LogTable l, int fromIndex) {
+    // Compacted entries are committed and never removed
+    assert(fromIndex > l->snapshotIndex);
+    if (fromIndex >= logTableLength(l)) return;
+
+    size_t newLength = fromIndex - l->snapshotIndex - 1;
+    for (size_t i = newLength; i < l->length; i++) {
+        freeLogEntry(l->logEntries[i]);
+    }
+    l->length = newLength;
+    truncateLogTableStore(fromIndex);
+}
+
+int logTableLength(LogTable l) { return l->snapshotIndex + 1 + l->length; }
+
+int logTableSnapshotIndex(LogTable l) { return l->snapshotIndex; }
+
+int logTableSnapshotTerm(LogTable l) { return l->snapshotTerm; }
+
+int logTableTerm(LogTable l, int index) {
+    if (index == l->snapshotIndex) {
+        return l->snapshotTerm;
+    }
+
+    LogEntry entry = logTableGet(l, index);
+    return entry == NULL ? UNKNOWN_TERM : entry->term;
+}
+
+void logTableCompact(LogTable l, int index, int term) {
+    assert(index > l->snapshotIndex);
+
+    // Snapshot past the end of the log replaces every entry
+    size_t numCompacted = MIN(index - l->snapshotIndex, (int)l->length);
+    for (size_t i = 0; i < numCompacted; i++) {
+        freeLogEntry(l->logEntries[i]);
+    }
+
+    l->length -= numCompacted;
+    memmove(l->logEntries, l->logEntries + numCompacted,
+            sizeof(LogEntry) * l->length);
+    l->snapshotIndex = index;
+    l->snapshotTerm = term;
+
+    // Snapshot becomes current before the entries it includes are discarded
+    storeSnapshotInfo(index, term);
+    compactLogTableStore(index);
+}
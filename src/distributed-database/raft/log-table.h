@@ -5,6 +5,9 @@
 
 #include "log-entry.h"
 
+// Term of an index that is neither held in the log nor its snapshot
+#define UNKNOWN_TERM (-1)
+
 typedef struct LogTable *LogTable;
 
 extern LogTable createLogTable(void);
@@ -13,7 +16,57 @@ extern void freeLogTable(LogTable l);
 extern LogEntry logTableGet(LogTable l, size_t index);
 extern void logTablePushDirect(LogTable l, LogEntry entry);
 extern void logTablePush(LogTable l, LogEntry entry);
+
+/**
+ * Append entries to the log, persisting them with a single write and sync
+ * @param l the log table
+ * @param entries the entries to append, in order of index
+ * @param numEntries the number of entries
+ */
+extern void logTablePushBatch(LogTable l, LogEntry *entries, int numEntries);
 extern void logTablePop(LogTable l);
+
+/**
+ * Remove the entries from fromIndex onwards in memory and in persistent
+ * storage
+ * @param l the log table
+ * @param fromIndex the index of the first entry to remove, which must be past
+ * the snapshot
+ */
+extern void logTableTruncate(LogTable l, int fromIndex);
 extern int logTableLength(LogTable l);
 
+/**
+ * Get the index of the last entry compacted into the snapshot
+ * @param l the log table
+ * @return the last included index, or -1 if the log was never compacted
+ */
+extern int logTableSnapshotIndex(LogTable l);
+
+/**
+ * Get the term of the last entry compacted into the snapshot
+ * @param l the log table
+ * @return the last included term, or 0 if the log was never compacted
+ */
+extern int logTableSnapshotTerm(LogTable l);
+
+/**
+ * Get the term of the entry at index, which may be the last entry compacted
+ * into the snapshot
+ * @param l the log table
+ * @param index the index of the entry
+ * @return the term of the entry or UNKNOWN_TERM if it is not held
+ */
+extern int logTableTerm(LogTable l, int index);
+
+/**
+ * Record a snapshot holding the entries up to and including index, then
+ * discard those entries in memory and in persistent storage. Indices of the
+ * remaining entries are unchanged
+ * @param l the log table
+ * @param index the last index included in the snapshot
+ * @param term the term of the entry at index
+ */
+extern void logTableCompact(LogTable l, int index, int term);
+
 #endif  // LOG_TABLE_H
@@ -5,6 +5,7 @@
 #include <fcntl.h>
 #include <math.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -13,17 +14,18 @@
 #include <unistd.h>
 
 #include "log.h"
-#include "networking/rpc.h"
-#include "raft/log-table.h"
 #include "raft/raft-node.h"
-#include "table/operations/operation.h"
 
 #define FILE_PATH_BASE "./raft-db/"
-#define CURRENT_TERM_FILE_NAME "/currentterm"
-#define VOTED_FOR_FILE_NAME "/votedfor"
-#define COMMIT_INDEX_FILE_NAME "/commitindex"
-#define LOG_TABLE_FILE_NAME "/logtable"
-#define NODE_STATE_FILE_NAME "/nodestate"
+#define CURRENT_TERM_FILE_NAME "currentterm"
+#define VOTED_FOR_FILE_NAME "votedfor"
+#define COMMIT_INDEX_FILE_NAME "commitindex"
+#define NODE_STATE_FILE_NAME "nodestate"
+#define METADATA_FILE_NAME "metadata"
+#define SNAPSHOT_FILE_NAME "/snapshot"
+#define SNAPSHOT_DIRECTORY_FORMAT "%s%d/snapshot-%d"
+#define NODE_STORE_PATH_FORMAT "%s%d/%s"
+#define TEMP_FILE_SUFFIX ".tmp"
 
 #define BUFFER_SIZE 128
 
@@ -31,83 +33,70 @@
 
 #define DEFAULT_CURRENT_TERM 0
 #define DEFAULT_COMMIT_INDEX -1
+#define DEFAULT_SNAPSHOT_INDEX -1
+#define DEFAULT_SNAPSHOT_TERM 0
 
-#define FILE_OPEN_ERROR -1
-#define FILE_WRITE_ERROR -1
+#define NUM_METADATA_SLOTS 2
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME 16777619u
 
-static char *currentTermFilePath;
-static char *votedForFilePath;
-static char *commitIndexFilePath;
-static char *logTableFilePath;
-static char *nodeStateFilePath;
-
-void initFilePaths(int nodeId) {
-    int nodeIdCharacters = nodeId == 0 ? 1 : (int)log10(nodeId) + 1;
+#define FILE_MODE 0644
 
-    currentTermFilePath = malloc((strlen(FILE_PATH_BASE) + nodeIdCharacters +
-                                  strlen(CURRENT_TERM_FILE_NAME)) *
-                                     sizeof(char) +
-                                 1);
-    assert(currentTermFilePath != NULL);
-    sprintf(currentTermFilePath, "%s%d%s", FILE_PATH_BASE, nodeId,
-            CURRENT_TERM_FILE_NAME);
-    votedForFilePath = malloc((strlen(FILE_PATH_BASE) + nodeIdCharacters +
-                               strlen(VOTED_FOR_FILE_NAME)) *
-                                  sizeof(char) +
-                              1);
-    assert(votedForFilePath != NULL);
-    sprintf(votedForFilePath, "%s%d%s", FILE_PATH_BASE, nodeId,
-            VOTED_FOR_FILE_NAME);
-    commitIndexFilePath = malloc((strlen(FILE_PATH_BASE) + nodeIdCharacters +
-                                  strlen(COMMIT_INDEX_FILE_NAME)) *
-                                     sizeof(char) +
-                                 1);
-    assert(commitIndexFilePath != NULL);
-    sprintf(commitIndexFilePath, "%s%d%s", FILE_PATH_BASE, nodeId,
-            COMMIT_INDEX_FILE_NAME);
-    logTableFilePath = malloc((strlen(FILE_PATH_BASE) + nodeIdCharacters +
-                               strlen(LOG_TABLE_FILE_NAME)) *
-                                  sizeof(char) +
-                              1);
-    assert(logTableFilePath);
-    sprintf(logTableFilePath, "%s%d%s", FILE_PATH_BASE, nodeId,
-            LOG_TABLE_FILE_NAME);
-    nodeStateFilePath = malloc((strlen(FILE_PATH_BASE) + nodeIdCharacters +
-                                strlen(NODE_STATE_FILE_NAME)) *
-                                   sizeof(char) +
-                               1);
-    assert(nodeStateFilePath);
-    sprintf(nodeStateFilePath, "%s%d%s", FILE_PATH_BASE, nodeId,
-            NODE_STATE_FILE_NAME);
-}
-
-static void writeNumToFile(const char *filePath, const int num) {
-    FILE *file = fopen(filePath, "wb");
+#define FILE_OPEN_ERROR -1
+#define FILE_WRITE_ERROR -1
 
-    if (file == NULL) {
-        LOG_PERROR("Failed to open file");
+static char *snapshotFilePath;
+static int storeNodeId;
+
+// Each write goes to the slot not holding the last synced record, so a torn
+// or unsynced write never loses it. The valid slot with the higher sequence
+// number is current
+typedef struct MetadataRecord MetadataRecord;
+struct MetadataRecord {
+    uint64_t sequence;
+    int32_t currentTerm;
+    int32_t votedFor;
+    int32_t commitIndex;
+    int32_t state;
+    uint32_t checksum;
+    uint32_t padding;
+};
+
+static MetadataRecord metadata;
+static int metadataFd = FILE_OPEN_ERROR;
+static int syncedSlot;
+
+static uint32_t getChecksum(const MetadataRecord *record) {
+    // FNV-1a over the fields before the checksum
+    const uint8_t *bytes = (const uint8_t *)record;
+    uint32_t hash = FNV_OFFSET_BASIS;
+    for (size_t i = 0; i < offsetof(MetadataRecord, checksum); i++) {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
     }
-
-    fwrite(&num, sizeof(num), 1, file);
-
-    fclose(file);
+    return hash;
 }
 
-void storeCurrentTerm(int currentTerm) {
-    writeNumToFile(currentTermFilePath, currentTerm);
-}
+static void writeMetadata(bool sync) {
+    int slot = 1 - syncedSlot;
+    metadata.sequence++;
+    metadata.checksum = getChecksum(&metadata);
 
-void storeVotedFor(int votedFor) { writeNumToFile(votedForFilePath, votedFor); }
+    ssize_t bytesWritten = pwrite(metadataFd, &metadata, sizeof(metadata),
+                                  slot * sizeof(metadata));
+    if (bytesWritten != sizeof(metadata)) {
+        LOG_PERROR("Failed to write metadata");
+    }
 
-void storeCommitIndex(int commitIndex) {
-    writeNumToFile(commitIndexFilePath, commitIndex);
+    if (sync) {
+        fdatasync(metadataFd);
+        syncedSlot = slot;
+    }
 }
 
-void storeNodeState(RaftNodeState state) {
-    writeNumToFile(nodeStateFilePath, state);
-}
+static int readLegacyNum(const char *fileName, const int defaultValue) {
+    char filePath[BUFFER_SIZE];
+    getNodeStorePath(fileName, filePath, sizeof(filePath));
 
-static int readStoredCurrentNum(const char *filePath, const int defaultValue) {
     FILE *file = fopen(filePath, "rb");
 
     if (file == NULL && errno == ENOENT) {
@@ -126,107 +115,172 @@ static int readStoredCurrentNum(const char *filePath, const int defaultValue) {
     return eof ? defaultValue : output;
 }
 
-int readStoredCurrentTerm(void) {
-    return readStoredCurrentNum(currentTermFilePath, DEFAULT_CURRENT_TERM);
+static void removeLegacyFile(const char *fileName) {
+    char filePath[BUFFER_SIZE];
+    getNodeStorePath(fileName, filePath, sizeof(filePath));
+    unlink(filePath);
 }
 
-int readStoredVotedFor(void) {
-    return readStoredCurrentNum(votedForFilePath, NULL_NODE_ID);
-}
+static void loadMetadata(void) {
+    char filePath[BUFFER_SIZE];
+    getNodeStorePath(METADATA_FILE_NAME, filePath, sizeof(filePath));
 
-int readStoredCommitIndex(void) {
-    return readStoredCurrentNum(commitIndexFilePath, DEFAULT_COMMIT_INDEX);
-}
-
-static LogEntry parseLogEntry(ReadBuff readBuff) {
-    LogEntry logEntry = malloc(sizeof(struct LogEntry));
-    assert(logEntry != NULL);
-
-    int ptrsCapacity = DEFAULT_PTRS_ARRAY_CAPACITY;
-    int ptrsSize = 0;
-    void **ptrs = malloc(ptrsCapacity * sizeof(void *));
+    metadataFd = open(filePath, O_RDWR | O_CREAT, FILE_MODE);
+    if (metadataFd == FILE_OPEN_ERROR) {
+        LOG_PERROR("Failed to open metadata file");
+    }
 
-    LOG_ENTRY(PARSE, PARSE_STRING, PARSE_MALLOC, PARSE_FREE, logEntry);
+    MetadataRecord slots[NUM_METADATA_SLOTS];
+    ssize_t bytesRead = pread(metadataFd, slots, sizeof(slots), 0);
+
+    bool found = false;
+    for (int i = 0; i < NUM_METADATA_SLOTS; i++) {
+        if (bytesRead < (i + 1) * (ssize_t)sizeof(MetadataRecord) ||
+            slots[i].checksum != getChecksum(&slots[i])) {
+            continue;
+        }
+        if (!found || slots[i].sequence > metadata.sequence) {
+            metadata = slots[i];
+            syncedSlot = i;
+            found = true;
+        }
+    }
+    if (found) return;
 
-    free(ptrs);
+    // The first record always goes to slot 0, so a file no longer than one
+    // record never held a synced record and was torn while being created.
+    // Starting over from term 0 otherwise could vote twice in a term
+    if (bytesRead > (ssize_t)sizeof(MetadataRecord)) {
+        LOG_ERROR("Metadata file %s holds no valid record", filePath);
+    }
 
-    return logEntry;
+    // Values stored one per file before the metadata record was introduced
+    // are moved into it, and only removed once the record is synced
+    metadata.sequence = 0;
+    metadata.currentTerm =
+        readLegacyNum(CURRENT_TERM_FILE_NAME, DEFAULT_CURRENT_TERM);
+    metadata.votedFor = readLegacyNum(VOTED_FOR_FILE_NAME, NULL_NODE_ID);
+    metadata.commitIndex =
+        readLegacyNum(COMMIT_INDEX_FILE_NAME, DEFAULT_COMMIT_INDEX);
+    metadata.state = readLegacyNum(NODE_STATE_FILE_NAME, FOLLOWER);
+    metadata.padding = 0;
+    syncedSlot = 1;
+    writeMetadata(true);
+
+    removeLegacyFile(CURRENT_TERM_FILE_NAME);
+    removeLegacyFile(VOTED_FOR_FILE_NAME);
+    removeLegacyFile(COMMIT_INDEX_FILE_NAME);
+    removeLegacyFile(NODE_STATE_FILE_NAME);
 }
 
-void loadLogTable(LogTable l) {
-    int fd = open(logTableFilePath, O_RDONLY | O_CREAT);
-    if (fd == FILE_OPEN_ERROR) {
-        LOG_PERROR("Failed to open log table file");
-    }
+void initFilePaths(int nodeId) {
+    storeNodeId = nodeId;
+    int nodeIdCharacters = nodeId == 0 ? 1 : (int)log10(nodeId) + 1;
 
-    ReadBuff readBuff = createReadBuff(fd);
+    snapshotFilePath = malloc((strlen(FILE_PATH_BASE) + nodeIdCharacters +
+                               strlen(SNAPSHOT_FILE_NAME)) *
+                                  sizeof(char) +
+                              1);
+    assert(snapshotFilePath);
+    sprintf(snapshotFilePath, "%s%d%s", FILE_PATH_BASE, nodeId,
+            SNAPSHOT_FILE_NAME);
 
-    for (;;) {
-        LogEntry logEntry = parseLogEntry(readBuff);
-        if (logEntry == NULL) break;
+    loadMetadata();
+}
 
-        logTablePushDirect(l, logEntry);
+static void getTempPath(const char *filePath, char *dest, size_t size) {
+    int len = snprintf(dest, size, "%s%s", filePath, TEMP_FILE_SUFFIX);
+    assert(len < size);
+}
 
-        // Advance past the bytes storing the size of the log entry
-        checkReadBuff(readBuff, sizeof(uint64_t));
-        readBuff->buff += sizeof(uint64_t);
+static void replaceFile(const char *tempPath, const char *filePath) {
+    if (rename(tempPath, filePath) != 0) {
+        LOG_PERROR("Failed to replace file");
     }
-
-    free(readBuff);
-    close(fd);
 }
 
-static EncodeRes encodeLogEntry(LogEntry logEntry) {
-    uint64_t size = 0;
-    uint64_t capacity = DEFAULT_ENCODE_BUFFER_CAPACITY;
+void storeTermAndVote(int currentTerm, int votedFor) {
+    metadata.currentTerm = currentTerm;
+    metadata.votedFor = votedFor;
+    writeMetadata(true);
+}
 
-    uint8_t *buffBase = malloc(capacity);
-    assert(buffBase != NULL);
+void storeVotedFor(int votedFor) {
+    metadata.votedFor = votedFor;
+    writeMetadata(true);
+}
 
-    uint8_t *buff = buffBase;
+void storeCommitIndex(int commitIndex) {
+    if (commitIndex == metadata.commitIndex) return;
 
-    LOG_ENTRY(ENCODE, ENCODE_STRING, ENCODE_MALLOC, ENCODE_FREE, logEntry);
+    // Commit index is recovered from the tables and the leader, so it is
+    // synced with the next term or vote rather than on every commit
+    metadata.commitIndex = commitIndex;
+    writeMetadata(false);
+}
 
-    EncodeRes res = malloc(sizeof(struct EncodeRes));
-    assert(res != NULL);
-    res->size = size;
-    res->buff = buffBase;
+void storeNodeState(RaftNodeState state) {
+    if (state == metadata.state) return;
 
-    return res;
+    // Node always restarts as a follower, so the state is never synced
+    metadata.state = state;
+    writeMetadata(false);
 }
 
-void pushLogTableStore(LogEntry logEntry) {
-    EncodeRes res = encodeLogEntry(logEntry);
+int readStoredCurrentTerm(void) { return metadata.currentTerm; }
+
+int readStoredVotedFor(void) { return metadata.votedFor; }
 
-    int fd = open(logTableFilePath, O_WRONLY | O_APPEND);
+int readStoredCommitIndex(void) { return metadata.commitIndex; }
+
+void storeSnapshotInfo(int lastIndex, int lastTerm) {
+    char tempPath[BUFFER_SIZE];
+    getTempPath(snapshotFilePath, tempPath, sizeof(tempPath));
+
+    int fd = open(tempPath, O_WRONLY | O_CREAT | O_TRUNC, FILE_MODE);
     if (fd == FILE_OPEN_ERROR) {
-        LOG_PERROR("Failed to open log table file");
+        LOG_PERROR("Failed to open snapshot file");
     }
 
-    write(fd, res->buff, res->size);
-    write(fd, (uint8_t *)&res->size, sizeof(res->size));
-
+    // Index and term are replaced together, so that a crash never leaves the
+    // index of one snapshot with the term of another
+    int info[] = {lastIndex, lastTerm};
+    write(fd, info, sizeof(info));
+    fsync(fd);
     close(fd);
-    free(res->buff);
-    free(res);
+
+    replaceFile(tempPath, snapshotFilePath);
 }
 
-void popLogTableStore(void) {
-    int fd = open(logTableFilePath, O_RDWR);
+void readStoredSnapshotInfo(int *lastIndex, int *lastTerm) {
+    *lastIndex = DEFAULT_SNAPSHOT_INDEX;
+    *lastTerm = DEFAULT_SNAPSHOT_TERM;
+
+    int fd = open(snapshotFilePath, O_RDONLY);
+    if (fd == FILE_OPEN_ERROR && errno == ENOENT) {
+        return;
+    }
     if (fd == FILE_OPEN_ERROR) {
-        LOG_PERROR("Failed to open log table file");
+        LOG_PERROR("Failed to open snapshot file");
     }
 
-    long filesize = lseek(fd, 0, SEEK_END);
-    assert(filesize >= sizeof(uint64_t));
+    int info[2];
+    if (read(fd, info, sizeof(info)) == sizeof(info)) {
+        *lastIndex = info[0];
+        *lastTerm = info[1];
+    }
 
-    lseek(fd, -sizeof(uint64_t), SEEK_END);
-    uint64_t size;
-    long bytesRead = read(fd, &size, sizeof(size));
-    assert(bytesRead == sizeof(size));
+    close(fd);
+}
 
-    off_t newSize = filesize - sizeof(size) - size;
-    assert(newSize >= 0);
+void getSnapshotDirectory(int lastIndex, char *dest, size_t size) {
+    int len = snprintf(dest, size, SNAPSHOT_DIRECTORY_FORMAT, FILE_PATH_BASE,
+                       storeNodeId, lastIndex);
+    assert(len < size);
+}
 
-    ftruncate(fd, newSize);
+void getNodeStorePath(const char *fileName, char *dest, size_t size) {
+    int len = snprintf(dest, size, NODE_STORE_PATH_FORMAT, FILE_PATH_BASE,
+                       storeNodeId, fileName);
+    assert(len < size);
 }
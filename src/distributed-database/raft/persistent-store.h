@@ -6,16 +6,19 @@
 #include "raft/raft-node.h"
 
 /**
- * Initialise the file paths for the specified node id
+ * Initialise the file paths for the specified node id and load its metadata
+ * record
  * @param nodeId the node id to specify the persistent storage file paths for
  */
 extern void initFilePaths(int nodeId);
 
 /**
- * Write the currentTerm to persistent storage
+ * Write the currentTerm and votedFor to persistent storage with a single
+ * write and sync
  * @param currentTerm the current term to write to persistent storage
+ * @param votedFor the node id voted for in currentTerm
  */
-extern void storeCurrentTerm(int currentTerm);
+extern void storeTermAndVote(int currentTerm, int votedFor);
 
 /**
  * Read the currentTerm from the store or default value if it can't be read
@@ -36,10 +39,16 @@ extern void storeVotedFor(int votedFor);
  */
 extern int readStoredVotedFor(void);
 
+/**
+ * Record the state of the node without forcing it to disk, as the node always
+ * restarts as a follower
+ * @param state the state of the node
+ */
 extern void storeNodeState(RaftNodeState state);
 
 /**
- * Write the commitIndex to persistent storage
+ * Write the commitIndex to persistent storage. It is only forced to disk with
+ * the next term or vote, as a lost commit index is recovered on restart
  * @param commitIndex the commit index to write to persistent storage
  */
 extern void storeCommitIndex(int commitIndex);
@@ -51,22 +60,35 @@ extern void storeCommitIndex(int commitIndex);
 extern int readStoredCommitIndex(void);
 
 /**
- * Initialise the passed in log table with the stored log table in persistent
- * storage
- * @param l the log table to initialise with the log entries in persistent
- * storage
+ * Write the index and term of the last entry included in the snapshot to
+ * persistent storage, replacing the previous ones atomically
+ * @param lastIndex the last index included in the snapshot
+ * @param lastTerm the term of the entry at lastIndex
+ */
+extern void storeSnapshotInfo(int lastIndex, int lastTerm);
+
+/**
+ * Read the index and term of the last entry included in the snapshot, or the
+ * default values if no snapshot was taken
+ * @param lastIndex set to the last index included in the snapshot
+ * @param lastTerm set to the term of the entry at lastIndex
  */
-extern void loadLogTable(LogTable l);
+extern void readStoredSnapshotInfo(int *lastIndex, int *lastTerm);
 
 /**
- * Push the log entry to the persistent storage
- * @param l the log entry to push to persistent storage
+ * Get the directory holding the table files of the snapshot at lastIndex
+ * @param lastIndex the last index included in the snapshot
+ * @param dest buffer to write the path to
+ * @param size size of dest
  */
-extern void pushLogTableStore(LogEntry l);
+extern void getSnapshotDirectory(int lastIndex, char *dest, size_t size);
 
 /**
- * Pop the last log entry from persistent storage
+ * Get the path of a file or directory in the persistent storage of the node
+ * @param fileName the name of the file within the storage of the node
+ * @param dest buffer to write the path to
+ * @param size size of dest
  */
-extern void popLogTableStore(void);
+extern void getNodeStorePath(const char *fileName, char *dest, size_t size);
 
 #endif  // PERSISTENT_STORE_H
@@ -9,6 +9,8 @@
 #include "raft-node.h"
 #include "raft/log-table.h"
 #include "raft/persistent-store.h"
+#include "raft/snapshot.h"
+#include "table/core/wal.h"
 
 #define TO_STR(x) #x
 
@@ -24,9 +26,31 @@ void initRaftNode(int id, int numNodes) {
     node->currentTerm = readStoredCurrentTerm();
     node->log = createLogTable();
     node->commitIndex = readStoredCommitIndex();
+
+    // Tables may hold entries past the stored commit index, which is written
+    // after the entries are applied
+    node->lastApplied = recoverTables(node->commitIndex);
+    if (node->lastApplied > node->commitIndex) {
+        node->commitIndex = node->lastApplied;
+        storeCommitIndex(node->commitIndex);
+    }
+
+    // A crash while installing a snapshot from the leader leaves the tables
+    // behind the snapshot
+    if (node->lastApplied < logTableSnapshotIndex(node->log)) {
+        restoreSnapshot();
+        node->lastApplied = logTableSnapshotIndex(node->log);
+        if (node->lastApplied > node->commitIndex) {
+            node->commitIndex = node->lastApplied;
+            storeCommitIndex(node->commitIndex);
+        }
+    }
+
     node->numVotes = 0;
     node->nextIndex = createIntList();
     node->matchIndex = createIntList();
+    node->replication = calloc(numNodes, sizeof(Replication));
+    assert(node->replication != NULL);
 
     setInteractionTime();
 
@@ -40,6 +64,13 @@ void initRaftNode(int id, int numNodes) {
     pthread_mutexattr_init(&node->raftNodeLockAttr);
     pthread_mutexattr_settype(&node->raftNodeLockAttr, PTHREAD_MUTEX_RECURSIVE);
     pthread_mutex_init(&node->raftNodeLock, &node->raftNodeLockAttr);
+
+    // Committed entries lost from the tables by a crash are applied again
+    for (int i = node->lastApplied + 1; i <= node->commitIndex; i++) {
+        LOG("REAPPLYING Operation at index %d", i);
+        applyOperation(logTableGet(node->log, i)->operation, i);
+    }
+    node->lastApplied = node->commitIndex;
 }
 
 void setInteractionTime() {
@@ -94,17 +125,24 @@ void setCommitIndex(int newCommitIndex) {
         LOG("INCREASE COMMIT INDEX TO %d", newCommitIndex);
     for (int i = node->commitIndex + 1; i <= newCommitIndex; i++) {
         LOG("EXECUTING Operation at index %d", i);
-        executeOperation(logTableGet(node->log, i)->operation);
+        applyOperation(logTableGet(node->log, i)->operation, i);
+        node->lastApplied = i;
         LOG("FINISHED EXECUTING Operation at index %d", i);
     }
     node->commitIndex = newCommitIndex;
     storeCommitIndex(newCommitIndex);
+
+    if (node->lastApplied - logTableSnapshotIndex(node->log) >=
+        SNAPSHOT_INTERVAL) {
+        takeSnapshot();
+    }
     releaseRaftNodeLock();
 }
 
-void setCurrentTerm(int currentTerm) {
+void setCurrentTerm(int currentTerm, int votedFor) {
     node->currentTerm = currentTerm;
-    storeCurrentTerm(currentTerm);
+    node->votedFor = votedFor;
+    storeTermAndVote(currentTerm, votedFor);
 }
 
 void setVotedFor(int votedFor) {
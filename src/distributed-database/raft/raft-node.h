@@ -11,6 +11,30 @@
 
 typedef enum { FOLLOWER, CANDIDATE, LEADER } RaftNodeState;
 
+// Number of AppendEntries carrying entries that may be sent to a follower
+// before the first of them is answered
+#define MAX_IN_FLIGHT 8
+
+// AppendEntries carrying entries, identified by the entries it carries
+typedef struct InFlightBatch InFlightBatch;
+struct InFlightBatch {
+    int prevLogIndex;
+    int numEntries;
+};
+
+/**
+ * Progress of the leader replicating its log to a follower, beyond nextIndex
+ * and matchIndex. Responses are only counted against batches in the window,
+ * so responses to batches sent before it was last cleared are told apart and
+ * ignored
+ */
+typedef struct Replication Replication;
+struct Replication {
+    InFlightBatch inFlight[MAX_IN_FLIGHT];  // Not yet answered, oldest first
+    int numInFlight;
+    struct timeval lastProgressTime;  // Last response, or first send after none
+};
+
 typedef struct RaftNode *RaftNode;
 struct RaftNode {
     int id;
@@ -29,6 +53,7 @@ struct RaftNode {
     int numVotes;
     IntList nextIndex;
     IntList matchIndex;
+    Replication *replication;
 
     struct timeval lastInteractionTime;
     int numNodes;
@@ -87,11 +112,12 @@ extern void setLeaderId(int leaderId);
 extern void setCommitIndex(int newCommitIndex);
 
 /**
- * Set the currentTerm for the node. Stores the currentTerm in persistent
- * storage
+ * Set the currentTerm for the node along with votedFor in that term. Stores
+ * both in persistent storage with a single write
  * @param currentTerm the current term to set the node to
+ * @param votedFor the node voted for in currentTerm, or NULL_NODE_ID
  */
-extern void setCurrentTerm(int currentTerm);
+extern void setCurrentTerm(int currentTerm, int votedFor);
 
 /**
  * Set votedFor for the node. Stores votedFor in persistent storage
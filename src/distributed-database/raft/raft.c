@@ -1,38 +1,120 @@
 #include "raft/raft.h"
 
 #include <assert.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/time.h>
 #include <time.h>
-#include <unistd.h>
 
 #include "int-list.h"
 #include "log.h"
 #include "networking/send.h"
 #include "raft/elections.h"
 #include "raft/log-entry.h"
+#include "raft/log-store.h"
 #include "raft/log-table.h"
 #include "raft/raft-node.h"
+#include "raft/snapshot.h"
 #include "utils.h"
 
 #define MAX_NUM_ENTRIES (1 << 8)
 
-#define MAIN_THREAD_SLEEP_US 5000
+// Time without responses after which entries in flight are presumed lost
+#define IN_FLIGHT_TIMEOUT_US 500000
 
-void runAppendEntries(int followerId) {
-    acquireRaftNodeLock();
-    int prevLogIndex = intListGet(node->nextIndex, followerId) - 1;
-    int numEntries =
-        MIN(MAX_NUM_ENTRIES, logTableLength(node->log) - prevLogIndex - 1);
+// Default time between heartbeats, well below the minimum election timeout
+#define DEFAULT_HEARTBEAT_INTERVAL_MS 50
+
+// Client operations collected into one log append and one AppendEntries per
+// follower
+static LogEntry pendingEntries[MAX_NUM_ENTRIES];
+static int numPending = 0;
+static struct timeval batchDeadline;
+
+// Client waiting for the batch holding its operation to be appended or
+// dropped
+typedef struct PendingRequest PendingRequest;
+struct PendingRequest {
+    bool done;
+    bool appended;
+};
+
+static PendingRequest *pendingRequests[MAX_NUM_ENTRIES];
+static pthread_cond_t batchFinished = PTHREAD_COND_INITIALIZER;
+
+static pthread_cond_t raftWakeup = PTHREAD_COND_INITIALIZER;
+static int heartbeatIntervalMs = DEFAULT_HEARTBEAT_INTERVAL_MS;
+static struct timeval nextHeartbeatTime;
+
+static void sendEntries(int followerId, int prevLogIndex, int numEntries) {
     LogEntry *entries =
         numEntries == 0 ? NULL : malloc(sizeof(LogEntry) * numEntries);
     for (int i = 0; i < numEntries; i++) {
         entries[i] = logTableGet(node->log, prevLogIndex + 1 + i);
     }
-    int prevLogTerm =
-        prevLogIndex == -1 ? 0 : logTableGet(node->log, prevLogIndex)->term;
+    int prevLogTerm = logTableTerm(node->log, prevLogIndex);
     sendAppendEntries(followerId, node->currentTerm, prevLogIndex, prevLogTerm,
                       node->commitIndex, numEntries, entries);
+}
+
+static long getMicrosSince(struct timeval *start) {
+    struct timeval time;
+    gettimeofday(&time, NULL);
+    timersub(&time, start, &time);
+    return time.tv_sec * 1000000 + time.tv_usec;
+}
+
+void runAppendEntries(int followerId) {
+    acquireRaftNodeLock();
+    Replication *replication = &node->replication[followerId];
+
+    // Responses are lost with the connection, so entries are sent again from
+    // the last one known to match
+    if (replication->numInFlight > 0 &&
+        getMicrosSince(&replication->lastProgressTime) >=
+            IN_FLIGHT_TIMEOUT_US) {
+        LOG("Entries in flight to follower %d timed out", followerId);
+        intListSet(node->nextIndex, followerId,
+                   intListGet(node->matchIndex, followerId) + 1);
+        replication->numInFlight = 0;
+    }
+
+    // Entries before the snapshot can no longer be sent, so the follower is
+    // sent the snapshot instead
+    if (intListGet(node->nextIndex, followerId) - 1 <
+        logTableSnapshotIndex(node->log)) {
+        sendSnapshot(followerId);
+        releaseRaftNodeLock();
+        return;
+    }
+
+    // nextIndex advances as entries are sent rather than as they are
+    // acknowledged, so batches are streamed to the follower without waiting
+    // a round trip for each
+    bool sentEntries = false;
+    while (replication->numInFlight < MAX_IN_FLIGHT) {
+        int prevLogIndex = intListGet(node->nextIndex, followerId) - 1;
+        int numEntries =
+            MIN(MAX_NUM_ENTRIES, logTableLength(node->log) - prevLogIndex - 1);
+        if (numEntries <= 0) break;
+
+        sendEntries(followerId, prevLogIndex, numEntries);
+        intListSet(node->nextIndex, followerId, prevLogIndex + numEntries + 1);
+        if (replication->numInFlight == 0) {
+            gettimeofday(&replication->lastProgressTime, NULL);
+        }
+        replication->inFlight[replication->numInFlight++] = (InFlightBatch){
+            .prevLogIndex = prevLogIndex,
+            .numEntries = numEntries,
+        };
+        sentEntries = true;
+    }
+
+    // Heartbeat holds no entries, so it is never counted as in flight
+    if (!sentEntries) {
+        sendEntries(followerId, intListGet(node->nextIndex, followerId) - 1, 0);
+    }
     releaseRaftNodeLock();
 }
 
@@ -88,11 +170,155 @@ static int modPow(int a, int b, int m) {
     return sub;
 }
 
+static void finishPendingRequests(bool appended) {
+    for (int i = 0; i < numPending; i++) {
+        pendingRequests[i]->done = true;
+        pendingRequests[i]->appended = appended;
+    }
+    numPending = 0;
+    pthread_cond_broadcast(&batchFinished);
+}
+
+static void discardPendingEntries(void) {
+    LOG("Dropping %d operations collected before losing leadership",
+        numPending);
+    for (int i = 0; i < numPending; i++) {
+        freeLogEntry(pendingEntries[i]);
+    }
+    finishPendingRequests(false);
+}
+
+static void flushPendingEntries(void) {
+    if (numPending == 0) return;
+
+    // Indices of entries collected in an earlier term may have been taken
+    if (node->state != LEADER ||
+        pendingEntries[0]->term != node->currentTerm) {
+        discardPendingEntries();
+        return;
+    }
+
+    LOG("Pushing %d operations from index %d to leader log", numPending,
+        pendingEntries[0]->logIndex);
+    logTablePushBatch(node->log, pendingEntries, numPending);
+    intListSet(node->matchIndex, node->id,
+               pendingEntries[numPending - 1]->logIndex);
+    finishPendingRequests(true);
+
+    sendAllAppendEntries();
+    wakeRaftMain();
+}
+
+bool appendClientOperation(Operation operation) {
+    acquireRaftNodeLock();
+    if (node->state != LEADER) {
+        releaseRaftNodeLock();
+        return false;
+    }
+
+    if (numPending > 0 && pendingEntries[0]->term != node->currentTerm) {
+        discardPendingEntries();
+    }
+
+    if (numPending == 0) {
+        struct timeval time;
+        gettimeofday(&time, NULL);
+        struct timeval window = {.tv_sec = 0,
+                                 .tv_usec = GROUP_COMMIT_WINDOW_US};
+        timeradd(&time, &window, &batchDeadline);
+        // Raft thread sleeps past the deadline until woken
+        wakeRaftMain();
+    }
+
+    PendingRequest request = {.done = false, .appended = false};
+    pendingRequests[numPending] = &request;
+    pendingEntries[numPending] = createLogEntry(
+        node->currentTerm, logTableLength(node->log) + numPending, operation);
+    numPending++;
+
+    if (numPending == MAX_NUM_ENTRIES) {
+        flushPendingEntries();
+    }
+
+    // Lock is held once here, so waiting releases it for the raft thread
+    while (!request.done) {
+        pthread_cond_wait(&batchFinished, &node->raftNodeLock);
+    }
+    releaseRaftNodeLock();
+    return request.appended;
+}
+
+static void flushExpiredBatch(void) {
+    if (numPending == 0) return;
+
+    struct timeval time;
+    gettimeofday(&time, NULL);
+    if (node->state == LEADER && timercmp(&time, &batchDeadline, <)) {
+        return;
+    }
+
+    flushPendingEntries();
+}
+
+void wakeRaftMain(void) { pthread_cond_signal(&raftWakeup); }
+
+void setHeartbeatInterval(int intervalMs) {
+    assert(intervalMs > 0);
+    heartbeatIntervalMs = intervalMs;
+}
+
+static void sendHeartbeats(void) {
+    struct timeval time;
+    gettimeofday(&time, NULL);
+    if (timercmp(&time, &nextHeartbeatTime, <)) {
+        return;
+    }
+
+    sendAllAppendEntries();
+
+    struct timeval interval = {
+        .tv_sec = heartbeatIntervalMs / 1000,
+        .tv_usec = heartbeatIntervalMs % 1000 * 1000,
+    };
+    timeradd(&time, &interval, &nextHeartbeatTime);
+}
+
+// Sleeps until the next heartbeat or election timeout, unless woken earlier
+static void waitForEvent(void) {
+    struct timeval deadline;
+    if (node->state == LEADER) {
+        deadline = nextHeartbeatTime;
+    } else {
+        getElectionDeadline(&deadline);
+    }
+
+    // Batch collected before losing leadership is dropped without waiting for
+    // the election timeout, so its clients can retry
+    if (numPending > 0 && timercmp(&batchDeadline, &deadline, <)) {
+        deadline = batchDeadline;
+    }
+
+    struct timeval syncDeadline;
+    if (getLogSyncDeadline(&syncDeadline) &&
+        timercmp(&syncDeadline, &deadline, <)) {
+        deadline = syncDeadline;
+    }
+
+    struct timespec wakeupTime = {
+        .tv_sec = deadline.tv_sec,
+        .tv_nsec = deadline.tv_usec * 1000,
+    };
+    pthread_cond_timedwait(&raftWakeup, &node->raftNodeLock, &wakeupTime);
+}
+
 static void raftMain(void) {
     srand(time(NULL) * modPow(node->id, primes[node->id % 6], 10000));
     setElectionTimeout();
+
+    // Lock is only released while waiting, so wakeups signalled by other
+    // threads holding it are never missed
+    acquireRaftNodeLock();
     for (;;) {
-        acquireRaftNodeLock();
         if (node->state == CANDIDATE) {
             if (checkElectionWon()) {
                 electionWon();
@@ -103,12 +329,13 @@ static void raftMain(void) {
             commenceElection();
         }
 
+        flushExpiredBatch();
+        syncLogTableStore();
         if (node->state == LEADER) {
             updateCommitIndex();
-            sendAllAppendEntries();
+            sendHeartbeats();
         }
-        releaseRaftNodeLock();
-        usleep(MAIN_THREAD_SLEEP_US);
+        waitForEvent();
     }
 }
 
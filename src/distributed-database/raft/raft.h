@@ -1,12 +1,44 @@
 #ifndef RAFT_MAIN_H
 #define RAFT_MAIN_H
 
+#include <stdbool.h>
+
+#include "table/operations/operation.h"
+
+// Time for which client operations are collected before they are appended to
+// the log together
+#define GROUP_COMMIT_WINDOW_US 1000
+
 /**
- * Calls appendEntries send functions with correct parameters
+ * Sends the follower entries from nextIndex, in batches until MAX_IN_FLIGHT
+ * are unanswered, or a heartbeat if there are none to send
  * @param followerId the follower node's id to send the append entries to
  */
 extern void runAppendEntries(int followerId);
 
+/**
+ * Add a client operation to the batch of entries the leader appends to its
+ * log together, once the batch fills or GROUP_COMMIT_WINDOW_US after its
+ * first operation, and wait until the batch is appended and persisted. Must
+ * not be called with the raft node lock held
+ * @param operation the client operation
+ * @return false if the node is not the leader, or the batch was dropped on
+ * losing leadership before it was appended
+ */
+extern bool appendClientOperation(Operation operation);
+
+/**
+ * Wake the raft thread to act on a change, such as new entries in the log or
+ * a response from another node. Must be called with the raft node lock held
+ */
+extern void wakeRaftMain(void);
+
+/**
+ * Set the time between heartbeats sent by the leader
+ * @param intervalMs the heartbeat interval in milliseconds
+ */
+extern void setHeartbeatInterval(int intervalMs);
+
 /**
  * The main thread function for raft
  * Does not accept parameters in or return anything
@@ -0,0 +1,397 @@
+#include "raft/snapshot.h"
+
+#include <assert.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "int-list.h"
+#include "log.h"
+#include "networking/send.h"
+#include "raft/log-table.h"
+#include "raft/persistent-store.h"
+#include "raft/raft-node.h"
+#include "table/catalog.h"
+#include "utils.h"
+
+#define SNAPSHOT_PATH_SIZE 128
+#define DIR_MODE 0755
+#define FILE_MODE 0644
+#define STAGING_SUFFIX ".part"
+#define TAKING_DIRECTORY_NAME "snapshot-new" STAGING_SUFFIX
+
+// Progress of the leader sending its snapshot to a follower
+typedef struct SnapshotTransfer SnapshotTransfer;
+struct SnapshotTransfer {
+    int lastIndex;  // Index of snapshot being sent, or -1 if none
+    int fileIdx;    // Position of next chunk to send
+    int offset;
+    int numBytes;  // Size of outstanding chunk
+    bool outstanding;
+    struct timeval sentTime;
+};
+
+static SnapshotTransfer *transfers = NULL;
+
+// Progress of the follower receiving a snapshot from the leader
+static int receivingIndex = -1;
+static int receivingFileIdx = 0;
+static int receivedBytes = 0;  // Bytes received of the current file
+
+static bool takingSnapshot = false;
+
+static void removeDirectory(char *path) {
+    DIR *dir = opendir(path);
+    if (dir == NULL) {
+        return;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+
+        char filePath[SNAPSHOT_PATH_SIZE + MAX_FILE_NAME_LEN];
+        snprintf(filePath, sizeof(filePath), "%s/%s", path, entry->d_name);
+        unlink(filePath);
+    }
+
+    closedir(dir);
+    rmdir(path);
+}
+
+static void getStagingDirectory(int lastIndex, char *dest, size_t size) {
+    getSnapshotDirectory(lastIndex, dest, size);
+    assert(strlen(dest) + strlen(STAGING_SUFFIX) < size);
+    strcat(dest, STAGING_SUFFIX);
+}
+
+static int isSnapshotFile(const struct dirent *entry) {
+    return entry->d_name[0] != '.';
+}
+
+static void freeFileNames(struct dirent **names, int numFiles) {
+    for (int i = 0; i < numFiles; i++) {
+        free(names[i]);
+    }
+    free(names);
+}
+
+static void *runSnapshot(void *arg) {
+    char stagingPath[SNAPSHOT_PATH_SIZE];
+    getNodeStorePath(TAKING_DIRECTORY_NAME, stagingPath, sizeof(stagingPath));
+
+    // Leftovers of a snapshot interrupted by a crash are replaced
+    removeDirectory(stagingPath);
+    if (mkdir(stagingPath, DIR_MODE) != 0) {
+        LOG_PERROR("Failed to create snapshot directory");
+    }
+
+    // Files are copied without the raft lock, so entries applied meanwhile
+    // are included up to the checkpoint the copies are taken at
+    int lastIndex = snapshotCatalog(stagingPath);
+
+    acquireRaftNodeLock();
+    takingSnapshot = false;
+
+    // A snapshot installed from the leader meanwhile may already include it
+    int oldIndex = logTableSnapshotIndex(node->log);
+    if (lastIndex <= oldIndex) {
+        removeDirectory(stagingPath);
+        releaseRaftNodeLock();
+        return NULL;
+    }
+
+    char path[SNAPSHOT_PATH_SIZE];
+    getSnapshotDirectory(lastIndex, path, sizeof(path));
+    removeDirectory(path);
+    if (rename(stagingPath, path) != 0) {
+        LOG_PERROR("Failed to rename snapshot directory");
+    }
+
+    int lastTerm = logTableTerm(node->log, lastIndex);
+    logTableCompact(node->log, lastIndex, lastTerm);
+
+    if (oldIndex != -1) {
+        getSnapshotDirectory(oldIndex, path, sizeof(path));
+        removeDirectory(path);
+    }
+
+    LOG("Took snapshot up to index %d of term %d", lastIndex, lastTerm);
+    releaseRaftNodeLock();
+    return NULL;
+}
+
+void takeSnapshot(void) {
+    acquireRaftNodeLock();
+    if (takingSnapshot) {
+        releaseRaftNodeLock();
+        return;
+    }
+    takingSnapshot = true;
+    releaseRaftNodeLock();
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, runSnapshot, NULL);
+    pthread_detach(thread);
+}
+
+static SnapshotTransfer *getTransfer(int followerId) {
+    if (transfers == NULL) {
+        transfers = malloc(sizeof(SnapshotTransfer) * node->numNodes);
+        assert(transfers != NULL);
+        for (int i = 0; i < node->numNodes; i++) {
+            transfers[i].lastIndex = -1;
+        }
+    }
+
+    return &transfers[followerId];
+}
+
+static void sendChunk(int followerId, SnapshotTransfer *transfer) {
+    char path[SNAPSHOT_PATH_SIZE];
+    getSnapshotDirectory(transfer->lastIndex, path, sizeof(path));
+
+    // Files are sent in order of name, so that positions are the same on
+    // every call
+    struct dirent **names;
+    int numFiles = scandir(path, &names, isSnapshotFile, alphasort);
+    if (numFiles < 0) {
+        LOG_PERROR("Failed to read snapshot directory");
+    }
+
+    char *fileName = strdup("");
+    uint8_t *data = NULL;
+    int numBytes = 0;
+    bool done = true;
+
+    if (numFiles > 0) {
+        assert(transfer->fileIdx < numFiles);
+        free(fileName);
+        fileName = strdup(names[transfer->fileIdx]->d_name);
+
+        char filePath[SNAPSHOT_PATH_SIZE + MAX_FILE_NAME_LEN];
+        snprintf(filePath, sizeof(filePath), "%s/%s", path, fileName);
+        int fd = open(filePath, O_RDONLY);
+        if (fd < 0) {
+            LOG_PERROR("Failed to open snapshot file");
+        }
+
+        struct stat fileStat;
+        fstat(fd, &fileStat);
+
+        data = malloc(SNAPSHOT_CHUNK_SIZE);
+        assert(data != NULL);
+        ssize_t numRead =
+            pread(fd, data, SNAPSHOT_CHUNK_SIZE, transfer->offset);
+        assert(numRead >= 0);
+        close(fd);
+
+        numBytes = numRead;
+        done = transfer->fileIdx == numFiles - 1 &&
+               transfer->offset + numBytes >= fileStat.st_size;
+    }
+
+    freeFileNames(names, numFiles);
+
+    sendInstallSnapshot(followerId, node->currentTerm, transfer->lastIndex,
+                        logTableSnapshotTerm(node->log), transfer->fileIdx,
+                        fileName, transfer->offset, numBytes, data, done);
+
+    transfer->numBytes = numBytes;
+    transfer->outstanding = true;
+    gettimeofday(&transfer->sentTime, NULL);
+}
+
+void sendSnapshot(int followerId) {
+    acquireRaftNodeLock();
+    SnapshotTransfer *transfer = getTransfer(followerId);
+
+    // A newer snapshot replaces the one being sent, whose files are removed
+    int lastIndex = logTableSnapshotIndex(node->log);
+    if (transfer->lastIndex != lastIndex) {
+        LOG("Sending snapshot up to index %d to follower %d", lastIndex,
+            followerId);
+        transfer->lastIndex = lastIndex;
+        transfer->fileIdx = 0;
+        transfer->offset = 0;
+        transfer->outstanding = false;
+    }
+
+    if (transfer->outstanding) {
+        struct timeval time;
+        gettimeofday(&time, NULL);
+        timersub(&time, &transfer->sentTime, &time);
+        if (time.tv_sec * 1000000 + time.tv_usec < SNAPSHOT_RESEND_US) {
+            releaseRaftNodeLock();
+            return;
+        }
+    }
+
+    sendChunk(followerId, transfer);
+    releaseRaftNodeLock();
+}
+
+void acknowledgeSnapshotChunk(int followerId, int lastIndex, int fileIdx,
+                              int offset, bool success, bool done) {
+    acquireRaftNodeLock();
+    SnapshotTransfer *transfer = getTransfer(followerId);
+
+    if (done) {
+        transfer->lastIndex = -1;
+        releaseRaftNodeLock();
+        return;
+    }
+
+    // Responses to chunks sent again or to an older snapshot are ignored
+    if (!transfer->outstanding || lastIndex != transfer->lastIndex ||
+        fileIdx != transfer->fileIdx ||
+        offset != transfer->offset + transfer->numBytes) {
+        releaseRaftNodeLock();
+        return;
+    }
+
+    if (!success) {
+        transfer->fileIdx = 0;
+        transfer->offset = 0;
+    } else if (transfer->numBytes < SNAPSHOT_CHUNK_SIZE) {
+        // A short chunk ends its file
+        transfer->fileIdx++;
+        transfer->offset = 0;
+    } else {
+        transfer->offset = offset;
+    }
+
+    sendChunk(followerId, transfer);
+    releaseRaftNodeLock();
+}
+
+bool receiveSnapshotChunk(int lastIndex, int fileIdx, char *fileName,
+                          int offset, int numBytes, uint8_t *data) {
+    char path[SNAPSHOT_PATH_SIZE];
+    getStagingDirectory(lastIndex, path, sizeof(path));
+
+    if (fileIdx == 0 && offset == 0) {
+        // Files of a snapshot received partly are discarded
+        removeDirectory(path);
+        if (mkdir(path, DIR_MODE) != 0) {
+            LOG_PERROR("Failed to create snapshot directory");
+        }
+        receivingIndex = lastIndex;
+        receivingFileIdx = 0;
+        receivedBytes = 0;
+    } else if (lastIndex != receivingIndex) {
+        return false;
+    } else if (fileIdx == receivingFileIdx + 1 && offset == 0) {
+        receivingFileIdx = fileIdx;
+        receivedBytes = 0;
+    } else if (fileIdx != receivingFileIdx || offset > receivedBytes) {
+        // Chunks are written in order, though a chunk may be sent again
+        return false;
+    }
+
+    if (fileName[0] == '\0') {
+        return true;
+    }
+
+    if (strchr(fileName, '/') != NULL) {
+        LOG("Snapshot file name %s is not in the snapshot directory",
+            fileName);
+        return false;
+    }
+
+    char filePath[SNAPSHOT_PATH_SIZE + MAX_FILE_NAME_LEN];
+    snprintf(filePath, sizeof(filePath), "%s/%s", path, fileName);
+    int fd = open(filePath, O_WRONLY | O_CREAT, FILE_MODE);
+    if (fd < 0) {
+        LOG_PERROR("Failed to open snapshot file");
+    }
+
+    ssize_t numWritten = pwrite(fd, data, numBytes, offset);
+    assert(numWritten == numBytes);
+    close(fd);
+
+    receivedBytes = MAX(receivedBytes, offset + numBytes);
+    return true;
+}
+
+static void syncSnapshotFiles(char *path) {
+    DIR *dir = opendir(path);
+    assert(dir != NULL);
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+
+        char filePath[SNAPSHOT_PATH_SIZE + MAX_FILE_NAME_LEN];
+        snprintf(filePath, sizeof(filePath), "%s/%s", path, entry->d_name);
+        int fd = open(filePath, O_RDONLY);
+        assert(fd >= 0);
+        fsync(fd);
+        close(fd);
+    }
+
+    closedir(dir);
+}
+
+void installSnapshot(int lastIndex, int lastTerm) {
+    acquireRaftNodeLock();
+
+    char stagingPath[SNAPSHOT_PATH_SIZE];
+    char path[SNAPSHOT_PATH_SIZE];
+    getStagingDirectory(lastIndex, stagingPath, sizeof(stagingPath));
+    getSnapshotDirectory(lastIndex, path, sizeof(path));
+
+    // Snapshot only becomes visible under its name once every file is on
+    // disk
+    syncSnapshotFiles(stagingPath);
+    removeDirectory(path);
+    if (rename(stagingPath, path) != 0) {
+        LOG_PERROR("Failed to rename snapshot directory");
+    }
+    receivingIndex = -1;
+
+    int oldIndex = logTableSnapshotIndex(node->log);
+    if (logTableTerm(node->log, lastIndex) != lastTerm) {
+        // Entries conflicting with the snapshot were never committed
+        logTableTruncate(node->log, oldIndex + 1);
+    }
+
+    // Tables are restored after the snapshot is stored as current, so a crash
+    // in between restores them again on restart
+    logTableCompact(node->log, lastIndex, lastTerm);
+    restoreCatalog(path, lastIndex);
+
+    node->lastApplied = lastIndex;
+    if (node->commitIndex < lastIndex) {
+        node->commitIndex = lastIndex;
+        storeCommitIndex(lastIndex);
+    }
+
+    if (oldIndex != -1) {
+        getSnapshotDirectory(oldIndex, path, sizeof(path));
+        removeDirectory(path);
+    }
+
+    LOG("Installed snapshot up to index %d of term %d", lastIndex, lastTerm);
+    releaseRaftNodeLock();
+}
+
+void restoreSnapshot(void) {
+    int lastIndex = logTableSnapshotIndex(node->log);
+
+    char path[SNAPSHOT_PATH_SIZE];
+    getSnapshotDirectory(lastIndex, path, sizeof(path));
+    restoreCatalog(path, lastIndex);
+
+    LOG("Restored tables from snapshot up to index %d", lastIndex);
+}
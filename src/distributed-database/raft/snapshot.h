@@ -0,0 +1,77 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Number of applied entries after which the log is compacted into a snapshot
+#define SNAPSHOT_INTERVAL 1024
+
+// Number of bytes of a snapshot file sent in each InstallSnapshot message
+#define SNAPSHOT_CHUNK_SIZE (64 * 1024)
+
+// Time after which a chunk that has not been acknowledged is sent again
+#define SNAPSHOT_RESEND_US 500000
+
+/**
+ * Start copying the table files holding every applied entry into a new
+ * snapshot on a separate thread, unless one is already being taken. Once
+ * copied, the snapshot is tagged with the index and term of the last entry
+ * it holds, and the log entries it includes and the previous snapshot are
+ * discarded
+ */
+extern void takeSnapshot(void);
+
+/**
+ * Send the next chunk of the current snapshot to a follower that needs
+ * entries compacted into it. Only one chunk is outstanding at a time, and it
+ * is sent again if it is not acknowledged in time
+ * @param followerId the follower node to send the chunk to
+ */
+extern void sendSnapshot(int followerId);
+
+/**
+ * Handle acknowledgement of the outstanding chunk sent to a follower,
+ * sending the following chunk, or restarting the snapshot if the follower
+ * rejected it
+ * @param followerId the follower node that received the chunk
+ * @param lastIndex the last index included in the snapshot
+ * @param fileIdx the position of the file of the chunk
+ * @param offset the end of the chunk in its file
+ * @param success indicates if the follower wrote the chunk
+ * @param done indicates if the follower has installed the snapshot
+ */
+extern void acknowledgeSnapshotChunk(int followerId, int lastIndex,
+                                     int fileIdx, int offset, bool success,
+                                     bool done);
+
+/**
+ * Write a chunk sent by the leader into the snapshot being received. The
+ * first chunk of a snapshot starts it over, and others must continue it
+ * @param lastIndex the last index included in the snapshot
+ * @param fileIdx the position of the file among the snapshot files
+ * @param fileName the name of the file
+ * @param offset the offset of the chunk in the file
+ * @param numBytes the number of bytes in the chunk
+ * @param data the bytes of the chunk
+ * @return true if the chunk was written
+ */
+extern bool receiveSnapshotChunk(int lastIndex, int fileIdx, char *fileName,
+                                 int offset, int numBytes, uint8_t *data);
+
+/**
+ * Make the fully received snapshot current, replacing the tables with its
+ * files and the log entries it includes. Later entries are kept only if the
+ * log holds the last entry of the snapshot
+ * @param lastIndex the last index included in the snapshot
+ * @param lastTerm the term of the last entry included in the snapshot
+ */
+extern void installSnapshot(int lastIndex, int lastTerm);
+
+/**
+ * Copy the files of the current snapshot over the tables, for tables left
+ * behind the snapshot by a crash during installSnapshot
+ */
+extern void restoreSnapshot(void);
+
+#endif  // SNAPSHOT_H
@@ -12,10 +12,14 @@
 #include "log.h"
 #include "networking/rpc.h"
 #include "networking/worker.h"
+#include "raft/log-store.h"
 #include "raft/raft-node.h"
 #include "raft/raft.h"
 
 #define DIR_MODE 0755
+#define HEARTBEAT_INTERVAL_VAR "RAFT_HEARTBEAT_INTERVAL_MS"
+#define LOG_SYNC_POLICY_VAR "RAFT_LOG_SYNC_POLICY"
+#define LOG_SYNC_INTERVAL_VAR "RAFT_LOG_SYNC_INTERVAL_MS"
 
 int start(int argc, char **argv) {
     if (argc < 3) {
@@ -67,6 +71,38 @@ int start(int argc, char **argv) {
     sprintf(dir, "raft-db/%d/data", nodeId);
     mkdir(dir, DIR_MODE);
 
+    char *heartbeatInterval = getenv(HEARTBEAT_INTERVAL_VAR);
+    if (heartbeatInterval != NULL) {
+        int intervalMs;
+        if (sscanf(heartbeatInterval, "%d", &intervalMs) != 1 ||
+            intervalMs <= 0) {
+            fprintf(stderr, "Failed to read heartbeat interval from %s\n",
+                    heartbeatInterval);
+            return EXIT_FAILURE;
+        }
+        setHeartbeatInterval(intervalMs);
+    }
+
+    LogSyncPolicy syncPolicy = LOG_SYNC_BATCH;
+    int syncIntervalMs = DEFAULT_LOG_SYNC_INTERVAL_MS;
+    char *syncPolicyName = getenv(LOG_SYNC_POLICY_VAR);
+    if (syncPolicyName != NULL &&
+        !parseLogSyncPolicy(syncPolicyName, &syncPolicy)) {
+        fprintf(stderr, "Failed to read log sync policy from %s\n",
+                syncPolicyName);
+        return EXIT_FAILURE;
+    }
+    char *syncInterval = getenv(LOG_SYNC_INTERVAL_VAR);
+    if (syncInterval != NULL) {
+        if (sscanf(syncInterval, "%d", &syncIntervalMs) != 1 ||
+            syncIntervalMs < 0) {
+            fprintf(stderr, "Failed to read log sync interval from %s\n",
+                    syncInterval);
+            return EXIT_FAILURE;
+        }
+    }
+    setLogSyncPolicy(syncPolicy, syncIntervalMs);
+
     LOG("Starting RPC server as node %d (out of %d nodes)", nodeId, nodeCount);
 
     signal(SIGINT, cleanUpServer);
@@ -0,0 +1,378 @@
+#include "catalog.h"
+
+#include <assert.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "core/bufferPool.h"
+#include "core/freeSpaceMap.h"
+#include "core/wal.h"
+#include "index/tableIndexes.h"
+
+#define SCHEMA_SUFFIX "-schema"
+#define SPACE_INVENTORY_SUFFIX "-space-inventory"
+#define TABLE_FILE_SUFFIX "." DB_EXTENSION
+#define INDEX_FILE_SUFFIX ".idx"
+
+typedef struct CatalogEntry *CatalogEntry;
+struct CatalogEntry {
+    char name[MAX_TABLE_NAME_LEN];
+    TableInfo table;
+    Schema *schema;  // Parsed schema for relations, or NULL if not loaded
+    bool used;       // Whether the table was used since the last commit
+    CatalogEntry next;
+    CatalogEntry nextUsed;
+};
+
+static CatalogEntry entries = NULL;
+
+// Tables used since the last commit, the only ones an operation can change
+static CatalogEntry usedEntries = NULL;
+static pthread_rwlock_t catalogLock = PTHREAD_RWLOCK_INITIALIZER;
+
+// Readers sharing the catalog may open tables and load schemas concurrently
+static pthread_mutex_t entriesLock = PTHREAD_MUTEX_INITIALIZER;
+
+void lockCatalog() { pthread_rwlock_wrlock(&catalogLock); }
+
+void lockCatalogShared() { pthread_rwlock_rdlock(&catalogLock); }
+
+void unlockCatalog() { pthread_rwlock_unlock(&catalogLock); }
+
+static CatalogEntry findEntry(char *tableName) {
+    for (CatalogEntry entry = entries; entry != NULL; entry = entry->next) {
+        if (strcmp(entry->name, tableName) == 0) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+static CatalogEntry getEntry(char *tableName) {
+    CatalogEntry entry = findEntry(tableName);
+
+    if (entry != NULL) {
+        return entry;
+    }
+
+    assert(strlen(tableName) < MAX_TABLE_NAME_LEN);
+
+    entry = malloc(sizeof(struct CatalogEntry));
+    assert(entry != NULL);
+
+    strcpy(entry->name, tableName);
+    entry->table = NULL;
+    entry->schema = NULL;
+    entry->used = false;
+    entry->nextUsed = NULL;
+    entry->next = entries;
+    entries = entry;
+
+    return entry;
+}
+
+static void freeEntry(CatalogEntry entry) {
+    if (entry->table != NULL) {
+        closeTable(entry->table);
+    }
+
+    if (entry->schema != NULL) {
+        freeSchema(entry->schema);
+    }
+
+    free(entry);
+}
+
+static void removeUsedEntry(CatalogEntry entry) {
+    if (!entry->used) {
+        return;
+    }
+
+    CatalogEntry *curr = &usedEntries;
+    while (*curr != entry) {
+        curr = &(*curr)->nextUsed;
+    }
+    *curr = entry->nextUsed;
+}
+
+static void removeEntry(char *tableName) {
+    CatalogEntry *curr = &entries;
+
+    while (*curr != NULL) {
+        if (strcmp((*curr)->name, tableName) == 0) {
+            CatalogEntry entry = *curr;
+            *curr = entry->next;
+            removeUsedEntry(entry);
+            freeEntry(entry);
+            return;
+        }
+        curr = &(*curr)->next;
+    }
+}
+
+static void freeEntries(void) {
+    while (entries != NULL) {
+        CatalogEntry entry = entries;
+        entries = entry->next;
+        freeEntry(entry);
+    }
+
+    usedEntries = NULL;
+}
+
+static TableInfo loadTable(char *tableName) {
+    CatalogEntry entry = getEntry(tableName);
+
+    if (entry->table == NULL) {
+        entry->table = openTable(tableName);
+    }
+
+    if (!entry->used) {
+        entry->used = true;
+        entry->nextUsed = usedEntries;
+        usedEntries = entry;
+    }
+
+    return entry->table;
+}
+
+static Schema *loadSchema(char *tableName) {
+    CatalogEntry entry = getEntry(tableName);
+
+    if (entry->schema != NULL) {
+        return entry->schema;
+    }
+
+    char schemaName[MAX_TABLE_NAME_LEN];
+    snprintf(schemaName, sizeof(schemaName), "%s%s", tableName,
+             SCHEMA_SUFFIX);
+
+    // Schema table is only read once so its handle is not kept
+    TableInfo schemaInfo = openTable(schemaName);
+    entry->schema = getSchema(schemaInfo);
+    closeTable(schemaInfo);
+
+    return entry->schema;
+}
+
+TableInfo getCatalogTable(char *tableName) {
+    pthread_mutex_lock(&entriesLock);
+    TableInfo tableInfo = loadTable(tableName);
+    pthread_mutex_unlock(&entriesLock);
+
+    return tableInfo;
+}
+
+Schema *getCatalogSchema(char *tableName) {
+    pthread_mutex_lock(&entriesLock);
+    Schema *schema = loadSchema(tableName);
+    pthread_mutex_unlock(&entriesLock);
+
+    return schema;
+}
+
+TableIndexes getCatalogIndexes(char *tableName) {
+    pthread_mutex_lock(&entriesLock);
+    TableInfo tableInfo = loadTable(tableName);
+
+    if (tableInfo->indexes == NULL) {
+        tableInfo->indexes = openTableIndexes(tableInfo, loadSchema(tableName));
+    }
+
+    pthread_mutex_unlock(&entriesLock);
+    return tableInfo->indexes;
+}
+
+void syncCatalogTable(TableInfo tableInfo) {
+    syncTableIndexes(tableInfo->indexes);
+    persistFreeSpaceMap(tableInfo);
+    updateTableHeader(tableInfo);
+    flushTablePages(tableInfo);
+    syncTableFile(tableInfo);
+}
+
+void commitCatalogOperation(int logIndex) {
+    // Free space of pages lives in space inventory pages logged with the rest
+    for (CatalogEntry entry = usedEntries; entry != NULL;
+         entry = entry->nextUsed) {
+        persistFreeSpaceMap(entry->table);
+    }
+
+    logPageChanges();
+
+    for (CatalogEntry entry = usedEntries; entry != NULL;
+         entry = entry->nextUsed) {
+        logTableHeader(entry->table);
+    }
+
+    commitWal(logIndex);
+
+    // Pages stay cached until a checkpoint, while headers and indexes are
+    // written to their files for other handles to read
+    while (usedEntries != NULL) {
+        CatalogEntry entry = usedEntries;
+        flushTableIndexes(entry->table->indexes);
+        updateTableHeader(entry->table);
+        fflush(entry->table->table);
+
+        usedEntries = entry->nextUsed;
+        entry->used = false;
+        entry->nextUsed = NULL;
+    }
+
+    if (getWalSize() >= WAL_CHECKPOINT_SIZE) {
+        checkpointCatalog();
+    }
+}
+
+void checkpointCatalog() {
+    for (CatalogEntry entry = entries; entry != NULL; entry = entry->next) {
+        if (entry->table != NULL) {
+            syncCatalogTable(entry->table);
+        }
+    }
+
+    checkpointWal();
+}
+
+static bool hasSuffix(char *fileName, char *suffix) {
+    size_t nameLen = strlen(fileName);
+    size_t suffixLen = strlen(suffix);
+
+    return nameLen > suffixLen &&
+           strcmp(fileName + nameLen - suffixLen, suffix) == 0;
+}
+
+static void copyFile(char *src, char *dest) {
+    FILE *in = fopen(src, "rb");
+    FILE *out = fopen(dest, "wb");
+    assert(in != NULL && out != NULL);
+
+    uint8_t buffer[_PAGE_SIZE];
+    size_t numRead;
+    while ((numRead = fread(buffer, sizeof(uint8_t), _PAGE_SIZE, in)) > 0) {
+        fwrite(buffer, sizeof(uint8_t), numRead, out);
+    }
+
+    fflush(out);
+    fsync(fileno(out));
+    fclose(out);
+    fclose(in);
+}
+
+int snapshotCatalog(char *directory) {
+    lockCatalog();
+
+    // Files are copied at a checkpoint, when they hold every applied
+    // operation and the WAL holds nothing more
+    checkpointCatalog();
+    int appliedIndex = getWalAppliedIndex();
+
+    DIR *dir = opendir(DB_BASE_DIRECTORY);
+    assert(dir != NULL);
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (!hasSuffix(entry->d_name, TABLE_FILE_SUFFIX) &&
+            !hasSuffix(entry->d_name, INDEX_FILE_SUFFIX)) {
+            continue;
+        }
+
+        char src[MAX_FILE_NAME_LEN + MAX_TABLE_NAME_LEN];
+        char dest[MAX_FILE_NAME_LEN + MAX_TABLE_NAME_LEN];
+        snprintf(src, sizeof(src), "%s/%s", DB_BASE_DIRECTORY, entry->d_name);
+        snprintf(dest, sizeof(dest), "%s/%s", directory, entry->d_name);
+        copyFile(src, dest);
+    }
+
+    closedir(dir);
+    unlockCatalog();
+
+    return appliedIndex;
+}
+
+static void removeDatabaseFiles(void) {
+    DIR *dir = opendir(DB_BASE_DIRECTORY);
+    assert(dir != NULL);
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        char path[MAX_FILE_NAME_LEN + MAX_TABLE_NAME_LEN];
+        snprintf(path, sizeof(path), "%s/%s", DB_BASE_DIRECTORY,
+                 entry->d_name);
+
+        if (hasSuffix(entry->d_name, TABLE_FILE_SUFFIX)) {
+            // Pages cached under the table name would outlive the file
+            char tableName[MAX_FILE_NAME_LEN];
+            snprintf(tableName, sizeof(tableName), "%.*s",
+                     (int)(strlen(entry->d_name) - strlen(TABLE_FILE_SUFFIX)),
+                     entry->d_name);
+            invalidateTablePages(tableName);
+            unlink(path);
+        } else if (hasSuffix(entry->d_name, INDEX_FILE_SUFFIX)) {
+            unlink(path);
+        }
+    }
+
+    closedir(dir);
+}
+
+void restoreCatalog(char *directory, int appliedIndex) {
+    lockCatalog();
+
+    // Nothing cached may be written back over the restored files
+    checkpointCatalog();
+    freeEntries();
+
+    removeDatabaseFiles();
+
+    DIR *dir = opendir(directory);
+    assert(dir != NULL);
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (!hasSuffix(entry->d_name, TABLE_FILE_SUFFIX) &&
+            !hasSuffix(entry->d_name, INDEX_FILE_SUFFIX)) {
+            continue;
+        }
+
+        char src[MAX_FILE_NAME_LEN + MAX_TABLE_NAME_LEN];
+        char dest[MAX_FILE_NAME_LEN + MAX_TABLE_NAME_LEN];
+        snprintf(src, sizeof(src), "%s/%s", directory, entry->d_name);
+        snprintf(dest, sizeof(dest), "%s/%s", DB_BASE_DIRECTORY, entry->d_name);
+        copyFile(src, dest);
+    }
+
+    closedir(dir);
+
+    // Records of the replaced tables must not be replayed over the copies
+    resetWal(appliedIndex);
+    unlockCatalog();
+}
+
+void invalidateCatalogRelation(char *tableName) {
+    char name[MAX_TABLE_NAME_LEN];
+
+    removeEntry(tableName);
+
+    snprintf(name, sizeof(name), "%s%s", tableName, SCHEMA_SUFFIX);
+    removeEntry(name);
+
+    snprintf(name, sizeof(name), "%s%s", tableName, SPACE_INVENTORY_SUFFIX);
+    removeEntry(name);
+}
+
+void closeCatalog() {
+    lockCatalog();
+    checkpointCatalog();
+
+    freeEntries();
+
+    unlockCatalog();
+}
@@ -0,0 +1,95 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include "core/table.h"
+#include "schema.h"
+
+/**
+ * Locks catalog for the duration of an operation, serialising access to the
+ * shared table handles
+ */
+extern void lockCatalog();
+
+/**
+ * Locks catalog for the duration of a read-only operation, which may share
+ * the table handles with other readers but not with writers
+ */
+extern void lockCatalogShared();
+
+/**
+ * Unlocks catalog once an operation has finished with its table handles,
+ * whichever way it was locked
+ */
+extern void unlockCatalog();
+
+/**
+ * Returns cached handle of table, opening the table on first use. The handle
+ * is owned by the catalog and must not be closed by the caller
+ * @param tableName name of table
+ * @return open TableInfo of table
+ */
+extern TableInfo getCatalogTable(char *tableName);
+
+/**
+ * Returns cached schema of relation, parsing its schema table on first use
+ * @param tableName name of relation table
+ * @return parsed schema owned by the catalog
+ */
+extern Schema *getCatalogSchema(char *tableName);
+
+/**
+ * Returns indexes of relation, opening its index files on first use. The
+ * indexes are owned by the cached handle of the relation
+ * @param tableName name of relation table
+ * @return open indexes of relation
+ */
+extern TableIndexes getCatalogIndexes(char *tableName);
+
+/**
+ * Writes indexes, table header and dirty pages of a cached table back to its
+ * files and forces them to disk
+ * @param tableInfo table handle returned by the catalog
+ */
+extern void syncCatalogTable(TableInfo tableInfo);
+
+/**
+ * Commits changes of the current operation to the WAL, after which they
+ * survive a crash, and checkpoints the catalog once the log grows too large
+ * @param logIndex index of operation in raft log, or NO_LOG_INDEX
+ */
+extern void commitCatalogOperation(int logIndex);
+
+/**
+ * Forces every cached table to disk and starts a new WAL
+ */
+extern void checkpointCatalog();
+
+/**
+ * Checkpoints the catalog and copies every table and index file into
+ * directory, as a snapshot of the operations applied so far
+ * @param directory existing directory to hold the copies
+ * @return index of last raft log entry included in the snapshot
+ */
+extern int snapshotCatalog(char *directory);
+
+/**
+ * Replaces every table and index file with the copies in a snapshot taken by
+ * snapshotCatalog, dropping cached tables and pages, and starts a new WAL
+ * @param directory directory holding the snapshot
+ * @param appliedIndex index of last raft log entry included in the snapshot
+ */
+extern void restoreCatalog(char *directory, int appliedIndex);
+
+/**
+ * Closes and drops cached handles and schema of relation together with its
+ * schema and space inventory tables
+ * @param tableName name of relation table
+ */
+extern void invalidateCatalogRelation(char *tableName);
+
+/**
+ * Closes all cached tables and frees cached schemas
+ */
+extern void closeCatalog();
+
+#endif  // CATALOG_H
@@ -1,94 +1,413 @@
 #include "conditions.h"
 
 #include <assert.h>
+#include <math.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "core/record.h"
+#include "log.h"
 #include "table/core/table.h"
 
-#define EVALUATE_COND(field, op, value)                                \
-    switch (value->type) {                                             \
-        case STR:                                                      \
-        case VARSTR:                                                   \
-            return strcmp(field.stringValue, value->value.strOp) op 0; \
-        case INT:                                                      \
-            return field.intValue op value->value.intOp;               \
-        case FLOAT:                                                    \
-            return field.floatValue op value->value.floatOp;           \
-        case BOOL:                                                     \
-            return field.boolValue op value->value.boolOp;             \
-        default:                                                       \
-            exit(-1);                                                  \
-    }
-
-static bool evaluateBetween(Field field, Operand value1, Operand value2) {
-    switch (field.type) {
-        case INT:
-            return value1->value.intOp <= field.intValue &&
-                   field.intValue <= value2->value.intOp;
-        case FLOAT:
-            return value1->value.floatOp <= field.floatValue &&
-                   field.floatValue <= value2->value.floatOp;
-        default:
-            exit(-1);
+// Field read in place from a record view
+typedef struct ViewField ViewField;
+struct ViewField {
+    uint8_t *ptr;
+    unsigned size;
+};
+
+typedef bool (*Comparator)(ConditionPlan plan, ViewField field);
+
+struct ConditionPlan {
+    ConditionType type;
+    double selectivity;  // Estimated fraction of records matched
+    double cost;         // Estimated relative cost of evaluating the plan
+
+    // Comparison of a single field, NULL for logical operators
+    Comparator compare;
+    AttributeType fieldType;
+    bool isVar;     // Whether field is located through a variable offset slot
+    unsigned loc;   // Offset from static field start or slot index
+    unsigned size;  // Size of static field
+    Operand value1;
+    Operand value2;
+    size_t strLen;  // Length of string operand
+
+    // Operands of AND, OR and NOT over subconditions
+    ConditionPlan *children;
+    unsigned numChildren;
+};
+
+static void readField(ViewField field, void *value, unsigned width) {
+    // Operands may be of a different but narrower type to the field, such as
+    // an integer compared to a boolean, so only the bytes of the field are read
+    memcpy(value, field.ptr, field.size < width ? field.size : width);
+}
+
+static int32_t readInt(ViewField field) {
+    int32_t value = 0;
+    readField(field, &value, INT_WIDTH);
+    return value;
+}
+
+static float readFloat(ViewField field) {
+    float value = 0;
+    readField(field, &value, FLOAT_WIDTH);
+    return value;
+}
+
+static bool readBool(ViewField field) {
+    bool value = false;
+    readField(field, &value, BOOL_WIDTH);
+    return value;
+}
+
+static int compareString(ConditionPlan plan, ViewField field) {
+    // Strings shorter than their field are null-terminated, which variable
+    // fields can be when the record was written with padding
+    size_t len = strnlen((char *)field.ptr, field.size);
+    size_t strLen = plan->strLen;
+
+    int res = memcmp(field.ptr, plan->value1->value.strOp,
+                     len < strLen ? len : strLen);
+    if (res != 0) {
+        return res;
     }
+    return (len > strLen) - (len < strLen);
 }
 
-static bool evaluateOneArg(ConditionType type, Field field) {
-    switch (type) {
-        case NOT:
-            assert(field.type == BOOL);
-            return !field.boolValue;
-        default:
-            exit(-1);
+#define DEFINE_COMPARATORS(name, op)                                        \
+    static bool str##name(ConditionPlan plan, ViewField field) {      \
+        return compareString(plan, field) op 0;                             \
+    }                                                                       \
+    static bool int##name(ConditionPlan plan, ViewField field) {            \
+        return readInt(field) op plan->value1->value.intOp;                 \
+    }                                                                       \
+    static bool float##name(ConditionPlan plan, ViewField field) {          \
+        return readFloat(field) op plan->value1->value.floatOp;             \
+    }                                                                       \
+    static bool bool##name(ConditionPlan plan, ViewField field) {           \
+        return readBool(field) op plan->value1->value.boolOp;               \
+    }
+
+DEFINE_COMPARATORS(Equals, ==)
+DEFINE_COMPARATORS(LessThan, <)
+DEFINE_COMPARATORS(GreaterThan, >)
+DEFINE_COMPARATORS(LessEquals, <=)
+DEFINE_COMPARATORS(GreaterEquals, >=)
+
+#define SELECT_COMPARATOR(name, operandType)   \
+    switch (operandType) {                     \
+        case STR:                              \
+        case VARSTR:                           \
+            return str##name;            \
+        case INT:                              \
+            return int##name;                  \
+        case FLOAT:                            \
+            return float##name;                \
+        case BOOL:                             \
+            return bool##name;                 \
+        default:                               \
+            return NULL;                       \
     }
+
+static bool intBetween(ConditionPlan plan, ViewField field) {
+    int32_t value = readInt(field);
+    return plan->value1->value.intOp <= value &&
+           value <= plan->value2->value.intOp;
+}
+
+static bool floatBetween(ConditionPlan plan, ViewField field) {
+    float value = readFloat(field);
+    return plan->value1->value.floatOp <= value &&
+           value <= plan->value2->value.floatOp;
 }
 
-static bool evaluateTwoArg(ConditionType type, Field field, Operand value) {
+static bool boolNot(ConditionPlan plan, ViewField field) {
+    return !readBool(field);
+}
+
+static bool alwaysFalse(ConditionPlan plan, ViewField field) { return false; }
+
+static Comparator selectComparator(ConditionType type, AttributeType fieldType,
+                                   AttributeType operandType) {
     switch (type) {
         case EQUALS:
-            EVALUATE_COND(field, ==, value);
+            SELECT_COMPARATOR(Equals, operandType);
         case LESS_THAN:
-            EVALUATE_COND(field, <, value);
+            SELECT_COMPARATOR(LessThan, operandType);
         case GREATER_THAN:
-            EVALUATE_COND(field, >, value);
+            SELECT_COMPARATOR(GreaterThan, operandType);
         case LESS_EQUALS:
-            EVALUATE_COND(field, <=, value);
+            SELECT_COMPARATOR(LessEquals, operandType);
         case GREATER_EQUALS:
-            EVALUATE_COND(field, >=, value);
+            SELECT_COMPARATOR(GreaterEquals, operandType);
+        case BETWEEN:
+            if (fieldType == INT) return intBetween;
+            if (fieldType == FLOAT) return floatBetween;
+            return NULL;
+        case NOT:
+            return fieldType == BOOL ? boolNot : NULL;
         default:
-            return false;
+            return NULL;
+    }
+}
+
+static double estimateSelectivity(ConditionType type, Operand value) {
+    // Fixed guesses in the absence of statistics on the stored values
+    switch (type) {
+        case EQUALS:
+            return value->type == BOOL ? 0.5 : 0.1;
+        case BETWEEN:
+            return 0.25;
+        case NOT:
+            return 0.5;
+        default:
+            return 1.0 / 3;
     }
 }
 
-bool evaluate(Record record, Condition condition) {
+static ConditionPlan createPlan(ConditionType type) {
+    ConditionPlan plan = malloc(sizeof(struct ConditionPlan));
+    assert(plan != NULL);
+
+    plan->type = type;
+    plan->selectivity = 0;
+    plan->cost = 0;
+    plan->compare = NULL;
+    plan->fieldType = INT;
+    plan->isVar = false;
+    plan->loc = 0;
+    plan->size = 0;
+    plan->value1 = NULL;
+    plan->value2 = NULL;
+    plan->strLen = 0;
+    plan->children = NULL;
+    plan->numChildren = 0;
+
+    return plan;
+}
+
+static ConditionPlan compileComparison(Condition condition, Schema *schema) {
+    ConditionPlan plan = createPlan(condition->type);
+
     AttributeName attribute;
+
     if (condition->type == BETWEEN) {
         attribute = condition->value.between.op1->value.strOp;
+        plan->value1 = condition->value.between.op2;
+        plan->value2 = condition->value.between.op3;
     } else if (condition->type == NOT) {
         attribute = condition->value.oneArg.op1->value.strOp;
     } else {
         attribute = condition->value.twoArg.op1->value.strOp;
+        plan->value1 = condition->value.twoArg.op2;
+    }
+
+    // Unknown attributes never match
+    plan->compare = alwaysFalse;
+
+    // Resolves attribute to its position in the record
+    for (int i = 0; i < schema->numAttrs; i++) {
+        AttrInfo *info = &schema->attrInfos[i];
+
+        if (strcmp(info->name, attribute) != 0) {
+            continue;
+        }
+
+        AttributeType operandType =
+            plan->value1 != NULL ? plan->value1->type : info->type;
+
+        plan->fieldType = info->type;
+        plan->isVar = info->type == VARSTR;
+        plan->loc = info->loc;
+        plan->size = info->size;
+        plan->compare =
+            selectComparator(condition->type, info->type, operandType);
+
+        if (plan->compare == NULL) {
+            LOG_ERROR("Unsupported condition on attribute %s", attribute);
+        }
+
+        if (operandType == STR || operandType == VARSTR) {
+            plan->strLen = strlen(plan->value1->value.strOp);
+        }
+
+        plan->selectivity = estimateSelectivity(
+            condition->type,
+            plan->value1 != NULL ? plan->value1 : condition->value.oneArg.op1);
+
+        // Variable fields are located through their offset slot, and strings
+        // are compared byte by byte
+        plan->cost = 1 + plan->isVar +
+                     (operandType == STR || operandType == VARSTR);
+        break;
+    }
+
+    return plan;
+}
+
+static unsigned countOperands(Condition condition, ConditionType type) {
+    if (condition->type != type) {
+        return 1;
+    }
+    return countOperands(condition->value.binary.left, type) +
+           countOperands(condition->value.binary.right, type);
+}
+
+static void compileOperands(Condition condition, ConditionType type,
+                            Schema *schema, ConditionPlan plan) {
+    // Nested chains of the same operator are flattened so that all their
+    // operands are ordered together
+    if (condition->type != type) {
+        plan->children[plan->numChildren++] =
+            compileCondition(condition, schema);
+        return;
+    }
+    compileOperands(condition->value.binary.left, type, schema, plan);
+    compileOperands(condition->value.binary.right, type, schema, plan);
+}
+
+static double getRank(ConditionPlan plan, ConditionType parentType) {
+    // Cheap operands most likely to decide the result are evaluated first,
+    // which are those likely to fail for AND and likely to match for OR
+    double decisive =
+        parentType == AND ? 1 - plan->selectivity : plan->selectivity;
+    if (decisive <= 0) {
+        return HUGE_VAL;
+    }
+    return plan->cost / decisive;
+}
+
+static void orderOperands(ConditionPlan plan) {
+    // Insertion sort, as conditions have few operands
+    for (unsigned i = 1; i < plan->numChildren; i++) {
+        ConditionPlan child = plan->children[i];
+        double rank = getRank(child, plan->type);
+
+        unsigned j = i;
+        while (j > 0 && getRank(plan->children[j - 1], plan->type) > rank) {
+            plan->children[j] = plan->children[j - 1];
+            j--;
+        }
+        plan->children[j] = child;
+    }
+}
+
+static ConditionPlan compileLogical(Condition condition, Schema *schema) {
+    ConditionPlan plan = createPlan(condition->type);
+
+    unsigned numOperands = countOperands(condition, condition->type);
+    plan->children = malloc(sizeof(ConditionPlan) * numOperands);
+    assert(plan->children != NULL);
+
+    compileOperands(condition, condition->type, schema, plan);
+    orderOperands(plan);
+
+    // Operands are treated as independent when combining estimates
+    double none = 1;
+    double all = 1;
+    plan->cost = 0;
+
+    for (unsigned i = 0; i < plan->numChildren; i++) {
+        all *= plan->children[i]->selectivity;
+        none *= 1 - plan->children[i]->selectivity;
+        plan->cost += plan->children[i]->cost;
+    }
+
+    plan->selectivity = plan->type == AND ? all : 1 - none;
+    return plan;
+}
+
+ConditionPlan compileCondition(Condition condition, Schema *schema) {
+    if (condition == NULL) {
+        return NULL;
     }
 
-    for (int i = 0; i < record->numValues; i++) {
-        Field field = record->fields[i];
+    switch (condition->type) {
+        case AND:
+        case OR:
+            return compileLogical(condition, schema);
+        case NOT:
+            if (condition->value.oneArg.child != NULL) {
+                ConditionPlan plan = createPlan(NOT);
+
+                plan->children = malloc(sizeof(ConditionPlan));
+                assert(plan->children != NULL);
 
-        if (strcmp(field.attribute, attribute) == 0) {
-            if (condition->type == BETWEEN) {
-                Operand op2 = condition->value.between.op2;
-                Operand op3 = condition->value.between.op3;
-                return evaluateBetween(field, op2, op3);
+                plan->children[0] =
+                    compileCondition(condition->value.oneArg.child, schema);
+                plan->numChildren = 1;
+                plan->selectivity = 1 - plan->children[0]->selectivity;
+                plan->cost = plan->children[0]->cost;
+
+                return plan;
             }
+            // NOT applied directly to a boolean attribute is a comparison
+        default:
+            return compileComparison(condition, schema);
+    }
+}
+
+static bool evaluateComparison(ConditionPlan plan, RecordView *view) {
+    // Field of an unknown attribute has no location to read from
+    if (plan->compare == alwaysFalse) {
+        return false;
+    }
+
+    ViewField field;
+    if (plan->isVar) {
+        field.size = getFieldSize(view->ptr, plan->loc);
+        field.ptr = view->ptr + getFieldOffset(view->ptr, plan->loc);
+    } else {
+        field.size = plan->size;
+        field.ptr = view->staticFields + plan->loc;
+    }
 
-            if (condition->type == NOT) {
-                return evaluateOneArg(condition->type, field);
+    return plan->compare(plan, field);
+}
+
+bool evaluate(ConditionPlan plan, RecordView *view) {
+    if (plan == NULL) {
+        return true;
+    }
+
+    if (plan->compare != NULL) {
+        return evaluateComparison(plan, view);
+    }
+
+    // Stops at the first operand which decides the result
+    switch (plan->type) {
+        case AND:
+            for (unsigned i = 0; i < plan->numChildren; i++) {
+                if (!evaluate(plan->children[i], view)) {
+                    return false;
+                }
+            }
+            return true;
+        case OR:
+            for (unsigned i = 0; i < plan->numChildren; i++) {
+                if (evaluate(plan->children[i], view)) {
+                    return true;
+                }
             }
+            return false;
+        case NOT:
+            return !evaluate(plan->children[0], view);
+        default:
+            return false;
+    }
+}
 
-            Operand op = condition->value.twoArg.op2;
-            return evaluateTwoArg(condition->type, field, op);
-        }
+void freeConditionPlan(ConditionPlan plan) {
+    if (plan == NULL) {
+        return;
+    }
+
+    for (unsigned i = 0; i < plan->numChildren; i++) {
+        freeConditionPlan(plan->children[i]);
     }
 
-    return false;
+    free(plan->children);
+    free(plan);
 }
@@ -4,13 +4,35 @@
 #include <stdbool.h>
 
 #include "core/table.h"
+#include "schema.h"
 #include "table/operations/operation.h"
 
+typedef struct RecordView RecordView;
+typedef struct ConditionPlan *ConditionPlan;
+
+/**
+ * Compiles condition against schema once per query, resolving attributes
+ * to their position in the record and choosing typed comparators. Operands of
+ * AND and OR are ordered so that those most likely to decide the result are
+ * evaluated first
+ * @param condition the condition to compile, or NULL to match every record
+ * @param schema schema of the records the condition is evaluated on
+ * @return plan to pass to evaluate, or NULL if condition is NULL
+ */
+extern ConditionPlan compileCondition(Condition condition, Schema *schema);
+
+/**
+ * Evaluate a compiled condition on the given record, reading fields in place
+ * and short-circuiting AND and OR
+ * @param plan the compiled condition, where NULL matches every record
+ * @param view view of the record to evaluate on
+ */
+extern bool evaluate(ConditionPlan plan, RecordView *view);
+
 /**
- * Evaluate a condition on the given record
- * @param record the record to evaluate on
- * @param condition the condition to evaluate
+ * Frees compiled condition
+ * @param plan
  */
-extern bool evaluate(Record record, Condition condition);
+extern void freeConditionPlan(ConditionPlan plan);
 
 #endif  // CONDITIONS_H
@@ -0,0 +1,507 @@
+#include "bufferPool.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "pages.h"
+#include "wal.h"
+
+#define NUM_BUCKETS (BUFFER_POOL_SIZE * 2)
+
+struct BufferFrame {
+    struct Page page;
+    char tableName[MAX_TABLE_NAME_LEN];
+    FILE *file;  // Handle used to write back the frame while it is dirty
+    unsigned pinCount;
+    bool valid;
+    bool dirty;
+    bool mapped;  // Whether the page points into a memory-mapped table file
+    bool referenced;
+    bool imaged;   // Whether image holds the page as before the operation
+    bool changed;  // Whether the page was modified by the operation
+    uint8_t *image;
+    BufferFrame nextInBucket;
+};
+
+static struct BufferFrame frames[BUFFER_POOL_SIZE];
+static uint8_t *frameData = NULL;
+static uint8_t *imageData = NULL;
+static BufferFrame buckets[NUM_BUCKETS];
+static unsigned clockHand = 0;
+static BufferPoolStats stats;
+static pthread_mutex_t poolLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Whether pages modified by the current operation are logged to the WAL
+static bool trackingChanges = false;
+
+static void initialiseBufferPool(void) {
+    if (frameData != NULL) {
+        return;
+    }
+
+    // Allocates page memory for all frames in one block
+    frameData = calloc(BUFFER_POOL_SIZE, _PAGE_SIZE);
+    imageData = malloc(BUFFER_POOL_SIZE * _PAGE_SIZE);
+    assert(frameData != NULL && imageData != NULL);
+
+    for (int i = 0; i < BUFFER_POOL_SIZE; i++) {
+        frames[i].page.ptr = frameData + i * _PAGE_SIZE;
+        frames[i].image = imageData + i * _PAGE_SIZE;
+        frames[i].page.header = NULL;
+        frames[i].page.frame = &frames[i];
+    }
+}
+
+static size_t hashPage(char *tableName, size_t pageId) {
+    size_t hash = 5381;
+    while (*tableName != '\0') {
+        hash = hash * 33 + *tableName++;
+    }
+    return (hash * 31 + pageId) % NUM_BUCKETS;
+}
+
+static BufferFrame findFrame(char *tableName, size_t pageId) {
+    BufferFrame frame = buckets[hashPage(tableName, pageId)];
+
+    while (frame != NULL) {
+        if (frame->page.pageId == pageId &&
+            strcmp(frame->tableName, tableName) == 0) {
+            return frame;
+        }
+        frame = frame->nextInBucket;
+    }
+
+    return NULL;
+}
+
+static void removeFromBucket(BufferFrame frame) {
+    BufferFrame *curr = &buckets[hashPage(frame->tableName,
+                                          frame->page.pageId)];
+
+    while (*curr != frame) {
+        assert(*curr != NULL);
+        curr = &(*curr)->nextInBucket;
+    }
+
+    *curr = frame->nextInBucket;
+    frame->nextInBucket = NULL;
+}
+
+// Uncached pages are read outside the pool lock, so the position of the
+// shared handle is held for the whole seek and transfer
+static void writePageToFile(FILE *file, Page page) {
+    flockfile(file);
+    fseek(file, _PAGE_SIZE * page->pageId, SEEK_SET);
+    fwrite(page->ptr, sizeof(uint8_t), _PAGE_SIZE, file);
+    fseek(file, 0, SEEK_SET);
+    funlockfile(file);
+}
+
+static void readPageFromFile(FILE *file, Page page) {
+    // Pages past the end of the file are read as zeroed pages
+    memset(page->ptr, 0, _PAGE_SIZE);
+
+    flockfile(file);
+    fseek(file, _PAGE_SIZE * page->pageId, SEEK_SET);
+    fread(page->ptr, sizeof(uint8_t), _PAGE_SIZE, file);
+    fseek(file, 0, SEEK_SET);
+    funlockfile(file);
+}
+
+// Pages of a table that outgrew its reserved address space lie beyond the
+// mapping, and are read and written through stdio
+static bool isPageMapped(TableInfo table, size_t pageId) {
+    return table->map != NULL && (pageId + 1) * _PAGE_SIZE <= table->mapSize;
+}
+
+static uint8_t *getMappedPage(TableInfo table, size_t pageId) {
+    assert((pageId + 1) * _PAGE_SIZE <= table->mapSize);
+    return table->map + pageId * _PAGE_SIZE;
+}
+
+static void takeImage(BufferFrame frame) {
+    if (trackingChanges && !frame->imaged) {
+        memcpy(frame->image, frame->page.ptr, _PAGE_SIZE);
+        frame->imaged = true;
+    }
+}
+
+static void logFrameChanges(BufferFrame frame) {
+    logPageChange(frame->tableName, frame->page.pageId, frame->image,
+                  frame->page.ptr);
+    memcpy(frame->image, frame->page.ptr, _PAGE_SIZE);
+    frame->changed = false;
+}
+
+// Changes to a mapped page reach the table file as they are made, so its
+// undo image is forced before the page is first changed
+static void forceMappedImage(BufferFrame frame) {
+    if (!trackingChanges || !frame->valid || !frame->mapped ||
+        frame->changed) {
+        return;
+    }
+
+    assert(frame->imaged);
+    logPageImage(frame->tableName, frame->page.pageId, frame->image);
+    syncWal();
+    frame->changed = true;
+}
+
+static void writeBackFrame(BufferFrame frame) {
+    assert(frame->file != NULL);
+
+    // Page changed by an operation yet to commit can only be written once
+    // the log can both undo and redo its changes
+    if (frame->changed) {
+        logPageImage(frame->tableName, frame->page.pageId, frame->image);
+        logFrameChanges(frame);
+        syncWal();
+    }
+
+    writePageToFile(frame->file, &frame->page);
+    frame->dirty = false;
+    stats.writeBacks++;
+}
+
+static void clearFrame(BufferFrame frame) {
+    if (frame->valid) {
+        removeFromBucket(frame);
+    }
+
+    if (frame->page.header != NULL) {
+        freePageHeader(frame->page.header);
+        frame->page.header = NULL;
+    }
+
+    frame->valid = false;
+    frame->dirty = false;
+    frame->referenced = false;
+    frame->mapped = false;
+    frame->imaged = false;
+    frame->changed = false;
+    frame->file = NULL;
+}
+
+static BufferFrame findVictim(void) {
+    // Clock sweep, where two passes guarantee every reference bit is cleared
+    for (int i = 0; i < 2 * BUFFER_POOL_SIZE; i++) {
+        BufferFrame frame = &frames[clockHand];
+        clockHand = (clockHand + 1) % BUFFER_POOL_SIZE;
+
+        if (frame->pinCount > 0) {
+            continue;
+        }
+
+        // Recently used frames get a second chance
+        if (frame->valid && frame->referenced) {
+            frame->referenced = false;
+            continue;
+        }
+
+        if (frame->valid) {
+            if (frame->dirty) {
+                writeBackFrame(frame);
+            }
+
+            // Mapped page is already in the file, its undo image in the log
+            if (frame->mapped && frame->changed) {
+                logFrameChanges(frame);
+            }
+            stats.evictions++;
+        }
+
+        clearFrame(frame);
+        return frame;
+    }
+
+    return NULL;
+}
+
+static Page createDetachedPage(size_t pageId) {
+    // Used only when every frame is pinned
+    Page page = malloc(sizeof(struct Page));
+    assert(page != NULL);
+
+    page->ptr = malloc(sizeof(uint8_t) * _PAGE_SIZE);
+    assert(page->ptr != NULL);
+
+    page->header = NULL;
+    page->pageId = pageId;
+    page->frame = NULL;
+
+    return page;
+}
+
+static BufferFrame claimFrame(TableInfo table, size_t pageId) {
+    BufferFrame frame = findVictim();
+
+    if (frame == NULL) {
+        LOG("Buffer pool exhausted, page %zu of %s is not cached", pageId,
+            table->name);
+        return NULL;
+    }
+
+    assert(strlen(table->name) < MAX_TABLE_NAME_LEN);
+    strcpy(frame->tableName, table->name);
+    frame->page.pageId = pageId;
+    frame->valid = true;
+
+    // Frames of memory-mapped tables point directly into the mapping
+    frame->mapped = isPageMapped(table, pageId);
+    frame->page.ptr = frame->mapped ? getMappedPage(table, pageId)
+                                    : frameData + (frame - frames) * _PAGE_SIZE;
+
+    size_t bucket = hashPage(frame->tableName, pageId);
+    frame->nextInBucket = buckets[bucket];
+    buckets[bucket] = frame;
+
+    return frame;
+}
+
+Page pinPage(TableInfo table, size_t pageId) {
+    pthread_mutex_lock(&poolLock);
+    initialiseBufferPool();
+
+    BufferFrame frame = findFrame(table->name, pageId);
+
+    if (frame != NULL) {
+        stats.hits++;
+    } else {
+        stats.misses++;
+        frame = claimFrame(table, pageId);
+
+        if (frame == NULL) {
+            pthread_mutex_unlock(&poolLock);
+
+            Page page = createDetachedPage(pageId);
+            if (isPageMapped(table, pageId)) {
+                memcpy(page->ptr, getMappedPage(table, pageId), _PAGE_SIZE);
+            } else {
+                readPageFromFile(table->table, page);
+            }
+            return page;
+        }
+
+        if (!frame->mapped) {
+            readPageFromFile(table->table, &frame->page);
+        }
+    }
+
+    takeImage(frame);
+    frame->pinCount++;
+    frame->referenced = true;
+
+    pthread_mutex_unlock(&poolLock);
+    return &frame->page;
+}
+
+Page pinNewPage(TableInfo table, size_t pageId) {
+    pthread_mutex_lock(&poolLock);
+    initialiseBufferPool();
+
+    // Discards stale copy of a page with the same index
+    BufferFrame frame = findFrame(table->name, pageId);
+    if (frame != NULL && frame->pinCount == 0) {
+        clearFrame(frame);
+    } else if (frame != NULL) {
+        removeFromBucket(frame);
+        frame->valid = false;
+        frame->dirty = false;
+        frame->changed = false;
+    }
+
+    frame = claimFrame(table, pageId);
+
+    if (frame == NULL) {
+        pthread_mutex_unlock(&poolLock);
+
+        Page page = createDetachedPage(pageId);
+        memset(page->ptr, 0, _PAGE_SIZE);
+        return page;
+    }
+
+    memset(frame->page.ptr, 0, _PAGE_SIZE);
+    takeImage(frame);
+    frame->pinCount++;
+    frame->referenced = true;
+
+    pthread_mutex_unlock(&poolLock);
+    return &frame->page;
+}
+
+void unpinPage(Page page) {
+    BufferFrame frame = page->frame;
+
+    if (frame == NULL) {
+        if (page->header != NULL) {
+            freePageHeader(page->header);
+        }
+        free(page->ptr);
+        free(page);
+        return;
+    }
+
+    pthread_mutex_lock(&poolLock);
+
+    assert(frame->pinCount > 0);
+    frame->pinCount--;
+
+    // Frames invalidated while pinned are released on their last unpin
+    if (frame->pinCount == 0 && !frame->valid) {
+        clearFrame(frame);
+    }
+
+    pthread_mutex_unlock(&poolLock);
+}
+
+static void logDetachedPage(TableInfo table, Page page) {
+    uint8_t image[_PAGE_SIZE];
+
+    if (isPageMapped(table, page->pageId)) {
+        memcpy(image, getMappedPage(table, page->pageId), _PAGE_SIZE);
+    } else {
+        struct Page filePage = {.ptr = image, .pageId = page->pageId};
+        readPageFromFile(table->table, &filePage);
+    }
+
+    logPageImage(table->name, page->pageId, image);
+    logPageChange(table->name, page->pageId, image, page->ptr);
+    syncWal();
+}
+
+void markPageDirty(TableInfo table, Page page) {
+    BufferFrame frame = page->frame;
+
+    // Uncached pages are written through immediately
+    if (frame == NULL) {
+        pthread_mutex_lock(&poolLock);
+        bool tracking = trackingChanges;
+        pthread_mutex_unlock(&poolLock);
+
+        if (tracking) {
+            logDetachedPage(table, page);
+        }
+
+        if (isPageMapped(table, page->pageId)) {
+            memcpy(getMappedPage(table, page->pageId), page->ptr, _PAGE_SIZE);
+        } else {
+            writePageToFile(table->table, page);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&poolLock);
+
+    forceMappedImage(frame);
+
+    // Frames invalidated while pinned are never written back
+    if (trackingChanges && frame->valid) {
+        assert(frame->imaged);
+        frame->changed = true;
+    }
+
+    // Changes to mapped pages are already in the table file
+    if (!frame->mapped) {
+        frame->dirty = true;
+        frame->file = table->table;
+    }
+
+    pthread_mutex_unlock(&poolLock);
+}
+
+void preparePageChange(Page page) {
+    BufferFrame frame = page->frame;
+
+    // Uncached pages are logged as they are written through
+    if (frame == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&poolLock);
+    forceMappedImage(frame);
+    pthread_mutex_unlock(&poolLock);
+}
+
+void beginPageChanges(void) {
+    pthread_mutex_lock(&poolLock);
+    initialiseBufferPool();
+    trackingChanges = true;
+
+    // Pages pinned before the operation are imaged as they are now
+    for (int i = 0; i < BUFFER_POOL_SIZE; i++) {
+        if (frames[i].valid && frames[i].pinCount > 0) {
+            takeImage(&frames[i]);
+        }
+    }
+
+    pthread_mutex_unlock(&poolLock);
+}
+
+void logPageChanges(void) {
+    pthread_mutex_lock(&poolLock);
+
+    for (int i = 0; i < BUFFER_POOL_SIZE; i++) {
+        BufferFrame frame = &frames[i];
+
+        if (frame->valid && frame->changed) {
+            logFrameChanges(frame);
+        }
+
+        frame->imaged = false;
+        frame->changed = false;
+    }
+
+    trackingChanges = false;
+    pthread_mutex_unlock(&poolLock);
+}
+
+void flushTablePages(TableInfo table) {
+    pthread_mutex_lock(&poolLock);
+
+    for (int i = 0; i < BUFFER_POOL_SIZE; i++) {
+        BufferFrame frame = &frames[i];
+
+        if (frame->valid && frame->dirty &&
+            strcmp(frame->tableName, table->name) == 0) {
+            frame->file = table->table;
+            writeBackFrame(frame);
+        }
+    }
+
+    pthread_mutex_unlock(&poolLock);
+}
+
+void invalidateTablePages(char *tableName) {
+    pthread_mutex_lock(&poolLock);
+
+    for (int i = 0; i < BUFFER_POOL_SIZE; i++) {
+        BufferFrame frame = &frames[i];
+
+        if (!frame->valid || strcmp(frame->tableName, tableName) != 0) {
+            continue;
+        }
+
+        if (frame->pinCount == 0) {
+            clearFrame(frame);
+        } else {
+            // Removes from lookup so that the stale frame is never returned
+            removeFromBucket(frame);
+            frame->valid = false;
+            frame->dirty = false;
+        }
+    }
+
+    pthread_mutex_unlock(&poolLock);
+}
+
+BufferPoolStats getBufferPoolStats(void) {
+    pthread_mutex_lock(&poolLock);
+    BufferPoolStats res = stats;
+    pthread_mutex_unlock(&poolLock);
+    return res;
+}
@@ -0,0 +1,89 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "table.h"
+
+#define BUFFER_POOL_SIZE 256  // 1 MB of 4 KB pages
+
+typedef struct BufferFrame *BufferFrame;
+
+typedef struct BufferPoolStats BufferPoolStats;
+struct BufferPoolStats {
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+    size_t writeBacks;
+};
+
+/**
+ * Pins page of table in the buffer pool, reading it from disk if not cached.
+ * The header of a freshly loaded page is NULL and must be parsed by the caller
+ * @param table table containing page
+ * @param pageId index of page
+ * @return Page pointing into the frame holding the page
+ */
+extern Page pinPage(TableInfo table, size_t pageId);
+
+/**
+ * Pins zeroed frame for a page that does not yet exist on disk
+ * @param table table containing page
+ * @param pageId index of new page
+ * @return Page pointing into the frame holding the page
+ */
+extern Page pinNewPage(TableInfo table, size_t pageId);
+
+/**
+ * Releases pin on page, allowing its frame to be evicted once unpinned
+ * @param page
+ */
+extern void unpinPage(Page page);
+
+/**
+ * Marks page as modified so that it is written back before eviction
+ * @param table table containing page
+ * @param page
+ */
+extern void markPageDirty(TableInfo table, Page page);
+
+/**
+ * Called before the first change to a page by an operation. Pages of
+ * memory-mapped tables are changed in the table file itself, so their undo
+ * image is forced to the WAL first
+ * @param page
+ */
+extern void preparePageChange(Page page);
+
+/**
+ * Starts tracking pages modified by an operation. Each page is imaged before
+ * its first change, so that a page written back before the operation commits
+ * is first logged with both its undo image and its changes
+ */
+extern void beginPageChanges(void);
+
+/**
+ * Logs the changes made to pages since beginPageChanges as redo records and
+ * stops tracking. The records are only durable once the WAL is committed
+ */
+extern void logPageChanges(void);
+
+/**
+ * Writes back all dirty pages of table
+ * @param table
+ */
+extern void flushTablePages(TableInfo table);
+
+/**
+ * Drops all cached pages of table, used when the table file is recreated
+ * @param tableName name of table
+ */
+extern void invalidateTablePages(char *tableName);
+
+/**
+ * Returns hit, miss and eviction counters of the buffer pool
+ */
+extern BufferPoolStats getBufferPoolStats(void);
+
+#endif  // BUFFER_POOL_H
@@ -0,0 +1,246 @@
+#include "freeSpaceMap.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "../operations/insert.h"
+#include "../schema.h"
+#include "pages.h"
+#include "record.h"
+
+#define INITIAL_CAPACITY 64
+#define ABSENT_PAGE (-1)
+
+typedef struct FreeSpaceEntry FreeSpaceEntry;
+struct FreeSpaceEntry {
+    uint32_t inventoryPageId;  // Location of entry in space inventory
+    uint16_t inventorySlot;
+    bool stored;  // Whether entry has a record in the space inventory
+    bool dirty;
+};
+
+struct FreeSpaceMap {
+    // Segment tree holding maximum free space of each range of page indices,
+    // where leaf i is stored at capacity + i
+    int *tree;
+    FreeSpaceEntry *entries;
+    size_t capacity;
+    size_t numDirty;
+};
+
+static FreeSpaceMap createFreeSpaceMap(size_t capacity) {
+    FreeSpaceMap map = malloc(sizeof(struct FreeSpaceMap));
+    assert(map != NULL);
+
+    map->tree = malloc(sizeof(int) * 2 * capacity);
+    assert(map->tree != NULL);
+
+    map->entries = calloc(capacity, sizeof(FreeSpaceEntry));
+    assert(map->entries != NULL);
+
+    for (size_t i = 0; i < 2 * capacity; i++) {
+        map->tree[i] = ABSENT_PAGE;
+    }
+
+    map->capacity = capacity;
+    map->numDirty = 0;
+
+    return map;
+}
+
+static void growFreeSpaceMap(FreeSpaceMap map, size_t pageId) {
+    size_t capacity = map->capacity;
+    while (capacity <= pageId) {
+        capacity *= 2;
+    }
+
+    int *tree = malloc(sizeof(int) * 2 * capacity);
+    assert(tree != NULL);
+
+    for (size_t i = 0; i < 2 * capacity; i++) {
+        tree[i] = ABSENT_PAGE;
+    }
+
+    // Copies leaves and rebuilds internal nodes
+    for (size_t i = 0; i < map->capacity; i++) {
+        tree[capacity + i] = map->tree[map->capacity + i];
+    }
+
+    for (size_t i = capacity - 1; i > 0; i--) {
+        int left = tree[2 * i];
+        int right = tree[2 * i + 1];
+        tree[i] = left > right ? left : right;
+    }
+
+    map->entries = realloc(map->entries, sizeof(FreeSpaceEntry) * capacity);
+    assert(map->entries != NULL);
+
+    for (size_t i = map->capacity; i < capacity; i++) {
+        map->entries[i] = (FreeSpaceEntry){0};
+    }
+
+    free(map->tree);
+    map->tree = tree;
+    map->capacity = capacity;
+}
+
+static void setLeaf(FreeSpaceMap map, size_t pageId, int freeSpace) {
+    if (pageId >= map->capacity) {
+        growFreeSpaceMap(map, pageId);
+    }
+
+    size_t node = map->capacity + pageId;
+    map->tree[node] = freeSpace;
+
+    // Propagates new maximum towards the root
+    for (node /= 2; node > 0; node /= 2) {
+        int left = map->tree[2 * node];
+        int right = map->tree[2 * node + 1];
+        map->tree[node] = left > right ? left : right;
+    }
+}
+
+static FreeSpaceMap loadFreeSpaceMap(TableInfo spaceInfo) {
+    FreeSpaceMap map = createFreeSpaceMap(INITIAL_CAPACITY);
+    Schema spaceSchema = getInventorySchema();
+
+    struct RecordIterator iterator;
+    initialiseRecordIterator(&iterator);
+
+    while (iterateRecords(spaceInfo, &iterator, true)) {
+        Record record = parseRecord(
+            iterator.page->ptr + iterator.lastSlot->offset, &spaceSchema);
+
+        size_t pageId = record->fields[SPACE_ID_IDX].intValue;
+        setLeaf(map, pageId, record->fields[SPACE_FREE_IDX].intValue);
+
+        FreeSpaceEntry *entry = &map->entries[pageId];
+        entry->inventoryPageId = iterator.pageId;
+        entry->inventorySlot = iterator.slotIdx - 1;
+        entry->stored = true;
+
+        freeRecord(record);
+    }
+
+    freeRecordIterator(&iterator);
+    return map;
+}
+
+static FreeSpaceMap getFreeSpaceMap(TableInfo spaceInfo) {
+    if (spaceInfo->freeSpaceMap == NULL) {
+        spaceInfo->freeSpaceMap = loadFreeSpaceMap(spaceInfo);
+    }
+
+    return spaceInfo->freeSpaceMap;
+}
+
+size_t findFreePage(TableInfo spaceInfo, size_t requiredSpace) {
+    FreeSpaceMap map = getFreeSpaceMap(spaceInfo);
+
+    if (map->tree[1] < (int)requiredSpace) {
+        return NO_FREE_PAGE;
+    }
+
+    // Descends towards leftmost leaf with enough space
+    size_t node = 1;
+    while (node < map->capacity) {
+        node = map->tree[2 * node] >= (int)requiredSpace ? 2 * node
+                                                         : 2 * node + 1;
+    }
+
+    return node - map->capacity;
+}
+
+void setPageFreeSpace(TableInfo spaceInfo, size_t pageId, int freeSpace) {
+    assert(pageId != NO_FREE_PAGE);
+
+    FreeSpaceMap map = getFreeSpaceMap(spaceInfo);
+    setLeaf(map, pageId, freeSpace);
+
+    FreeSpaceEntry *entry = &map->entries[pageId];
+    if (!entry->dirty) {
+        entry->dirty = true;
+        map->numDirty++;
+    }
+}
+
+static void updateStoredEntry(TableInfo spaceInfo, FreeSpaceEntry *entry,
+                              int freeSpace) {
+    Schema spaceSchema = getInventorySchema();
+    Page page = getPage(spaceInfo, entry->inventoryPageId);
+    uint8_t *ptr =
+        page->ptr + page->header->slots.slots[entry->inventorySlot].offset;
+
+    // Free space is a static field, so the record keeps its size
+    Record record = parseRecord(ptr, &spaceSchema);
+    record->fields[SPACE_FREE_IDX].intValue = freeSpace;
+    beginPageUpdate(page);
+    writeRecord(ptr, record);
+    freeRecord(record);
+
+    updatePage(spaceInfo, page);
+    freePage(page);
+}
+
+static void insertEntry(TableInfo spaceInfo, FreeSpaceEntry *entry,
+                        size_t pageId, int freeSpace) {
+    Schema spaceSchema = getInventorySchema();
+
+    struct Operand pageIdOp = {.type = INT, .value.intOp = pageId};
+    struct Operand freeSpaceOp = {.type = INT, .value.intOp = freeSpace};
+    Operand operands[] = {&pageIdOp, &freeSpaceOp};
+    AttributeName names[] = {spaceSchema.attrInfos[SPACE_ID_IDX].name,
+                             spaceSchema.attrInfos[SPACE_FREE_IDX].name};
+
+    struct QueryValues values = {.values = operands, .numValues = 2};
+    struct QueryAttributes attributes = {.attributes = names,
+                                         .numAttributes = 2};
+
+    Record record = parseQuery(&spaceSchema, &attributes, &values,
+                               spaceInfo->header->globalIdx);
+    RecordId id = insertRecord(spaceInfo, NULL, record, FREE_MAP);
+    freeRecord(record);
+
+    entry->inventoryPageId = id.pageId;
+    entry->inventorySlot = id.slotIdx;
+    entry->stored = true;
+}
+
+void persistFreeSpaceMap(TableInfo spaceInfo) {
+    FreeSpaceMap map = spaceInfo->freeSpaceMap;
+
+    if (map == NULL || map->numDirty == 0) {
+        return;
+    }
+
+    for (size_t pageId = 1; pageId < map->capacity; pageId++) {
+        FreeSpaceEntry *entry = &map->entries[pageId];
+
+        if (!entry->dirty) {
+            continue;
+        }
+
+        int freeSpace = map->tree[map->capacity + pageId];
+        if (entry->stored) {
+            updateStoredEntry(spaceInfo, entry, freeSpace);
+        } else {
+            insertEntry(spaceInfo, entry, pageId, freeSpace);
+        }
+
+        entry->dirty = false;
+    }
+
+    map->numDirty = 0;
+}
+
+void freeFreeSpaceMap(FreeSpaceMap map) {
+    if (map == NULL) {
+        return;
+    }
+
+    free(map->tree);
+    free(map->entries);
+    free(map);
+}
@@ -0,0 +1,43 @@
+#ifndef FREE_SPACE_MAP_H
+#define FREE_SPACE_MAP_H
+
+#include <stddef.h>
+
+#include "table.h"
+
+#define NO_FREE_PAGE 0
+
+typedef struct FreeSpaceMap *FreeSpaceMap;
+
+/**
+ * Finds page with smallest index that has at least requiredSpace bytes free.
+ * The map is loaded from the space inventory on first use
+ * @param spaceInfo space inventory of relation
+ * @param requiredSpace number of free bytes needed
+ * @return index of page, or NO_FREE_PAGE if no page has enough space
+ */
+extern size_t findFreePage(TableInfo spaceInfo, size_t requiredSpace);
+
+/**
+ * Records free space of page, adding the page to the map if not present.
+ * The change is written to the space inventory when the map is persisted
+ * @param spaceInfo space inventory of relation
+ * @param pageId index of page in relation
+ * @param freeSpace free bytes in page
+ */
+extern void setPageFreeSpace(TableInfo spaceInfo, size_t pageId,
+                             int freeSpace);
+
+/**
+ * Writes modified entries of the free space map back to the space inventory
+ * @param spaceInfo space inventory of relation
+ */
+extern void persistFreeSpaceMap(TableInfo spaceInfo);
+
+/**
+ * Frees free space map without persisting it
+ * @param map
+ */
+extern void freeFreeSpaceMap(FreeSpaceMap map);
+
+#endif  // FREE_SPACE_MAP_H
@@ -2,20 +2,19 @@
 
 #include <assert.h>
 #include <limits.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
-#include "../operations/insert.h"
-#include "../schema.h"
+#include "bufferPool.h"
+#include "freeSpaceMap.h"
 #include "log.h"
 #include "record.h"
-#include "recordArray.h"
-#include "table/operations/operation.h"
-#include "table/operations/select.h"
-#include "table/operations/sqlToOperation.h"
 
 #define INITIAL_NUM_SLOTS 10
 
+static pthread_mutex_t headerLock = PTHREAD_MUTEX_INITIALIZER;
+
 static void initialisePageHeaderSlots(PageHeader header) {
     unsigned capacity = header->slots.size > 0 ? header->slots.size : 1;
 
@@ -85,41 +84,47 @@ uint8_t *getRawPage(FILE *table, size_t pageSize, size_t pageId) {
 }
 
 Page getPage(TableInfo table, size_t pageId) {
-    const size_t pageSize = table->header->pageSize;
-
-    Page page = malloc(sizeof(struct Page));
-    assert(page != NULL);
-
-    uint8_t *ptr = getRawPage(table->table, pageSize, pageId);
+    Page page = pinPage(table, pageId);
 
-    page->ptr = ptr;
-    page->header = getPageHeader(ptr);
-    page->pageId = pageId;
+    // Header is only parsed when the page is first loaded into the pool, by
+    // whichever reader sharing the page gets there first
+    pthread_mutex_lock(&headerLock);
+    if (page->header == NULL) {
+        page->header = getPageHeader(page->ptr);
+    }
+    pthread_mutex_unlock(&headerLock);
 
-    fseek(table->table, 0, SEEK_SET);
     return page;
 }
 
 Page addPage(TableInfo table) {
-    size_t pageSize = table->header->pageSize;
-
-    Page page = malloc(sizeof(struct Page));
-    assert(page != NULL);
-
-    uint8_t *ptr = malloc(sizeof(uint8_t) * pageSize);
-    assert(ptr != NULL);
-
     table->header->numPages++;
 
-    page->ptr = ptr;
+    if (table->map != NULL) {
+        growTableMapping(table, table->header->numPages);
+    }
+
+    Page page = pinNewPage(table, table->header->numPages);
     page->header = initialisePageHeader();
-    page->pageId = table->header->numPages;
+
     // The page is written back to the database file lazily
     table->header->modified = true;
 
     return page;
 }
 
+// Only bytes that differ are written, so rewriting an unchanged header does
+// not force the undo image of a memory-mapped page
+static void writeHeaderBytes(Page page, size_t idx, const void *value,
+                             size_t width) {
+    if (memcmp(page->ptr + idx, value, width) == 0) {
+        return;
+    }
+
+    preparePageChange(page);
+    memcpy(page->ptr + idx, value, width);
+}
+
 static void writePageHeader(Page page) {
     PageHeader header = page->header;
 
@@ -127,33 +132,37 @@ static void writePageHeader(Page page) {
         return;
     }
 
-    uint8_t *ptr = page->ptr;
-
-    memcpy(ptr + NUM_SLOTS_IDX, &header->slots.size, NUM_SLOTS_WIDTH);
-    memcpy(ptr + RECORD_START_IDX, &header->recordStart, NUM_SLOTS_WIDTH);
-    memcpy(ptr + FREE_SPACE_IDX, &header->freeSpace, NUM_SLOTS_WIDTH);
+    writeHeaderBytes(page, NUM_SLOTS_IDX, &header->slots.size,
+                     NUM_SLOTS_WIDTH);
+    writeHeaderBytes(page, RECORD_START_IDX, &header->recordStart,
+                     NUM_SLOTS_WIDTH);
+    writeHeaderBytes(page, FREE_SPACE_IDX, &header->freeSpace,
+                     NUM_SLOTS_WIDTH);
 
     for (int i = 0; i < header->slots.size; i++) {
-        RecordSlot currentSlot = header->slots.slots[i];
+        RecordSlot *currentSlot = &header->slots.slots[i];
 
         // Writes only modified slots to the page
-        if (!currentSlot.modified) {
+        if (!currentSlot->modified) {
             continue;
         }
 
-        memcpy(ptr + POS_ARRAY_IDX + i * (OFFSET_WIDTH + SIZE_WIDTH),
-               &currentSlot.offset, OFFSET_WIDTH);
-        memcpy(ptr + POS_ARRAY_IDX + i * (OFFSET_WIDTH + SIZE_WIDTH) +
-                   OFFSET_WIDTH,
-               &currentSlot.size, SIZE_WIDTH);
+        writeHeaderBytes(page, POS_ARRAY_IDX + i * SLOT_SIZE,
+                         &currentSlot->offset, OFFSET_WIDTH);
+        writeHeaderBytes(page, POS_ARRAY_IDX + i * SLOT_SIZE + OFFSET_WIDTH,
+                         &currentSlot->size, SIZE_WIDTH);
+        currentSlot->modified = false;
     }
+
+    // Header is cached with the page so is now in sync with its memory block
+    header->modified = false;
 }
 
-void freePage(Page page) {
-    free(page->ptr);
-    free(page->header->slots.slots);
-    free(page->header);
-    free(page);
+void freePage(Page page) { unpinPage(page); }
+
+void freePageHeader(PageHeader header) {
+    free(header->slots.slots);
+    free(header);
 }
 
 PageHeader initialisePageHeader() {
@@ -182,7 +191,8 @@ static void resizeRecordSlots(RecordSlotArray *array) {
     assert(array->slots != NULL);
 }
 
-void updatePageHeaderInsert(Record record, Page page, uint16_t recordStart) {
+uint16_t updatePageHeaderInsert(Record record, Page page,
+                                uint16_t recordStart) {
     static int numInserted = 0;
 
     // Updates free space log in page header
@@ -200,7 +210,7 @@ void updatePageHeaderInsert(Record record, Page page, uint16_t recordStart) {
             slot->size = record->size;
             slot->offset = recordStart;
             slot->modified = true;
-            return;
+            return i;
         }
         assert(slot->offset != 0);
     }
@@ -214,30 +224,8 @@ void updatePageHeaderInsert(Record record, Page page, uint16_t recordStart) {
     newSlot->offset = recordStart;
     newSlot->modified = true;
     page->header->freeSpace -= SLOT_SIZE;
-}
-
-QueryResult getFreeSpaces(TableInfo spaceInfo, size_t recordSize) {
-    char template[] = "select * from %s where FREE_SPACE >= %d;";
-    char sql[300];
-    // Assumes in the worst case that a new slot needs to be added to the end
-    snprintf(sql, sizeof(sql), template, spaceInfo->name, recordSize + SLOT_SIZE);
-    Schema spaceSchema = getInventorySchema();
-    QueryResult res = selectOperation(spaceInfo, &spaceSchema, sqlToOperation(sql));
-
-    return res;
-}
 
-static void insertFreeSpace(TableInfo spaceInfo, Page page) {
-    LOG("Inserting free space");
-
-    int id = page->pageId;
-    int freeSpace = page->header->freeSpace;
-
-    char template[] = "insert into %s values (%d, %d);";
-    char sql[100];
-    snprintf(sql, sizeof(sql), template, spaceInfo->name, id, freeSpace);
-    Schema spaceSchema = getInventorySchema();
-    insertOperation(spaceInfo, NULL, &spaceSchema, sqlToOperation(sql), FREE_MAP);
+    return page->header->slots.size - 1;
 }
 
 Page nextFreePage(TableInfo tableInfo, TableInfo spaceInfo, size_t recordSize,
@@ -251,41 +239,34 @@ Page nextFreePage(TableInfo tableInfo, TableInfo spaceInfo, size_t recordSize,
                 recordSize + OFFSET_WIDTH + SIZE_WIDTH) {
                 return page;
             }
+
+            freePage(page);
         }
 
         // Adds page if no pages found
         return addPage(tableInfo);
     }
 
-    // Gets all pages with sufficient free space from the space inventory
-    QueryResult spaceMapRes = getFreeSpaces(spaceInfo, recordSize);
+    // Assumes in the worst case that a new slot needs to be added to the end
+    size_t pageId = findFreePage(spaceInfo, recordSize + SLOT_SIZE);
 
-    if (spaceMapRes->records->size == 0) {
+    if (pageId == NO_FREE_PAGE) {
         Page page = addPage(tableInfo);
-
-        insertFreeSpace(spaceInfo, page);
-        freeRecordArray(spaceMapRes->records);
-        free(spaceMapRes);
+        setPageFreeSpace(spaceInfo, page->pageId, page->header->freeSpace);
         return page;
     }
 
-    // Returns first page with sufficient space
-    size_t pageId =
-        spaceMapRes->records->records[0]->fields[SPACE_ID_IDX].intValue;
-
-    freeRecordArray(spaceMapRes->records);
-    free(spaceMapRes);
-
     return getPage(tableInfo, pageId);
 }
 
+void beginPageUpdate(Page page) { preparePageChange(page); }
+
 void updatePage(TableInfo tableInfo, Page page) {
     // Updates page header if modified
     writePageHeader(page);
 
-    fseek(tableInfo->table, _PAGE_SIZE * page->pageId, SEEK_SET);
-    fwrite(page->ptr, sizeof(uint8_t), _PAGE_SIZE, tableInfo->table);
-    fseek(tableInfo->table, 0, SEEK_SET);
+    // Page is written back when evicted or when the table is closed
+    markPageDirty(tableInfo, page);
 }
 
 void defragmentRecords(Page page) {
@@ -322,6 +303,7 @@ void defragmentRecords(Page page) {
         }
 
         // Shifts record if size of record is less than offset to next record
+        preparePageChange(page);
         memmove(page->ptr + recordStart, page->ptr + slot->offset,
                 sizeof(uint8_t) * slot->size);
 
@@ -5,6 +5,7 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#include "bufferPool.h"
 #include "table.h"
 
 #define START_PAGE 1
@@ -38,10 +39,12 @@ struct Page {
     uint8_t *ptr;
     PageHeader header;
     uint16_t pageId;
+    BufferFrame frame;  // Frame caching the page, or NULL if uncached
 };
 
 /**
- * Allocates and returns page from file at given index
+ * Pins and returns page at given index from the buffer pool, reading it from
+ * file on a miss
  * @param table
  * @param pageId index of page
  * @return Page containing pointer to memory block and header
@@ -49,11 +52,17 @@ struct Page {
 extern Page getPage(TableInfo table, size_t pageId);
 
 /**
- * Frees page
+ * Releases page back to the buffer pool
  * @param page
  */
 extern void freePage(Page page);
 
+/**
+ * Frees page header and slot array
+ * @param header
+ */
+extern void freePageHeader(PageHeader header);
+
 /**
  * Returns page with smallest index that has enough free space to fit
  * record of size recordSize
@@ -72,7 +81,15 @@ extern Page nextFreePage(TableInfo tableInfo, TableInfo spaceInfo,
  */
 extern PageHeader initialisePageHeader();
 
-extern void updatePageHeaderInsert(Record record, Page page, uint16_t recordStart);
+/**
+ * Updates page header and slot array for record written at recordStart
+ * @param record inserted record
+ * @param page page containing record
+ * @param recordStart offset of record in page
+ * @return index of slot pointing to record
+ */
+extern uint16_t updatePageHeaderInsert(Record record, Page page,
+                                       uint16_t recordStart);
 
 /**
  * Adds new page to database file
@@ -91,20 +108,18 @@ extern Page addPage(TableInfo table);
 extern uint8_t *getRawPage(FILE *table, size_t pageSize, size_t pageId);
 
 /**
- * Updates and writes page to disk
- * @param tableInfo
- * @param page
+ * Must be called before records of page are first written in place, so that
+ * pages of memory-mapped tables can be restored if the operation fails
+ * @param page page about to be written
  */
-extern void updatePage(TableInfo tableInfo, Page page);
+extern void beginPageUpdate(Page page);
 
 /**
- * Inserts entry for free space in page to space inventory
- * @param tableName name of table
- * @param spaceInfo space map
- * @param page page to add to space map
+ * Updates page header and marks page to be written back to disk
+ * @param tableInfo
+ * @param page
  */
-extern void addPageToSpaceInventory(char *tableName, TableInfo spaceInfo,
-                                    Page page);
+extern void updatePage(TableInfo tableInfo, Page page);
 
 /**
  * Reads raw bytes into record slot
@@ -119,6 +134,4 @@ extern void getRecordSlot(RecordSlot *slot, uint8_t *idx);
  */
 extern void defragmentRecords(Page page);
 
-extern QueryResult getFreeSpaces(TableInfo spaceInfo, size_t recordSize);
-
 #endif  // PAGES_H
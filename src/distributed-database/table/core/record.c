@@ -1,6 +1,8 @@
 #include "record.h"
 
 #include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "log.h"
@@ -212,6 +214,40 @@ Record parseRecord(uint8_t *ptr, Schema *schema) {
     return record;
 }
 
+RecordView getRecordView(uint8_t *ptr, Schema *schema) {
+    uint16_t numVars;
+    memcpy(&numVars, ptr, RECORD_HEADER_WIDTH);
+
+    RecordView view = {
+        .ptr = ptr,
+        .staticFields = ptr + RECORD_HEADER_WIDTH + numVars * OFFSET_WIDTH +
+                        GLOBAL_ID_WIDTH,
+        .schema = schema};
+    return view;
+}
+
+uint8_t *getViewField(RecordView *view, unsigned attrIdx, unsigned *size) {
+    AttrInfo *info = &view->schema->attrInfos[attrIdx];
+
+    if (info->type == VARSTR) {
+        *size = getFieldSize(view->ptr, info->loc);
+        return view->ptr + getFieldOffset(view->ptr, info->loc);
+    }
+
+    *size = info->size;
+    return view->staticFields + info->loc;
+}
+
+uint32_t getViewGlobalIdx(RecordView *view) {
+    uint32_t globalIdx;
+    memcpy(&globalIdx, view->staticFields - GLOBAL_ID_WIDTH, GLOBAL_ID_WIDTH);
+    return globalIdx;
+}
+
+Record materialiseRecord(RecordView *view) {
+    return parseRecord(view->ptr, view->schema);
+}
+
 static unsigned countNumVarFields(Record record) {
     int numVar = 0;
     for (int i = 0; i < record->numValues; i++) {
@@ -275,6 +311,34 @@ void initialiseRecordIterator(RecordIterator iterator) {
     iterator->page = NULL;
     iterator->pageId = 1;
     iterator->slotIdx = 0;
+    iterator->lastSlot = NULL;
+    iterator->pageIds = NULL;
+    iterator->numPageIds = 0;
+    iterator->pageIdx = 0;
+}
+
+void restrictRecordIterator(RecordIterator iterator, uint32_t *pageIds,
+                            size_t numPageIds) {
+    assert(iterator->page == NULL);
+
+    iterator->pageIds = pageIds;
+    iterator->numPageIds = numPageIds;
+    iterator->pageIdx = 0;
+
+    // Page 0 holds the table header, so no listed pages ends iteration
+    iterator->pageId = numPageIds > 0 ? pageIds[0] : SIZE_MAX;
+}
+
+static void moveToNextPage(RecordIterator iterator) {
+    if (iterator->pageIds == NULL) {
+        iterator->pageId++;
+        return;
+    }
+
+    iterator->pageIdx++;
+    iterator->pageId = iterator->pageIdx < iterator->numPageIds
+                           ? iterator->pageIds[iterator->pageIdx]
+                           : SIZE_MAX;
 }
 
 bool iterateRecords(TableInfo tableInfo,
@@ -292,15 +356,17 @@ bool iterateRecords(TableInfo tableInfo,
         if (recordIterator->page == NULL) {
             recordIterator->page = getPage(tableInfo, recordIterator->pageId);
             recordIterator->slotIdx = 0;
+            recordIterator->lastSlot = NULL;
         }
 
         // If end of slot array encountered, moves to next page
         if (recordIterator->slotIdx ==
             recordIterator->page->header->slots.size) {
-            recordIterator->pageId++;
+            moveToNextPage(recordIterator);
 
-            // Frees previous page if not used elsewhere
-            if (autoClearPage) {
+            // Frees previous page if not used elsewhere, where a page that
+            // yielded no records is never seen by the caller
+            if (autoClearPage || recordIterator->lastSlot == NULL) {
                 freePage(recordIterator->page);
             }
 
@@ -324,7 +390,10 @@ bool iterateRecords(TableInfo tableInfo,
     return false;
 }
 
-void freeRecordIterator(RecordIterator iterator) {}
+void freeRecordIterator(RecordIterator iterator) {
+    free(iterator->pageIds);
+    iterator->pageIds = NULL;
+}
 
 void outputRecord(Record record) {
     for (int i = 0; i < record->numValues; i++) {
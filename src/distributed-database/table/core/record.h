@@ -14,12 +14,23 @@ struct Record {
     uint32_t globalIdx;
 };
 
+// Read-only view of a record in place within its page
+typedef struct RecordView RecordView;
+struct RecordView {
+    uint8_t *ptr;           // Start of record
+    uint8_t *staticFields;  // Start of static fields after global index
+    Schema *schema;
+};
+
 typedef struct RecordIterator *RecordIterator;
 struct RecordIterator {
     size_t pageId;
     int slotIdx;
     Page page;
     RecordSlot *lastSlot;
+    uint32_t *pageIds;  // Ascending pages to visit, or NULL for all pages
+    size_t numPageIds;
+    size_t pageIdx;     // Position of current page in pageIds
 };
 
 /**
@@ -47,6 +58,49 @@ extern Record parseQuery(Schema *schema, QueryAttributes attributes,
  */
 extern Record parseRecord(uint8_t *ptr, Schema *schema);
 
+/**
+ * Creates view over raw record bytes without copying any fields
+ * @param ptr pointer to start of record
+ * @param schema schema of record
+ */
+extern RecordView getRecordView(uint8_t *ptr, Schema *schema);
+
+/**
+ * Locates field in place within viewed record
+ * @param view
+ * @param attrIdx index of attribute in schema
+ * @param size set to size of field in bytes
+ * @return pointer to start of field in page
+ */
+extern uint8_t *getViewField(RecordView *view, unsigned attrIdx,
+                             unsigned *size);
+
+/**
+ * Reads global index of viewed record
+ * @param view
+ */
+extern uint32_t getViewGlobalIdx(RecordView *view);
+
+/**
+ * Reads offset of variable-length field from its slot in a raw record
+ * @param recordPtr pointer to start of record
+ * @param slotIdx index of variable-length field slot
+ */
+extern uint16_t getFieldOffset(uint8_t *recordPtr, unsigned slotIdx);
+
+/**
+ * Reads size of variable-length field from its slot in a raw record
+ * @param recordPtr pointer to start of record
+ * @param slotIdx index of variable-length field slot
+ */
+extern uint16_t getFieldSize(uint8_t *recordPtr, unsigned slotIdx);
+
+/**
+ * Materialises viewed record into Record with copied fields
+ * @param view
+ */
+extern Record materialiseRecord(RecordView *view);
+
 /**
  * Writes record to page starting backwards from recordEnd
  * @param page page to write record to
@@ -86,6 +140,16 @@ extern void outputRecord(Record record);
  */
 extern void initialiseRecordIterator(RecordIterator iterator);
 
+/**
+ * Limits iterator to the given pages before it is first advanced. The
+ * iterator takes ownership of the array
+ * @param iterator initialised iterator
+ * @param pageIds malloc'd array of ascending page ids
+ * @param numPageIds number of pages to visit
+ */
+extern void restrictRecordIterator(RecordIterator iterator, uint32_t *pageIds,
+                                   size_t numPageIds);
+
 extern void removeRecord(Page page, RecordSlot *slot, size_t recordSize);
 
 #endif //RECORD_H
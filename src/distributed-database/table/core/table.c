@@ -5,21 +5,31 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include "bufferPool.h"
+#include "freeSpaceMap.h"
 #include "log.h"
 #include "pages.h"
 #include "record.h"
 #include "recordArray.h"
-#include "table/operations/sqlToOperation.h"
-#include "table/operations/update.h"
+#include "table/index/tableIndexes.h"
+#include "wal.h"
 
 #define INITIAL_NUM_PAGES 0
 #define INITIAL_START_PAGE (-1)
 #define INITIAL_GLOBAL_IDX 0
 
+// Bytes of the table header at the start of the header page
+#define TABLE_HEADER_SIZE (GLOBAL_ID_IDX + GLOBAL_ID_WIDTH)
+
 // Global database directory
 char DB_DIRECTORY[MAX_FILE_NAME_LEN] = {'\0'};
 
+StorageMode TABLE_STORAGE_MODE = STORAGE_STDIO;
+
 static void initialiseHeader(FILE *headerptr) {
     fseek(headerptr, PAGE_SIZE_IDX, SEEK_SET);
 
@@ -42,11 +52,120 @@ void initialiseTable(char *name) {
     FILE *table = fopen(tableFile, "wb+");
     assert(table != NULL);
 
+    // Cached pages belong to the previous contents of the file
+    invalidateTablePages(name);
+
+    // Table must exist on disk before operations on it are logged
     initialiseHeader(table);
+    fflush(table);
+    fsync(fileno(table));
     fclose(table);
 }
 
+static void extendMapping(TableInfo tableInfo, size_t newSize) {
+    assert(newSize <= tableInfo->mapReserved);
+
+    int fd = fileno(tableInfo->table);
+
+    // Pending header writes must reach the file before it is resized
+    fflush(tableInfo->table);
+    int res = ftruncate(fd, newSize);
+    assert(res == 0);
+
+    // Maps new part of file directly after existing mapping
+    void *ptr = mmap(tableInfo->map + tableInfo->mapSize,
+                     newSize - tableInfo->mapSize, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_FIXED, fd, tableInfo->mapSize);
+    assert(ptr != MAP_FAILED);
+
+    tableInfo->mapSize = newSize;
+}
+
+static void mapTable(TableInfo tableInfo) {
+    struct stat fileStat;
+    int res = fstat(fileno(tableInfo->table), &fileStat);
+    assert(res == 0);
+
+    // Header page may be shorter than a full page on disk
+    size_t fileSize = fileStat.st_size;
+    size_t mapSize = (fileSize + _PAGE_SIZE - 1) / _PAGE_SIZE * _PAGE_SIZE;
+    size_t minSize = (tableInfo->header->numPages + 1) * _PAGE_SIZE;
+    if (mapSize < minSize) {
+        mapSize = minSize;
+    }
+
+    // Reserves address space so mapping never moves when the file grows,
+    // leaving room for large tables to double in size
+    size_t reserveSize = mapSize * 2;
+    if (reserveSize < MMAP_RESERVE_SIZE) {
+        reserveSize = MMAP_RESERVE_SIZE;
+    }
+
+    void *reserved = mmap(NULL, reserveSize, PROT_NONE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    assert(reserved != MAP_FAILED);
+
+    tableInfo->map = reserved;
+    tableInfo->mapSize = 0;
+    tableInfo->mapReserved = reserveSize;
+
+    extendMapping(tableInfo, mapSize);
+}
+
+static void unmapTable(TableInfo tableInfo) {
+    syncTableFile(tableInfo);
+
+    // Frames cannot outlive the mapping they point into
+    invalidateTablePages(tableInfo->name);
+
+    munmap(tableInfo->map, tableInfo->mapReserved);
+    tableInfo->map = NULL;
+    tableInfo->mapSize = 0;
+    tableInfo->mapReserved = 0;
+}
+
+void growTableMapping(TableInfo tableInfo, size_t numPages) {
+    size_t required = (numPages + 1) * _PAGE_SIZE;
+
+    if (required <= tableInfo->mapSize) {
+        return;
+    }
+
+    // Grows geometrically to amortise remapping
+    size_t newSize = tableInfo->mapSize * 2;
+    if (newSize < required) {
+        newSize = required;
+    }
+
+    // Pages beyond a full reservation are accessed through stdio instead
+    if (newSize > tableInfo->mapReserved) {
+        newSize = tableInfo->mapReserved;
+    }
+    if (newSize <= tableInfo->mapSize) {
+        return;
+    }
+
+    extendMapping(tableInfo, newSize);
+}
+
+void syncTableFile(TableInfo tableInfo) {
+    fflush(tableInfo->table);
+
+    if (tableInfo->map != NULL) {
+        msync(tableInfo->map, tableInfo->mapSize, MS_SYNC);
+    }
+
+    fsync(fileno(tableInfo->table));
+}
+
 void freeTable(TableInfo tableInfo) {
+    persistFreeSpaceMap(tableInfo);
+    freeFreeSpaceMap(tableInfo->freeSpaceMap);
+    closeTableIndexes(tableInfo->indexes);
+    flushTablePages(tableInfo);
+    if (tableInfo->map != NULL) {
+        unmapTable(tableInfo);
+    }
     fclose(tableInfo->table);
     free(tableInfo->header);
     free(tableInfo);
@@ -66,6 +185,15 @@ TableInfo openTable(char *tableName) {
     tableInfo->table = table;
     tableInfo->name = strdup(tableName);
     tableInfo->header = getTableHeader(table);
+    tableInfo->freeSpaceMap = NULL;
+    tableInfo->indexes = NULL;
+    tableInfo->map = NULL;
+    tableInfo->mapSize = 0;
+    tableInfo->mapReserved = 0;
+
+    if (TABLE_STORAGE_MODE == STORAGE_MMAP) {
+        mapTable(tableInfo);
+    }
 
     return tableInfo;
 }
@@ -108,25 +236,42 @@ void updateTableHeader(TableInfo tableInfo) {
         fwrite(&header->globalIdx, sizeof(uint8_t), GLOBAL_ID_WIDTH,
                tableInfo->table);
         fseek(tableInfo->table, 0, SEEK_SET);
+        header->modified = false;
     }
 }
 
-void updateSpaceInventory(TableInfo spaceInventory,
-                          Page page) {
-    int id = page->pageId;
-    int freeSpace = page->header->freeSpace;
+void logTableHeader(TableInfo tableInfo) {
+    TableHeader header = tableInfo->header;
 
-    // Update space inventory table with new free space in page
-    char template[] = "update %s set FREE_SPACE = %d where PAGE_ID = %d;";
-    char sql[100];
+    if (!header->modified) {
+        return;
+    }
+
+    uint8_t headerBytes[TABLE_HEADER_SIZE];
+    memcpy(headerBytes + PAGE_SIZE_IDX, &header->pageSize, PAGE_SIZE_WIDTH);
+    memcpy(headerBytes + NUM_PAGES_IDX, &header->numPages, PAGE_ID_WIDTH);
+    memcpy(headerBytes + GLOBAL_ID_IDX, &header->globalIdx, GLOBAL_ID_WIDTH);
 
-    snprintf(sql, sizeof(sql), template, spaceInventory->name, freeSpace, id);
-    Schema spaceSchema = getInventorySchema();
-    updateOperation(spaceInventory, NULL, &spaceSchema, sqlToOperation(sql));
+    logPageWrite(tableInfo->name, TABLE_HEADER_PAGE, PAGE_SIZE_IDX,
+                 headerBytes, TABLE_HEADER_SIZE);
+}
+
+void updateSpaceInventory(TableInfo spaceInventory, Page page) {
+    // Free space is written to the space inventory when the map is persisted
+    setPageFreeSpace(spaceInventory, page->pageId, page->header->freeSpace);
 }
 
 void closeTable(TableInfo tableInfo) {
+    persistFreeSpaceMap(tableInfo);
+    freeFreeSpaceMap(tableInfo->freeSpaceMap);
+    closeTableIndexes(tableInfo->indexes);
     updateTableHeader(tableInfo);
+    flushTablePages(tableInfo);
+    if (tableInfo->map != NULL) {
+        unmapTable(tableInfo);
+    } else {
+        syncTableFile(tableInfo);
+    }
     fclose(tableInfo->table);
     free(tableInfo->header);
     free(tableInfo->name);
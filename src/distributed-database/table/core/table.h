@@ -41,15 +41,26 @@
 #define SLOT_SIZE (OFFSET_WIDTH + SIZE_WIDTH)
 
 #define SPACE_ID_IDX 0
-#define SPACE_NAME_IDX 1
-#define SPACE_FREE_IDX 2
+#define SPACE_FREE_IDX 1
+
+// Minimum virtual address space reserved for each memory-mapped table file,
+// so that the mapping can grow in place without moving pages in use. Pages
+// beyond the reservation are accessed through stdio
+#define MMAP_RESERVE_SIZE ((size_t)1 << 30)  // 1 GB
 
 extern char DB_DIRECTORY[MAX_FILE_NAME_LEN];
 
+typedef enum { STORAGE_STDIO, STORAGE_MMAP } StorageMode;
+
+// Storage mode used for tables opened from now on
+extern StorageMode TABLE_STORAGE_MODE;
+
 typedef struct Page *Page;
 typedef struct Record *Record;
 typedef struct RecordIterator *RecordIterator;
 typedef struct RecordArray *RecordArray;
+typedef struct FreeSpaceMap *FreeSpaceMap;
+typedef struct TableIndexes *TableIndexes;
 
 typedef enum { RELATION, SCHEMA, FREE_MAP } TableType;
 
@@ -66,6 +77,17 @@ struct TableInfo {
     FILE *table;
     TableHeader header;
     char *name;
+    FreeSpaceMap freeSpaceMap;  // Loaded on first use for space inventories
+    TableIndexes indexes;       // Loaded by the catalog for relations
+    uint8_t *map;               // Mapping of table file, or NULL for stdio
+    size_t mapSize;
+    size_t mapReserved;  // Address space reserved for the mapping to grow
+};
+
+typedef struct RecordId RecordId;
+struct RecordId {
+    uint32_t pageId;
+    uint16_t slotIdx;
 };
 
 typedef struct QueryResult *QueryResult;
@@ -98,6 +120,13 @@ extern TableHeader getTableHeader(FILE *table);
  */
 extern void updateTableHeader(TableInfo tableInfo);
 
+/**
+ * Logs table header as a redo record if it was modified, so that it can be
+ * written to the table file once the operation commits
+ * @param tableInfo table to log
+ */
+extern void logTableHeader(TableInfo tableInfo);
+
 /**
  * Updates space inventory using page
  * @param tableName table with associate space map
@@ -114,6 +143,21 @@ extern void updateSpaceInventory(TableInfo spaceInventory,
  */
 extern int compareSlots(const void *slot1, const void *slot2);
 
+/**
+ * Extends file and mapping of memory-mapped table to hold numPages data pages,
+ * as far as its reserved address space allows
+ * @param tableInfo memory-mapped table
+ * @param numPages number of data pages needed
+ */
+extern void growTableMapping(TableInfo tableInfo, size_t numPages);
+
+/**
+ * Flushes buffered writes of table to its file and forces the file to disk,
+ * synchronously writing the mapping of memory-mapped tables
+ * @param tableInfo
+ */
+extern void syncTableFile(TableInfo tableInfo);
+
 /**
  * Closes table file and frees tableInfo
  * @param tableInfo
@@ -0,0 +1,571 @@
+#include "wal.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "log.h"
+
+#define WAL_FILE_NAME "wal.log"
+#define WAL_TEMP_FILE_NAME "wal.log.tmp"
+#define WAL_FILE_MODE 0644
+
+// Records are gathered in memory and written out when forced or full
+#define WAL_BUFFER_SIZE (64 * 1024)
+
+#define RECORD_LENGTH_WIDTH sizeof(uint32_t)
+#define RECORD_CHECKSUM_WIDTH sizeof(uint32_t)
+#define RECORD_TYPE_WIDTH sizeof(uint8_t)
+#define WAL_RECORD_HEADER_WIDTH \
+    (RECORD_LENGTH_WIDTH + RECORD_CHECKSUM_WIDTH + RECORD_TYPE_WIDTH)
+
+#define NAME_LENGTH_WIDTH sizeof(uint8_t)
+#define LOG_INDEX_WIDTH sizeof(int32_t)
+#define RUN_OFFSET_WIDTH sizeof(uint16_t)
+#define RUN_LENGTH_WIDTH sizeof(uint16_t)
+#define RUN_HEADER_WIDTH (RUN_OFFSET_WIDTH + RUN_LENGTH_WIDTH)
+
+#define PAGE_RECORD_HEADER_WIDTH \
+    (NAME_LENGTH_WIDTH + MAX_TABLE_NAME_LEN + PAGE_ID_WIDTH)
+
+// Runs are separated by more equal bytes than a run header, so a page holds
+// at most one run for every two of its bytes
+#define MAX_REDO_RECORD_LENGTH                                       \
+    (PAGE_RECORD_HEADER_WIDTH + (_PAGE_SIZE / 2 + 1) * RUN_HEADER_WIDTH + \
+     _PAGE_SIZE)
+
+// Redo records hold the changed byte ranges of a page and undo records the
+// image of a page before an operation that has not committed. Commit and
+// checkpoint records hold the index of the last applied raft log entry
+typedef enum { PAGE_REDO = 1, PAGE_UNDO, COMMIT, CHECKPOINT } RecordType;
+
+typedef struct WalRecord WalRecord;
+struct WalRecord {
+    RecordType type;
+    uint8_t *payload;
+    size_t length;
+};
+
+// Table files written while recovering, kept open until they are forced
+typedef struct RecoveredTable *RecoveredTable;
+struct RecoveredTable {
+    char name[MAX_TABLE_NAME_LEN];
+    FILE *file;  // NULL if the table no longer exists
+    RecoveredTable next;
+};
+
+static int walFd = -1;
+static uint8_t buffer[WAL_BUFFER_SIZE];
+static size_t bufferSize = 0;
+static size_t walSize = 0;  // Bytes written and buffered since checkpoint
+static int appliedIndex = NO_LOG_INDEX;
+static pthread_mutex_t walLock = PTHREAD_MUTEX_INITIALIZER;
+
+static void getWalPath(char *fileName, char *dest) {
+    int len = snprintf(dest, MAX_FILE_NAME_LEN, "%s/%s", DB_BASE_DIRECTORY,
+                       fileName);
+    assert(len < MAX_FILE_NAME_LEN);
+}
+
+static uint32_t getChecksum(uint8_t *data, size_t length) {
+    // FNV-1a, which is enough to detect a record torn by a crash
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static void writeAll(int fd, uint8_t *data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written < 0) {
+            LOG_PERROR("Failed to write write-ahead log");
+        }
+
+        data += written;
+        length -= written;
+    }
+}
+
+static void writeBuffer(void) {
+    writeAll(walFd, buffer, bufferSize);
+    bufferSize = 0;
+}
+
+static void forceWal(void);
+static void appendLogIndex(RecordType type);
+
+static void openWal(void) {
+    if (walFd >= 0) {
+        return;
+    }
+
+    char path[MAX_FILE_NAME_LEN];
+    getWalPath(WAL_FILE_NAME, path);
+
+    walFd = open(path, O_RDWR | O_CREAT | O_APPEND, WAL_FILE_MODE);
+    if (walFd < 0) {
+        LOG_PERROR("Failed to open write-ahead log");
+    }
+
+    struct stat fileStat;
+    int res = fstat(walFd, &fileStat);
+    assert(res == 0);
+    walSize = fileStat.st_size;
+
+    // New log starts from a checkpoint of the tables as they are
+    if (walSize == 0) {
+        appendLogIndex(CHECKPOINT);
+        forceWal();
+    }
+}
+
+static void forceWal(void) {
+    openWal();
+    writeBuffer();
+
+    if (fdatasync(walFd) != 0) {
+        LOG_PERROR("Failed to force write-ahead log");
+    }
+}
+
+static uint8_t *startRecord(size_t maxLength) {
+    assert(WAL_RECORD_HEADER_WIDTH + maxLength <= WAL_BUFFER_SIZE);
+    openWal();
+
+    if (bufferSize + WAL_RECORD_HEADER_WIDTH + maxLength > WAL_BUFFER_SIZE) {
+        writeBuffer();
+    }
+
+    return buffer + bufferSize + WAL_RECORD_HEADER_WIDTH;
+}
+
+static void finishRecord(RecordType type, uint8_t *end) {
+    uint8_t *start = buffer + bufferSize;
+    uint8_t *typePtr = start + RECORD_LENGTH_WIDTH + RECORD_CHECKSUM_WIDTH;
+    uint32_t length = end - start - WAL_RECORD_HEADER_WIDTH;
+    *typePtr = type;
+
+    // Checksum covers type and payload, so a torn record is never replayed
+    uint32_t checksum = getChecksum(typePtr, RECORD_TYPE_WIDTH + length);
+    memcpy(start, &length, RECORD_LENGTH_WIDTH);
+    memcpy(start + RECORD_LENGTH_WIDTH, &checksum, RECORD_CHECKSUM_WIDTH);
+
+    bufferSize += end - start;
+    walSize += end - start;
+}
+
+static void appendLogIndex(RecordType type) {
+    uint8_t *start = startRecord(LOG_INDEX_WIDTH);
+    int32_t index = appliedIndex;
+    memcpy(start, &index, LOG_INDEX_WIDTH);
+    finishRecord(type, start + LOG_INDEX_WIDTH);
+}
+
+static uint8_t *writePageId(uint8_t *dest, char *tableName, size_t pageId) {
+    size_t nameLength = strlen(tableName);
+    assert(nameLength < MAX_TABLE_NAME_LEN);
+
+    *dest = nameLength;
+    memcpy(dest + NAME_LENGTH_WIDTH, tableName, nameLength);
+    dest += NAME_LENGTH_WIDTH + nameLength;
+
+    uint32_t id = pageId;
+    memcpy(dest, &id, PAGE_ID_WIDTH);
+    return dest + PAGE_ID_WIDTH;
+}
+
+static uint8_t *writeRun(uint8_t *dest, size_t offset, uint8_t *bytes,
+                         size_t length) {
+    uint16_t runOffset = offset;
+    uint16_t runLength = length;
+    memcpy(dest, &runOffset, RUN_OFFSET_WIDTH);
+    memcpy(dest + RUN_OFFSET_WIDTH, &runLength, RUN_LENGTH_WIDTH);
+    memcpy(dest + RUN_HEADER_WIDTH, bytes, length);
+    return dest + RUN_HEADER_WIDTH + length;
+}
+
+void logPageChange(char *tableName, size_t pageId, uint8_t *before,
+                   uint8_t *after) {
+    if (memcmp(before, after, _PAGE_SIZE) == 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&walLock);
+
+    uint8_t *curr = writePageId(startRecord(MAX_REDO_RECORD_LENGTH),
+                                tableName, pageId);
+
+    size_t i = 0;
+    while (i < _PAGE_SIZE) {
+        if (before[i] == after[i]) {
+            i++;
+            continue;
+        }
+
+        // Equal bytes between changes stay in the run while they take less
+        // space than the header of a new run
+        size_t end = i + 1;
+        for (size_t j = end; j < _PAGE_SIZE && j - end < RUN_HEADER_WIDTH;
+             j++) {
+            if (before[j] != after[j]) {
+                end = j + 1;
+            }
+        }
+
+        curr = writeRun(curr, i, after + i, end - i);
+        i = end;
+    }
+
+    finishRecord(PAGE_REDO, curr);
+    pthread_mutex_unlock(&walLock);
+}
+
+void logPageWrite(char *tableName, size_t pageId, size_t offset,
+                  uint8_t *bytes, size_t length) {
+    assert(offset + length <= _PAGE_SIZE);
+    pthread_mutex_lock(&walLock);
+
+    uint8_t *curr = writePageId(
+        startRecord(PAGE_RECORD_HEADER_WIDTH + RUN_HEADER_WIDTH + length),
+        tableName, pageId);
+    finishRecord(PAGE_REDO, writeRun(curr, offset, bytes, length));
+
+    pthread_mutex_unlock(&walLock);
+}
+
+void logPageImage(char *tableName, size_t pageId, uint8_t *image) {
+    pthread_mutex_lock(&walLock);
+
+    uint8_t *curr = writePageId(
+        startRecord(PAGE_RECORD_HEADER_WIDTH + _PAGE_SIZE), tableName, pageId);
+    memcpy(curr, image, _PAGE_SIZE);
+    finishRecord(PAGE_UNDO, curr + _PAGE_SIZE);
+
+    pthread_mutex_unlock(&walLock);
+}
+
+void syncWal(void) {
+    pthread_mutex_lock(&walLock);
+    forceWal();
+    pthread_mutex_unlock(&walLock);
+}
+
+void commitWal(int logIndex) {
+    pthread_mutex_lock(&walLock);
+
+    if (logIndex != NO_LOG_INDEX) {
+        appliedIndex = logIndex;
+    }
+
+    appendLogIndex(COMMIT);
+    forceWal();
+
+    pthread_mutex_unlock(&walLock);
+}
+
+size_t getWalSize(void) {
+    pthread_mutex_lock(&walLock);
+    size_t size = walSize;
+    pthread_mutex_unlock(&walLock);
+    return size;
+}
+
+int getWalAppliedIndex(void) {
+    pthread_mutex_lock(&walLock);
+    int index = appliedIndex;
+    pthread_mutex_unlock(&walLock);
+    return index;
+}
+
+static void syncDirectory(void) {
+    int fd = open(DB_BASE_DIRECTORY, O_RDONLY);
+    if (fd < 0) {
+        LOG_PERROR("Failed to open database directory");
+    }
+
+    fsync(fd);
+    close(fd);
+}
+
+static void startNewWal(void) {
+    char path[MAX_FILE_NAME_LEN];
+    char tempPath[MAX_FILE_NAME_LEN];
+    getWalPath(WAL_FILE_NAME, path);
+    getWalPath(WAL_TEMP_FILE_NAME, tempPath);
+
+    // Checkpoint is written to a new file that then replaces the log, so a
+    // crash leaves either the old or the new log in place
+    int fd = open(tempPath, O_WRONLY | O_CREAT | O_TRUNC, WAL_FILE_MODE);
+    if (fd < 0) {
+        LOG_PERROR("Failed to create write-ahead log");
+    }
+
+    if (walFd >= 0) {
+        close(walFd);
+    }
+
+    // Records still buffered are covered by the checkpoint
+    walFd = fd;
+    bufferSize = 0;
+    walSize = 0;
+
+    appendLogIndex(CHECKPOINT);
+    forceWal();
+
+    int res = rename(tempPath, path);
+    assert(res == 0);
+    syncDirectory();
+}
+
+void checkpointWal(void) {
+    pthread_mutex_lock(&walLock);
+    startNewWal();
+    pthread_mutex_unlock(&walLock);
+}
+
+void resetWal(int index) {
+    pthread_mutex_lock(&walLock);
+    appliedIndex = index;
+    startNewWal();
+    pthread_mutex_unlock(&walLock);
+}
+
+static uint8_t *readWalFile(char *path, size_t *size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0 && errno == ENOENT) {
+        return NULL;
+    }
+    if (fd < 0) {
+        LOG_PERROR("Failed to open write-ahead log");
+    }
+
+    struct stat fileStat;
+    int res = fstat(fd, &fileStat);
+    assert(res == 0);
+
+    *size = fileStat.st_size;
+    uint8_t *log = malloc(*size > 0 ? *size : 1);
+    assert(log != NULL);
+
+    size_t numRead = 0;
+    while (numRead < *size) {
+        ssize_t res = read(fd, log + numRead, *size - numRead);
+        if (res <= 0) {
+            break;
+        }
+        numRead += res;
+    }
+
+    // Torn end of the log is dropped along with any record it cuts short
+    *size = numRead;
+    close(fd);
+
+    return log;
+}
+
+static bool readRecord(uint8_t *log, size_t size, size_t *offset,
+                       WalRecord *record) {
+    if (size - *offset < WAL_RECORD_HEADER_WIDTH) {
+        return false;
+    }
+
+    uint8_t *start = log + *offset;
+    uint8_t *typePtr = start + RECORD_LENGTH_WIDTH + RECORD_CHECKSUM_WIDTH;
+
+    uint32_t length;
+    uint32_t checksum;
+    memcpy(&length, start, RECORD_LENGTH_WIDTH);
+    memcpy(&checksum, start + RECORD_LENGTH_WIDTH, RECORD_CHECKSUM_WIDTH);
+
+    if (length > size - *offset - WAL_RECORD_HEADER_WIDTH ||
+        getChecksum(typePtr, RECORD_TYPE_WIDTH + length) != checksum) {
+        return false;
+    }
+
+    record->type = *typePtr;
+    record->payload = typePtr + RECORD_TYPE_WIDTH;
+    record->length = length;
+    *offset += WAL_RECORD_HEADER_WIDTH + length;
+
+    return true;
+}
+
+static uint8_t *readPageId(uint8_t *src, char *tableName, size_t *pageId) {
+    size_t nameLength = *src;
+    memcpy(tableName, src + NAME_LENGTH_WIDTH, nameLength);
+    tableName[nameLength] = '\0';
+    src += NAME_LENGTH_WIDTH + nameLength;
+
+    uint32_t id;
+    memcpy(&id, src, PAGE_ID_WIDTH);
+    *pageId = id;
+    return src + PAGE_ID_WIDTH;
+}
+
+static FILE *getRecoveredFile(RecoveredTable *tables, char *tableName) {
+    for (RecoveredTable table = *tables; table != NULL; table = table->next) {
+        if (strcmp(table->name, tableName) == 0) {
+            return table->file;
+        }
+    }
+
+    char tableFile[MAX_FILE_NAME_LEN + MAX_TABLE_NAME_LEN];
+    snprintf(tableFile, sizeof(tableFile), "%s/%s.%s", DB_BASE_DIRECTORY,
+             tableName, DB_EXTENSION);
+
+    RecoveredTable table = malloc(sizeof(struct RecoveredTable));
+    assert(table != NULL);
+
+    strcpy(table->name, tableName);
+    table->file = fopen(tableFile, "rb+");
+    table->next = *tables;
+    *tables = table;
+
+    if (table->file == NULL) {
+        LOG("Table %s in write-ahead log no longer exists", tableName);
+    }
+
+    return table->file;
+}
+
+static void closeRecoveredFiles(RecoveredTable tables) {
+    while (tables != NULL) {
+        RecoveredTable next = tables->next;
+
+        if (tables->file != NULL) {
+            fflush(tables->file);
+            fsync(fileno(tables->file));
+            fclose(tables->file);
+        }
+
+        free(tables);
+        tables = next;
+    }
+}
+
+static void redoPage(RecoveredTable *tables, WalRecord *record) {
+    char tableName[MAX_TABLE_NAME_LEN];
+    size_t pageId;
+    uint8_t *curr = readPageId(record->payload, tableName, &pageId);
+    uint8_t *end = record->payload + record->length;
+
+    FILE *file = getRecoveredFile(tables, tableName);
+    if (file == NULL) {
+        return;
+    }
+
+    while (curr < end) {
+        uint16_t offset;
+        uint16_t length;
+        memcpy(&offset, curr, RUN_OFFSET_WIDTH);
+        memcpy(&length, curr + RUN_OFFSET_WIDTH, RUN_LENGTH_WIDTH);
+
+        fseek(file, (long)pageId * _PAGE_SIZE + offset, SEEK_SET);
+        fwrite(curr + RUN_HEADER_WIDTH, sizeof(uint8_t), length, file);
+        curr += RUN_HEADER_WIDTH + length;
+    }
+}
+
+static void undoPage(RecoveredTable *tables, WalRecord *record) {
+    char tableName[MAX_TABLE_NAME_LEN];
+    size_t pageId;
+    uint8_t *image = readPageId(record->payload, tableName, &pageId);
+
+    FILE *file = getRecoveredFile(tables, tableName);
+    if (file != NULL) {
+        fseek(file, (long)pageId * _PAGE_SIZE, SEEK_SET);
+        fwrite(image, sizeof(uint8_t), _PAGE_SIZE, file);
+    }
+}
+
+static void replayWal(uint8_t *log, size_t size) {
+    // Records after the last commit belong to an operation interrupted by
+    // the crash
+    size_t offset = 0;
+    size_t committedEnd = 0;
+    WalRecord record;
+    while (readRecord(log, size, &offset, &record)) {
+        if (record.type == COMMIT || record.type == CHECKPOINT) {
+            int32_t index;
+            memcpy(&index, record.payload, LOG_INDEX_WIDTH);
+            appliedIndex = index;
+            committedEnd = offset;
+        }
+    }
+
+    RecoveredTable tables = NULL;
+    size_t numUndone = 0;
+    size_t numRedone = 0;
+
+    // Pages written before the interrupted operation could commit are
+    // restored first, in reverse so that the earliest image of a page wins
+    WalRecord *undo = NULL;
+    offset = committedEnd;
+    while (readRecord(log, size, &offset, &record)) {
+        if (record.type == PAGE_UNDO) {
+            undo = realloc(undo, sizeof(WalRecord) * (numUndone + 1));
+            assert(undo != NULL);
+            undo[numUndone++] = record;
+        }
+    }
+    for (size_t i = numUndone; i > 0; i--) {
+        undoPage(&tables, &undo[i - 1]);
+    }
+    free(undo);
+
+    // Redo records set bytes to their values after each change, so replaying
+    // them over pages already holding some of the changes is harmless
+    offset = 0;
+    while (offset < committedEnd && readRecord(log, size, &offset, &record)) {
+        if (record.type == PAGE_REDO) {
+            redoPage(&tables, &record);
+            numRedone++;
+        }
+    }
+
+    closeRecoveredFiles(tables);
+
+    LOG("Recovered tables to log index %d, redoing %zu and undoing %zu page "
+        "records",
+        appliedIndex, numRedone, numUndone);
+}
+
+int recoverTables(int initialIndex) {
+    pthread_mutex_lock(&walLock);
+
+    if (walFd >= 0) {
+        close(walFd);
+        walFd = -1;
+    }
+    bufferSize = 0;
+    appliedIndex = initialIndex;
+
+    char path[MAX_FILE_NAME_LEN];
+    getWalPath(WAL_FILE_NAME, path);
+
+    size_t size;
+    uint8_t *log = readWalFile(path, &size);
+    if (log != NULL) {
+        replayWal(log, size);
+        free(log);
+    }
+
+    // Recovered tables are forced, so the log restarts from them
+    startNewWal();
+    int index = appliedIndex;
+
+    pthread_mutex_unlock(&walLock);
+    return index;
+}
@@ -0,0 +1,95 @@
+#ifndef WAL_H
+#define WAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "table.h"
+
+// Log index committed by operations executed outside the raft log, which
+// leaves the applied index unchanged
+#define NO_LOG_INDEX (-1)
+
+// Size of the write-ahead log past which tables are checkpointed
+#define WAL_CHECKPOINT_SIZE ((size_t)4 << 20)  // 4 MB
+
+/**
+ * Appends redo record holding the byte ranges in which a page differs from
+ * its image before the current operation. Nothing is logged if they are equal
+ * @param tableName table containing page
+ * @param pageId index of page
+ * @param before image of page before the operation
+ * @param after current contents of page
+ */
+extern void logPageChange(char *tableName, size_t pageId, uint8_t *before,
+                          uint8_t *after);
+
+/**
+ * Appends redo record for a single byte range written to a page
+ * @param tableName table containing page
+ * @param pageId index of page
+ * @param offset offset of range in page
+ * @param bytes new contents of range
+ * @param length number of bytes in range
+ */
+extern void logPageWrite(char *tableName, size_t pageId, size_t offset,
+                         uint8_t *bytes, size_t length);
+
+/**
+ * Appends undo record holding the image of a page before the current
+ * operation, which must be forced before the page is written to its table
+ * while the operation has not committed
+ * @param tableName table containing page
+ * @param pageId index of page
+ * @param image contents of page before the operation
+ */
+extern void logPageImage(char *tableName, size_t pageId, uint8_t *image);
+
+/**
+ * Writes appended records to the log and forces them to disk
+ */
+extern void syncWal(void);
+
+/**
+ * Appends commit record of the current operation and forces the log, after
+ * which the changes of the operation survive a crash
+ * @param logIndex index of operation in raft log, or NO_LOG_INDEX
+ */
+extern void commitWal(int logIndex);
+
+/**
+ * Returns number of bytes in the log since the last checkpoint
+ */
+extern size_t getWalSize(void);
+
+/**
+ * Returns index of last raft log entry committed to the tables
+ */
+extern int getWalAppliedIndex(void);
+
+/**
+ * Starts a new log holding only the applied log index. Every table page and
+ * header must be forced to disk beforehand, as older records are discarded
+ */
+extern void checkpointWal(void);
+
+/**
+ * Starts a new log as checkpointWal does, after the table files have been
+ * replaced by copies holding the raft log entries up to appliedIndex
+ * @param appliedIndex index of last raft log entry held by the new tables
+ */
+extern void resetWal(int appliedIndex);
+
+/**
+ * Brings table files to the state left by the last operation committed to
+ * the log. Pages written by an operation interrupted by a crash are restored
+ * from their undo images before committed changes are redone, and a new log
+ * is started. Pages of memory-mapped tables may be written back by the kernel
+ * at any time, so only their committed changes are protected
+ * @param appliedIndex index of last raft log entry held by the tables, used
+ * if there is no log yet
+ * @return index of last raft log entry held by the recovered tables
+ */
+extern int recoverTables(int appliedIndex);
+
+#endif  // WAL_H
@@ -1,62 +1,136 @@
 #include <assert.h>
 #include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
 #include "b+-tree.h"
+#include "keySearch.h"
+#include "log.h"
 
 #define INIT_ROOT_ID 0
 
-#define ROOT_ID_WIDTH sizeof(uint16_t)
+// Index files without the magic number use the legacy 16-bit format
+#define INDEX_MAGIC 0x58444952  // "RIDX"
+
+#define MAGIC_WIDTH sizeof(uint32_t)
+#define VERSION_WIDTH sizeof(uint16_t)
+#define ROOT_ID_WIDTH sizeof(uint32_t)
 #define D_WIDTH sizeof(uint16_t)
 #define KEY_SIZE_WIDTH sizeof(uint16_t)
 #define CMP_TYPE_WIDTH sizeof(uint8_t)
-#define NUM_PAGES_WIDTH sizeof(uint16_t)
+#define NUM_PAGES_WIDTH sizeof(uint32_t)
+#define FREE_LIST_WIDTH sizeof(uint32_t)
 
-#define NODE_ID_WIDTH sizeof(uint16_t)
-#define NODE_PARENT_WIDTH sizeof(uint16_t)
-#define NODE_PREV_WIDTH sizeof(uint16_t)
-#define NODE_NEXT_WIDTH sizeof(uint16_t)
+#define NODE_ID_WIDTH sizeof(uint32_t)
+#define NODE_PREV_WIDTH sizeof(uint32_t)
+#define NODE_NEXT_WIDTH sizeof(uint32_t)
 #define NODE_NUM_KEYS_WIDTH sizeof(uint16_t)
 #define NODE_TYPE_WIDTH sizeof(uint16_t)
 
-#define RID_PAGE_WIDTH sizeof(uint16_t)
-#define RID_OFFSET_WIDTH sizeof(uint16_t)
+#define RID_PAGE_WIDTH sizeof(uint32_t)
+#define RID_SLOT_WIDTH sizeof(uint16_t)
+#define RID_WIDTH (RID_PAGE_WIDTH + RID_SLOT_WIDTH)
+
+#define max(x, y) ((x > y) ? x : y)
+
+// Leaves hold record ids in the slots where internal nodes hold child ids
+#define CHILD_WIDTH max(NODE_ID_WIDTH, RID_WIDTH)
 
-#define TABLE_HEADER_WIDTH \
-    (ROOT_ID_WIDTH + NUM_PAGES_WIDTH + D_WIDTH + KEY_SIZE_WIDTH + CMP_TYPE_WIDTH)
+#define TABLE_HEADER_WIDTH                                                \
+    (MAGIC_WIDTH + VERSION_WIDTH + ROOT_ID_WIDTH + NUM_PAGES_WIDTH +      \
+     FREE_LIST_WIDTH + D_WIDTH + KEY_SIZE_WIDTH + CMP_TYPE_WIDTH)
 #define NODE_HEADER_WIDTH \
     (NODE_PREV_WIDTH + NODE_NEXT_WIDTH + NODE_NUM_KEYS_WIDTH + NODE_TYPE_WIDTH)
 
 #define KEY_START NODE_HEADER_WIDTH
 #define CHILDREN_START(keySize, d) (KEY_START + keySize * 2 * d)
+#define KEY_PTR(index, node, idx) \
+    ((node)->ptr + KEY_START + (index)->keySize * (idx))
+#define CHILD_PTR(index, node, idx)                                  \
+    ((node)->ptr + CHILDREN_START((index)->keySize, (index)->d) +    \
+     CHILD_WIDTH * (idx))
 
-#define max(x, y) ((x > y) ? x : y)
+#define MAX_INDEX_HEIGHT 32
+
+// Entries sorted in memory before a bulk build spills them to a run file
+#define BUILD_RUN_ENTRIES (1 << 18)
+
+// Memory for the nodes of each index, 256 KB of 4 KB pages
+#define NODE_CACHE_BYTES (64 * _PAGE_SIZE)
+
+// Frames kept however large decoded nodes are, enough to pin every node that
+// a rebalance touches
+#define MIN_NODE_FRAMES 16
 
+// String keys are front coded in node pages, each entry holding the length
+// shared with the previous key followed by the rest of the key
+#define SHARED_LEN_WIDTH sizeof(uint16_t)
+#define SUFFIX_LEN_WIDTH sizeof(uint16_t)
+#define ENTRY_HEADER_WIDTH (SHARED_LEN_WIDTH + SUFFIX_LEN_WIDTH)
+
+// Front-coded nodes below a quarter of a page are rebalanced on deletion
+#define MIN_NODE_BYTES (_PAGE_SIZE / 4)
+
+// Nodes are latched from parent to child and from left to right, so that
+// readers and writers never wait on each other in a cycle. Writers keep the
+// latches of ancestors only while a split or merge could still reach them
 typedef struct Index *Index;
 struct Index {
     FILE *file;
+    pthread_mutex_t cacheLock;  // Guards frames, counters and the file
+    pthread_mutex_t allocLock;  // Guards the page count and free list
+    pthread_rwlock_t rootLatch; // Held while the root may change
     bool modified;
-    uint16_t rootId;
-    uint16_t numPages;
+    bool clean;  // Whether the index file is consistent as of the last sync
+    uint32_t rootId;
+    uint32_t numPages;
+    uint32_t freeListHead;  // First freed node page, or 0 if none
     uint16_t d;
     uint16_t keySize;
+    KeyType keyType;
     int (*cmp)(const void *, const void *);
+    size_t nodeSize;  // Bytes of a node as decoded in memory
+    unsigned numFrames;
+    NodeFrame frames;  // numFrames frames caching nodes
+    uint8_t *frameData;
+    NodeFrame overflowFrames;  // Frames added while every frame is pinned
+    unsigned clockHand;
+    IndexCacheStats stats;
+};
+
+struct NodeFrame {
+    struct Node node;
+    pthread_rwlock_t latch;
+    unsigned pinCount;
+    bool valid;
+    bool dirty;
+    bool referenced;
+    bool freed;     // Node is added to the free list once unlatched
+    bool overflow;  // Frame is freed once unpinned
+    NodeFrame nextOverflow;
+};
+
+// Internal nodes above a leaf latched by a writer
+typedef struct IndexPath IndexPath;
+struct IndexPath {
+    Node nodes[MAX_INDEX_HEIGHT];  // NULL once released
+    unsigned height;
+    bool rootLatched;
 };
 
 typedef struct InsertArgs InsertArgs;
 struct InsertArgs {
     union {
         struct {
-            uint16_t leftId;
-            uint16_t rightId;
+            uint32_t leftId;
+            uint32_t rightId;
         } children;
-        uint16_t offset;
+        RecordId rid;
     };
 };
 
-static void splitNode(Index index, Node node);
-
 static int intcmp(void *x, void *y) {
     if (*(int *)x < *(int *)y) return -1;
     if (*(int *)x > *(int *)y) return 1;
@@ -88,18 +162,40 @@ static int intKeyCmp(void *x, void *y) {
     return cmp;
 }
 
+static bool isCompressed(Index index) {
+    // Only string keys vary in length
+    return index->keyType == STR_KEY;
+}
+
 static void initialiseBIndex(FILE *index, size_t typeWidth,
                              KeyType type) {
     fseek(index, 0, SEEK_SET);
 
-    uint16_t rootID = INIT_ROOT_ID;
-    fwrite(&rootID, sizeof(rootID), 1, index);
-    uint16_t numPages = 0;
-    fwrite(&numPages, sizeof(numPages), 1, index);
-
-    unsigned m = (_PAGE_SIZE - max(NODE_HEADER_WIDTH, TABLE_HEADER_WIDTH) - NODE_ID_WIDTH) /
-                 (typeWidth + NODE_ID_WIDTH);
-    unsigned d = ceil(m / 2.0);
+    uint32_t magic = INDEX_MAGIC;
+    fwrite(&magic, MAGIC_WIDTH, 1, index);
+    uint16_t version = INDEX_FORMAT_VERSION;
+    fwrite(&version, VERSION_WIDTH, 1, index);
+
+    uint32_t rootID = INIT_ROOT_ID;
+    fwrite(&rootID, ROOT_ID_WIDTH, 1, index);
+    uint32_t numPages = 0;
+    fwrite(&numPages, NUM_PAGES_WIDTH, 1, index);
+    uint32_t freeListHead = 0;
+    fwrite(&freeListHead, FREE_LIST_WIDTH, 1, index);
+
+    unsigned m;
+    if (type == STR_KEY) {
+        // Front-coded keys may take no more than their entry header and global
+        // index, so decoded nodes have a slot for every key a page can hold
+        m = (_PAGE_SIZE - NODE_HEADER_WIDTH - CHILD_WIDTH) /
+                (ENTRY_HEADER_WIDTH + GLOBAL_ID_WIDTH + CHILD_WIDTH) +
+            1;
+    } else {
+        m = (_PAGE_SIZE - max(NODE_HEADER_WIDTH, TABLE_HEADER_WIDTH) - CHILD_WIDTH) /
+            (typeWidth + CHILD_WIDTH);
+    }
+    // Rounds down so that 2d keys and children always fit in a page
+    unsigned d = m / 2;
 
     fwrite(&d, D_WIDTH, 1, index);
 
@@ -108,11 +204,15 @@ static void initialiseBIndex(FILE *index, size_t typeWidth,
     fwrite(&type, CMP_TYPE_WIDTH, 1, index);
 }
 
+static void getIndexPath(char *indexName, char *dest) {
+    snprintf(dest, MAX_FILE_NAME_LEN, "%s/%s-index.idx", DB_BASE_DIRECTORY,
+             indexName);
+}
+
 void createBIndex(size_t typeWidth, AttributeName attribute,
                   KeyType type) {
     char indexFile[MAX_FILE_NAME_LEN];
-    snprintf(indexFile, sizeof(indexFile), "%s/%s-index.idx", DB_BASE_DIRECTORY,
-             attribute);
+    getIndexPath(attribute, indexFile);
 
     FILE *index = fopen(indexFile, "wb+");
     assert(index != NULL);
@@ -122,18 +222,44 @@ void createBIndex(size_t typeWidth, AttributeName attribute,
     fclose(index);
 }
 
+static unsigned readIndexVersion(FILE *file) {
+    fseek(file, 0, SEEK_SET);
+
+    uint32_t magic = 0;
+    uint16_t version = 0;
+    fread(&magic, MAGIC_WIDTH, 1, file);
+    fread(&version, VERSION_WIDTH, 1, file);
+
+    return magic == INDEX_MAGIC ? version : 0;
+}
+
+unsigned getIndexVersion(char *indexName) {
+    char indexFile[MAX_FILE_NAME_LEN];
+    getIndexPath(indexName, indexFile);
+
+    FILE *file = fopen(indexFile, "rb");
+    assert(file != NULL);
+
+    unsigned version = readIndexVersion(file);
+    fclose(file);
+
+    return version;
+}
+
 static void readIndexHeader(Index index) {
-    fseek(index->file, 0, SEEK_SET);
+    fseek(index->file, MAGIC_WIDTH + VERSION_WIDTH, SEEK_SET);
 
     fread(&index->rootId, ROOT_ID_WIDTH, 1, index->file);
     fread(&index->numPages, NUM_PAGES_WIDTH, 1, index->file);
+    fread(&index->freeListHead, FREE_LIST_WIDTH, 1, index->file);
     fread(&index->d, D_WIDTH, 1, index->file);
     fread(&index->keySize, KEY_SIZE_WIDTH, 1, index->file);
 
-    KeyType cmpType;
-    fread(&cmpType, KEY_SIZE_WIDTH, 1, index->file);
+    uint8_t cmpType;
+    fread(&cmpType, CMP_TYPE_WIDTH, 1, index->file);
+    index->keyType = cmpType;
 
-    switch (cmpType) {
+    switch (index->keyType) {
         case INT_KEY:
             index->cmp = intKeyCmp;
             break;
@@ -150,32 +276,281 @@ static void readIndexHeader(Index index) {
 
 Index openIndex(AttributeName attribute) {
     char indexFile[MAX_FILE_NAME_LEN];
-    snprintf(indexFile, sizeof(indexFile), "%s/%s-index.idx", DB_BASE_DIRECTORY,
-             attribute);
+    getIndexPath(attribute, indexFile);
 
     FILE *file = fopen(indexFile, "rb+");
     assert(file != NULL);
 
+    // Node ids of older formats are too narrow to be read in place
+    unsigned version = readIndexVersion(file);
+    if (version != INDEX_FORMAT_VERSION) {
+        LOG("Index %s has format version %u rather than %u", attribute,
+            version, INDEX_FORMAT_VERSION);
+        fclose(file);
+        return NULL;
+    }
+
     Index index = malloc(sizeof(struct Index));
     assert(index != NULL);
 
     index->file = file;
+    index->modified = false;
+    index->clean = true;
+    index->overflowFrames = NULL;
+    pthread_mutex_init(&index->cacheLock, NULL);
+    pthread_mutex_init(&index->allocLock, NULL);
+    pthread_rwlock_init(&index->rootLatch, NULL);
 
     readIndexHeader(index);
 
+    // Decoded front-coded nodes hold their keys at full width, so fewer of
+    // them are cached
+    index->nodeSize =
+        isCompressed(index)
+            ? CHILDREN_START(index->keySize, index->d) +
+                  CHILD_WIDTH * (2 * index->d + 1)
+            : _PAGE_SIZE;
+    index->numFrames = NODE_CACHE_BYTES / index->nodeSize;
+    if (index->numFrames < MIN_NODE_FRAMES) {
+        index->numFrames = MIN_NODE_FRAMES;
+    }
+
+    // Allocates node memory for all frames in one block
+    index->frames = calloc(index->numFrames, sizeof(struct NodeFrame));
+    index->frameData = malloc(index->numFrames * index->nodeSize);
+    assert(index->frames != NULL && index->frameData != NULL);
+
+    for (unsigned i = 0; i < index->numFrames; i++) {
+        index->frames[i].node.ptr = index->frameData + i * index->nodeSize;
+        index->frames[i].node.frame = &index->frames[i];
+        pthread_rwlock_init(&index->frames[i].latch, NULL);
+    }
+
+    index->clockHand = 0;
+    memset(&index->stats, 0, sizeof(IndexCacheStats));
+
     return index;
 }
 
-void closeIndex(Index index) {
+bool indexExists(char *indexName) {
+    char indexFile[MAX_FILE_NAME_LEN];
+    getIndexPath(indexName, indexFile);
+
+    return access(indexFile, F_OK) == 0;
+}
+
+void removeBIndex(char *indexName) {
+    char indexFile[MAX_FILE_NAME_LEN];
+    getIndexPath(indexName, indexFile);
+
+    unlink(indexFile);
+}
+
+static unsigned getKeyLength(Index index, uint8_t *key) {
+    return strnlen((char *)key, index->keySize - GLOBAL_ID_WIDTH);
+}
+
+static unsigned getSharedLength(Index index, uint8_t *prev, uint8_t *key) {
+    // The first key of a node is stored whole
+    if (prev == NULL) {
+        return 0;
+    }
+
+    unsigned len = 0;
+    unsigned maxLen = index->keySize - GLOBAL_ID_WIDTH;
+    while (len < maxLen && key[len] != '\0' && prev[len] == key[len]) {
+        len++;
+    }
+
+    return len;
+}
+
+static size_t getEntrySize(Index index, uint8_t *prev, uint8_t *key) {
+    // Each key is stored with its child or record id
+    return ENTRY_HEADER_WIDTH + getKeyLength(index, key) -
+           getSharedLength(index, prev, key) + GLOBAL_ID_WIDTH + CHILD_WIDTH;
+}
+
+static void encodeNode(Index index, Node node, uint8_t *page) {
+    memset(page, 0, _PAGE_SIZE);
+    memcpy(page, node->ptr, NODE_HEADER_WIDTH);
+
+    uint8_t *curr = page + NODE_HEADER_WIDTH;
+    uint8_t *prev = NULL;
+
+    for (unsigned i = 0; i < node->numKeys; i++) {
+        uint8_t *key = KEY_PTR(index, node, i);
+        uint16_t shared = getSharedLength(index, prev, key);
+        uint16_t suffixLen = getKeyLength(index, key) - shared;
+        assert(curr + ENTRY_HEADER_WIDTH + suffixLen + GLOBAL_ID_WIDTH <=
+               page + _PAGE_SIZE);
+
+        memcpy(curr, &shared, SHARED_LEN_WIDTH);
+        memcpy(curr + SHARED_LEN_WIDTH, &suffixLen, SUFFIX_LEN_WIDTH);
+        curr += ENTRY_HEADER_WIDTH;
+        memcpy(curr, key + shared, suffixLen);
+        curr += suffixLen;
+        memcpy(curr, key + index->keySize - GLOBAL_ID_WIDTH, GLOBAL_ID_WIDTH);
+        curr += GLOBAL_ID_WIDTH;
+
+        prev = key;
+    }
+
+    // Child and record ids follow the keys unchanged
+    size_t childrenSize =
+        CHILD_WIDTH * (node->numKeys + (node->type == INTERNAL));
+    assert(curr + childrenSize <= page + _PAGE_SIZE);
+    memcpy(curr, CHILD_PTR(index, node, 0), childrenSize);
+}
+
+static void decodeNode(Index index, Node node, uint8_t *page) {
+    uint8_t *curr = page + NODE_HEADER_WIDTH;
+
+    for (unsigned i = 0; i < node->numKeys; i++) {
+        uint8_t *key = KEY_PTR(index, node, i);
+        uint16_t shared, suffixLen;
+        memcpy(&shared, curr, SHARED_LEN_WIDTH);
+        memcpy(&suffixLen, curr + SHARED_LEN_WIDTH, SUFFIX_LEN_WIDTH);
+        curr += ENTRY_HEADER_WIDTH;
+        assert(shared + suffixLen < index->keySize - GLOBAL_ID_WIDTH);
+
+        // Shared bytes come from the previous key, which is already decoded
+        if (shared > 0) {
+            memcpy(key, KEY_PTR(index, node, i - 1), shared);
+        }
+        memcpy(key + shared, curr, suffixLen);
+        curr += suffixLen;
+        memcpy(key + index->keySize - GLOBAL_ID_WIDTH, curr, GLOBAL_ID_WIDTH);
+        curr += GLOBAL_ID_WIDTH;
+    }
+
+    memcpy(CHILD_PTR(index, node, 0), curr,
+           CHILD_WIDTH * (node->numKeys + (node->type == INTERNAL)));
+}
+
+static void writeNode(Index index, Node node) {
+    fseek(index->file, (long)node->id * _PAGE_SIZE, SEEK_SET);
+
+    if (isCompressed(index)) {
+        uint8_t page[_PAGE_SIZE];
+        encodeNode(index, node, page);
+        fwrite(page, sizeof(uint8_t), _PAGE_SIZE, index->file);
+    } else {
+        fwrite(node->ptr, sizeof(uint8_t), _PAGE_SIZE, index->file);
+    }
+}
+
+static void writeBackFrame(Index index, NodeFrame frame) {
+    writeNode(index, &frame->node);
+    frame->dirty = false;
+    index->stats.writeBacks++;
+}
+
+void flushIndex(Index index) {
+    for (unsigned i = 0; i < index->numFrames; i++) {
+        NodeFrame frame = &index->frames[i];
+
+        pthread_mutex_lock(&index->cacheLock);
+        bool dirty = frame->valid && frame->dirty;
+        if (dirty) {
+            frame->pinCount++;
+        }
+        pthread_mutex_unlock(&index->cacheLock);
+
+        if (!dirty) {
+            continue;
+        }
+
+        // Nodes being modified are written once their writer is done
+        pthread_rwlock_rdlock(&frame->latch);
+        pthread_mutex_lock(&index->cacheLock);
+        if (frame->dirty) {
+            writeBackFrame(index, frame);
+        }
+        frame->pinCount--;
+        pthread_mutex_unlock(&index->cacheLock);
+        pthread_rwlock_unlock(&frame->latch);
+    }
+
+    pthread_rwlock_rdlock(&index->rootLatch);
+    pthread_mutex_lock(&index->allocLock);
+    pthread_mutex_lock(&index->cacheLock);
+
     if (index->modified) {
-        fseek(index->file, 0, SEEK_SET);
+        fseek(index->file, MAGIC_WIDTH + VERSION_WIDTH, SEEK_SET);
         fwrite(&index->rootId, ROOT_ID_WIDTH, 1, index->file);
         fwrite(&index->numPages, NUM_PAGES_WIDTH, 1, index->file);
+        fwrite(&index->freeListHead, FREE_LIST_WIDTH, 1, index->file);
+        index->modified = false;
+    }
+    fflush(index->file);
+
+    pthread_mutex_unlock(&index->cacheLock);
+    pthread_mutex_unlock(&index->allocLock);
+    pthread_rwlock_unlock(&index->rootLatch);
+}
+
+static void writeIndexVersion(Index index, uint16_t version) {
+    fflush(index->file);
+    fsync(fileno(index->file));
+
+    fseek(index->file, MAGIC_WIDTH, SEEK_SET);
+    fwrite(&version, VERSION_WIDTH, 1, index->file);
+    fflush(index->file);
+    fsync(fileno(index->file));
+}
+
+static void markIndexUnclean(Index index) {
+    if (!index->clean) {
+        return;
+    }
+
+    // Nodes may be written back at any time from now on, so an index left
+    // by a crash before the next sync is rebuilt rather than trusted
+    pthread_mutex_lock(&index->cacheLock);
+    writeIndexVersion(index, INDEX_UNCLEAN_VERSION);
+    index->clean = false;
+    pthread_mutex_unlock(&index->cacheLock);
+}
+
+void syncIndex(Index index) {
+    flushIndex(index);
+
+    pthread_rwlock_wrlock(&index->rootLatch);
+    pthread_mutex_lock(&index->cacheLock);
+
+    if (!index->clean) {
+        writeIndexVersion(index, INDEX_FORMAT_VERSION);
+        index->clean = true;
     }
+
+    pthread_mutex_unlock(&index->cacheLock);
+    pthread_rwlock_unlock(&index->rootLatch);
+}
+
+void closeIndex(Index index) {
+    syncIndex(index);
     fclose(index->file);
+
+    for (unsigned i = 0; i < index->numFrames; i++) {
+        pthread_rwlock_destroy(&index->frames[i].latch);
+    }
+    pthread_mutex_destroy(&index->cacheLock);
+    pthread_mutex_destroy(&index->allocLock);
+    pthread_rwlock_destroy(&index->rootLatch);
+
+    free(index->frames);
+    free(index->frameData);
     free(index);
 }
 
+IndexCacheStats getIndexCacheStats(Index index) {
+    pthread_mutex_lock(&index->cacheLock);
+    IndexCacheStats stats = index->stats;
+    pthread_mutex_unlock(&index->cacheLock);
+    return stats;
+}
+
 unsigned getD(Index index) { return index->d; }
 
 unsigned getKeySize(Index index) { return index->keySize; }
@@ -208,30 +583,211 @@ void updateNodeHeader(Node node) {
            &node->next, NODE_NEXT_WIDTH);
 }
 
-uint16_t getNodeId(Node node) { return node->id; }
+uint32_t getNodeId(Node node) { return node->id; }
+
+static NodeFrame findFrame(Index index, uint32_t id) {
+    for (unsigned i = 0; i < index->numFrames; i++) {
+        NodeFrame frame = &index->frames[i];
+
+        if (frame->valid && frame->node.id == id) {
+            return frame;
+        }
+    }
+
+    for (NodeFrame frame = index->overflowFrames; frame != NULL;
+         frame = frame->nextOverflow) {
+        if (frame->node.id == id) {
+            return frame;
+        }
+    }
+
+    return NULL;
+}
+
+static NodeFrame findVictim(Index index) {
+    // Leaves are evicted before internal nodes, so that the root and upper
+    // levels stay resident and a lookup only reads its leaf
+    for (int pass = 0; pass < 2; pass++) {
+        // Clock sweep, where two rounds guarantee every reference bit is
+        // cleared
+        for (unsigned i = 0; i < 2 * index->numFrames; i++) {
+            NodeFrame frame = &index->frames[index->clockHand];
+            index->clockHand = (index->clockHand + 1) % index->numFrames;
+
+            if (!frame->valid) {
+                return frame;
+            }
+
+            if (frame->pinCount > 0 ||
+                (pass == 0 && frame->node.type != LEAF)) {
+                continue;
+            }
+
+            if (frame->referenced) {
+                frame->referenced = false;
+                continue;
+            }
+
+            if (frame->dirty) {
+                writeBackFrame(index, frame);
+            }
+            index->stats.evictions++;
+            frame->valid = false;
+            return frame;
+        }
+    }
+
+    return NULL;
+}
 
-Node getNode(Index index, uint16_t id) {
-    Node node = malloc(sizeof(struct Node));
-    assert(node != NULL);
+static void readNode(Index index, Node node, uint32_t id) {
+    // Nodes past the end of the file are read as empty nodes
+    memset(node->ptr, 0, index->nodeSize);
 
-    fseek(index->file, id * _PAGE_SIZE, SEEK_SET);
+    fseek(index->file, (long)id * _PAGE_SIZE, SEEK_SET);
 
-    uint8_t *ptr = malloc(sizeof(uint8_t) * _PAGE_SIZE);
-    assert(ptr != NULL);
+    if (isCompressed(index)) {
+        uint8_t page[_PAGE_SIZE];
+        memset(page, 0, _PAGE_SIZE);
+        fread(page, _PAGE_SIZE, 1, index->file);
 
-    fread(ptr, _PAGE_SIZE, 1, index->file);
+        memcpy(node->ptr, page, NODE_HEADER_WIDTH);
+        getNodeHeader(node);
+        decodeNode(index, node, page);
+    } else {
+        fread(node->ptr, _PAGE_SIZE, 1, index->file);
+        getNodeHeader(node);
+    }
 
     node->id = id;
-    node->ptr = ptr;
-    getNodeHeader(node);
+    node->keyType = index->keyType;
+}
 
-    return node;
+static NodeFrame addOverflowFrame(Index index) {
+    // Used only when every frame is pinned, so that each node is still held
+    // in one place that can be latched
+    NodeFrame frame = calloc(1, sizeof(struct NodeFrame));
+    assert(frame != NULL);
+
+    frame->node.ptr = malloc(sizeof(uint8_t) * index->nodeSize);
+    assert(frame->node.ptr != NULL);
+
+    pthread_rwlock_init(&frame->latch, NULL);
+    frame->overflow = true;
+    frame->nextOverflow = index->overflowFrames;
+    index->overflowFrames = frame;
+
+    return frame;
+}
+
+static void removeOverflowFrame(Index index, NodeFrame frame) {
+    NodeFrame *curr = &index->overflowFrames;
+    while (*curr != frame) {
+        assert(*curr != NULL);
+        curr = &(*curr)->nextOverflow;
+    }
+    *curr = frame->nextOverflow;
+
+    if (frame->dirty) {
+        writeBackFrame(index, frame);
+    }
+
+    pthread_rwlock_destroy(&frame->latch);
+    free(frame->node.ptr);
+    free(frame);
+}
+
+static NodeFrame pinFrame(Index index, uint32_t id) {
+    pthread_mutex_lock(&index->cacheLock);
+    NodeFrame frame = findFrame(index, id);
+
+    if (frame != NULL) {
+        index->stats.hits++;
+    } else {
+        index->stats.misses++;
+        frame = findVictim(index);
+
+        if (frame == NULL) {
+            frame = addOverflowFrame(index);
+        }
+
+        uint8_t *ptr = frame->node.ptr;
+        memset(&frame->node, 0, sizeof(struct Node));
+        frame->node.ptr = ptr;
+        frame->node.frame = frame;
+
+        readNode(index, &frame->node, id);
+        frame->valid = true;
+        frame->dirty = false;
+        frame->freed = false;
+    }
+
+    frame->pinCount++;
+    frame->referenced = true;
+
+    pthread_mutex_unlock(&index->cacheLock);
+    return frame;
+}
+
+static void unpinFrame(Index index, NodeFrame frame, bool modified) {
+    pthread_mutex_lock(&index->cacheLock);
+
+    // Dirty nodes are written back on eviction or when the index is flushed
+    frame->dirty |= modified;
+
+    assert(frame->pinCount > 0);
+    frame->pinCount--;
+
+    if (frame->overflow && frame->pinCount == 0) {
+        removeOverflowFrame(index, frame);
+    }
+
+    pthread_mutex_unlock(&index->cacheLock);
+}
+
+Node getNode(Index index, uint32_t id) {
+    NodeFrame frame = pinFrame(index, id);
+    pthread_rwlock_wrlock(&frame->latch);
+    return &frame->node;
+}
+
+Node getNodeShared(Index index, uint32_t id) {
+    NodeFrame frame = pinFrame(index, id);
+    pthread_rwlock_rdlock(&frame->latch);
+    return &frame->node;
+}
+
+static Node tryGetNode(Index index, uint32_t id) {
+    NodeFrame frame = pinFrame(index, id);
+
+    if (pthread_rwlock_trywrlock(&frame->latch) != 0) {
+        unpinFrame(index, frame, false);
+        return NULL;
+    }
+
+    return &frame->node;
 }
 
-Node addNode(Index index, NodeType type, uint16_t parent, uint16_t prev,
-             uint16_t next) {
-    Node node = getNode(index, ++index->numPages);
+Node addNode(Index index, NodeType type, uint32_t parent, uint32_t prev,
+             uint32_t next) {
+    Node node;
+    pthread_mutex_lock(&index->allocLock);
+
+    // Reuses pages of freed nodes before growing the file. Nodes join the
+    // free list as they are unlatched, so taking the head waits on no one
+    // that needs the free list
+    if (index->freeListHead != 0) {
+        node = getNode(index, index->freeListHead);
+        index->freeListHead = node->next;
+        memset(node->ptr, 0, index->nodeSize);
+        node->nodeModified = true;
+    } else {
+        node = getNode(index, ++index->numPages);
+    }
+
     index->modified = true;
+    pthread_mutex_unlock(&index->allocLock);
+
     node->parent = parent;
     node->type = type;
     node->prev = prev;
@@ -243,98 +799,145 @@ Node addNode(Index index, NodeType type, uint16_t parent, uint16_t prev,
     return node;
 }
 
+static void pushFreeNode(Index index, Node node) {
+    pthread_mutex_lock(&index->allocLock);
+
+    // Freed pages are chained through their next pointers until reused
+    node->next = index->freeListHead;
+    updateNodeHeader(node);
+    index->freeListHead = node->id;
+    index->modified = true;
+
+    pthread_mutex_unlock(&index->allocLock);
+}
+
 void closeNode(Index index, Node node) {
-    fseek(index->file, node->id * _PAGE_SIZE, SEEK_SET);
+    NodeFrame frame = node->frame;
 
-    if (node->headerModified) {
-        updateNodeHeader(node);
-        fwrite(node->ptr, sizeof(uint8_t), NODE_HEADER_WIDTH, index->file);
+    if (frame->freed) {
+        pushFreeNode(index, node);
+        frame->freed = false;
     }
-    if (node->nodeModified) {
-        fwrite(node->ptr + NODE_HEADER_WIDTH, sizeof(uint8_t),
-               _PAGE_SIZE - NODE_HEADER_WIDTH, index->file);
+
+    // Only writers holding the node exclusively mark it modified
+    bool modified = node->headerModified || node->nodeModified;
+    if (modified) {
+        if (node->headerModified) {
+            updateNodeHeader(node);
+        }
+        node->headerModified = false;
+        node->nodeModified = false;
     }
 
-    free(node->ptr);
-    free(node);
+    pthread_rwlock_unlock(&frame->latch);
+    unpinFrame(index, frame, modified);
 }
 
-void getInternalKey(Index index, Node node, unsigned idx, KeyId *key) {
-    assert(idx < node->numKeys);
+static void readRawKey(Index index, uint8_t *src, KeyId *key) {
+    unsigned size = index->keySize;
+    if (index->keyType == ID_KEY) {
+        memcpy(&key->priKey, src, size);
+    } else {
+        key->secKey.key = src;
+        memcpy(&key->secKey.id, src + size - GLOBAL_ID_WIDTH, GLOBAL_ID_WIDTH);
+    }
+}
 
+static void writeRawKey(Index index, KeyId *src, uint8_t *dest) {
     unsigned size = index->keySize;
-    if (node->keyType == ID_KEY) {
-        memcpy(&key->priKey, node->ptr + KEY_START + size * idx, size);
+    if (index->keyType == ID_KEY) {
+        memcpy(dest, src, size);
     } else {
-        key->secKey.key = node->ptr + KEY_START + size * idx;
-        memcpy(&key->secKey.id, node->ptr + KEY_START + size * idx + size - GLOBAL_ID_WIDTH, GLOBAL_ID_WIDTH);
+        memcpy(dest, src->secKey.key, size - GLOBAL_ID_WIDTH);
+        memcpy(dest + size - GLOBAL_ID_WIDTH, &src->secKey.id, GLOBAL_ID_WIDTH);
     }
+}
+
+void getInternalKey(Index index, Node node, unsigned idx, KeyId *key) {
+    assert(idx < node->numKeys);
 
+    readRawKey(index, KEY_PTR(index, node, idx), key);
 }
 
 void setInternalKey(Index index, Node node, unsigned idx, KeyId *src) {
     assert(idx < node->numKeys);
 
-    unsigned size = index->keySize;
-    if (node->keyType == ID_KEY) {
-        memcpy(node->ptr + KEY_START + size * idx, src, size);
-    } else {
-        memcpy(node->ptr + KEY_START + size * idx, src->secKey.key, size - GLOBAL_ID_WIDTH);
-        memcpy(node->ptr + KEY_START + size * idx + size - GLOBAL_ID_WIDTH, &src->secKey.id, GLOBAL_ID_WIDTH);
-    }
-
+    writeRawKey(index, src, KEY_PTR(index, node, idx));
     node->nodeModified = true;
 }
 
-void setKeyChild(Index index, Node node, unsigned idx, unsigned id) {
-    if (node->type == LEAF) {
-        assert(idx < node->numKeys);
-    } else {
-        assert(idx <= node->numKeys);
-    }
+void setKeyChild(Index index, Node node, unsigned idx, uint32_t id) {
+    assert(node->type != LEAF && idx <= node->numKeys);
 
-    memcpy(node->ptr + CHILDREN_START(index->keySize, index->d) +
-               NODE_ID_WIDTH * idx,
-           &id, NODE_ID_WIDTH);
+    memcpy(CHILD_PTR(index, node, idx), &id, NODE_ID_WIDTH);
     node->nodeModified = true;
 }
 
-unsigned getKeyChild(Index index, Node node, unsigned idx) {
-    unsigned res;
-    if (node->type == LEAF) {
-        assert(idx < node->numKeys);
-    } else {
-        assert(idx <= node->numKeys);
-    }
+uint32_t getKeyChild(Index index, Node node, unsigned idx) {
+    assert(node->type != LEAF && idx <= node->numKeys);
 
-    memcpy(&res,
-           node->ptr + CHILDREN_START(index->keySize, index->d) +
-               NODE_ID_WIDTH * idx,
-           NODE_ID_WIDTH);
+    uint32_t res;
+    memcpy(&res, CHILD_PTR(index, node, idx), NODE_ID_WIDTH);
     return res;
 }
 
+static void setKeyRecord(Index index, Node node, unsigned idx, RecordId rid) {
+    assert(node->type == LEAF && idx < node->numKeys);
+
+    uint8_t *ptr = CHILD_PTR(index, node, idx);
+    memcpy(ptr, &rid.pageId, RID_PAGE_WIDTH);
+    memcpy(ptr + RID_PAGE_WIDTH, &rid.slotIdx, RID_SLOT_WIDTH);
+    node->nodeModified = true;
+}
+
+RecordId getKeyRecord(Index index, Node node, unsigned idx) {
+    assert(node->type == LEAF && idx < node->numKeys);
+
+    RecordId rid;
+    uint8_t *ptr = CHILD_PTR(index, node, idx);
+    memcpy(&rid.pageId, ptr, RID_PAGE_WIDTH);
+    memcpy(&rid.slotIdx, ptr + RID_PAGE_WIDTH, RID_SLOT_WIDTH);
+    return rid;
+}
+
+static void moveChild(Index index, Node src, unsigned srcIdx, Node dest,
+                      unsigned destIdx) {
+    // Copies child id or record id without interpreting it
+    memmove(CHILD_PTR(index, dest, destIdx), CHILD_PTR(index, src, srcIdx),
+            CHILD_WIDTH);
+    dest->nodeModified = true;
+}
+
 unsigned searchKey(Index index, Node node, KeyId *key) {
-    if (node->numKeys == 0) {
-        return 0;
+    // Integer keys are searched in place without the comparator
+    if (getKeySearchMode() != KEY_SEARCH_GENERIC) {
+        if (index->keyType == INT_KEY && index->keySize == 2 * sizeof(int32_t)) {
+            int32_t value;
+            memcpy(&value, key->secKey.key, sizeof(int32_t));
+            return searchIntKeys(KEY_PTR(index, node, 0), node->numKeys, value,
+                                 key->secKey.id);
+        }
+
+        if (index->keyType == ID_KEY && index->keySize == sizeof(int32_t)) {
+            return searchIdKeys(KEY_PTR(index, node, 0), node->numKeys,
+                                key->priKey);
+        }
     }
 
+    // Finds position of first key that is not less than the search key
     unsigned left = 0;
-    unsigned right = node->numKeys - 1;
+    unsigned right = node->numKeys;
 
-    while (left <= right) {
+    while (left < right) {
         unsigned mid = (left + right) / 2;
 
         KeyId keyId;
         getInternalKey(index, node, mid, &keyId);
 
-        switch (index->cmp(key, &keyId)) {
-            case 0:
-                return mid;
-            case 1:
-                left = mid + 1; break;
-            default:
-                right = mid - 1; break;
+        if (index->cmp(key, &keyId) > 0) {
+            left = mid + 1;
+        } else {
+            right = mid;
         }
     }
 
@@ -344,16 +947,28 @@ unsigned searchKey(Index index, Node node, KeyId *key) {
 Node moveToNode(Index index, Node node, KeyId *keyId) {
     assert(node->type != LEAF);
 
-    unsigned leqKey = searchKey(index, node, keyId);
-    unsigned nextId = getKeyChild(index, node, leqKey < node->numKeys ? leqKey + 1 : leqKey);
+    // Keys no greater than the separator at idx are held by child idx, which
+    // is latched before the node is released
+    uint32_t nextId = getKeyChild(index, node, searchKey(index, node, keyId));
+    Node next = getNodeShared(index, nextId);
     closeNode(index, node);
-    return getNode(index, nextId);
+    return next;
+}
+
+static Node getRootShared(Index index) {
+    // Root latch keeps the root in place until its node is latched
+    pthread_rwlock_rdlock(&index->rootLatch);
+    Node root =
+        index->rootId == 0 ? NULL : getNodeShared(index, index->rootId);
+    pthread_rwlock_unlock(&index->rootLatch);
+
+    return root;
 }
 
 Node traverseTo(Index index, KeyId *keyId) {
-    Node curr = getNode(index, index->rootId);
+    Node curr = getRootShared(index);
 
-    while (curr->type != LEAF) {
+    while (curr != NULL && curr->type != LEAF) {
         curr = moveToNode(index, curr, keyId);
     }
 
@@ -369,14 +984,13 @@ void orderedKeyInsertInternal(Index index, Node node, KeyId *key,
     node->headerModified = true;
     node->nodeModified = true;
 
-    setKeyChild(index, node, node->numKeys,
-                getKeyChild(index, node, node->numKeys - 1));
+    moveChild(index, node, node->numKeys - 1, node, node->numKeys);
 
     for (int i = node->numKeys - 1; i > destIdx; i--) {
         KeyId keyId;
         getInternalKey(index, node, i - 1, &keyId);
         setInternalKey(index, node, i, &keyId);
-        setKeyChild(index, node, i, getKeyChild(index, node, i - 1));
+        moveChild(index, node, i - 1, node, i);
     }
 
     setInternalKey(index, node, destIdx, key);
@@ -384,7 +998,7 @@ void orderedKeyInsertInternal(Index index, Node node, KeyId *key,
     setKeyChild(index, node, destIdx + 1, rightId);
 }
 
-void orderedKeyInsertLeaf(Index index, Node node, KeyId *key, unsigned offset) {
+void orderedKeyInsertLeaf(Index index, Node node, KeyId *key, RecordId rid) {
     unsigned destIdx = searchKey(index, node, key);
 
     node->numKeys++;
@@ -395,88 +1009,1167 @@ void orderedKeyInsertLeaf(Index index, Node node, KeyId *key, unsigned offset) {
         KeyId keyId;
         getInternalKey(index, node, i - 1, &keyId);
         setInternalKey(index, node, i, &keyId);
-        setKeyChild(index, node, i, getKeyChild(index, node, i - 1));
+        moveChild(index, node, i - 1, node, i);
     }
 
     setInternalKey(index, node, destIdx, key);
-    setKeyChild(index, node, destIdx, offset);
+    setKeyRecord(index, node, destIdx, rid);
 }
 
-void insertKey(Index index, Node node, KeyId *key, InsertArgs args) {
-    if (node->numKeys >= index->d * 2 - 1) {
-        splitNode(index, node);
-    }
+static void insertIntoNode(Index index, Node node, KeyId *key,
+                           InsertArgs args) {
     if (node->type == INTERNAL) {
         orderedKeyInsertInternal(index, node, key, args.children.leftId,
                                  args.children.rightId);
     } else {
-        orderedKeyInsertLeaf(index, node, key, args.offset);
+        orderedKeyInsertLeaf(index, node, key, args.rid);
+    }
+}
+
+static void copyKey(Index index, KeyId *key, uint8_t *dest) {
+    // Primary keys are held by value
+    if (index->keyType == ID_KEY) {
+        return;
+    }
+
+    memcpy(dest, key->secKey.key, index->keySize - GLOBAL_ID_WIDTH);
+    key->secKey.key = dest;
+}
+
+static size_t getEncodedSize(Index index, Node node, unsigned start,
+                             unsigned end, KeyId *extra) {
+    // Internal nodes hold one more child than keys
+    size_t size = NODE_HEADER_WIDTH + CHILD_WIDTH * (node->type == INTERNAL);
+    uint8_t *prev = NULL;
+    bool placed = extra == NULL;
+
+    for (unsigned i = start; i <= end; i++) {
+        uint8_t *key = i < end ? KEY_PTR(index, node, i) : NULL;
+
+        // Extra key is counted before the first key greater than it
+        if (!placed) {
+            KeyId keyId;
+            if (key != NULL) {
+                readRawKey(index, key, &keyId);
+            }
+
+            if (key == NULL || index->cmp(extra, &keyId) < 0) {
+                size += getEntrySize(index, prev, extra->secKey.key);
+                prev = extra->secKey.key;
+                placed = true;
+            }
+        }
+
+        if (key != NULL) {
+            size += getEntrySize(index, prev, key);
+            prev = key;
+        }
     }
+
+    return size;
+}
+
+static bool hasRoom(Index index, Node node, KeyId *key) {
+    if (node->numKeys == index->d * 2 - 1) {
+        return false;
+    }
+
+    // Front-coded nodes are full once their keys no longer fit in a page
+    return !isCompressed(index) ||
+           getEncodedSize(index, node, 0, node->numKeys, key) <= _PAGE_SIZE;
+}
+
+static void shortenSeparator(Index index, uint8_t *left, uint8_t *right,
+                             uint8_t *dest) {
+    memcpy(dest, left, index->keySize);
+
+    if (index->keyType != STR_KEY) {
+        return;
+    }
+
+    // Shortest prefix of the right key that sorts after the left key
+    // separates them as well as the left key does
+    unsigned len = getSharedLength(index, left, right) + 1;
+    unsigned rightLen = getKeyLength(index, right);
+    if (len > rightLen) {
+        return;
+    }
+
+    // A prefix that is the whole right key only sorts before it with a
+    // smaller global index
+    int32_t rightId;
+    memcpy(&rightId, right + index->keySize - GLOBAL_ID_WIDTH, GLOBAL_ID_WIDTH);
+    if (len == rightLen && rightId <= 0) {
+        return;
+    }
+
+    uint32_t id = 0;
+    memset(dest, 0, index->keySize);
+    memcpy(dest, right, len);
+    memcpy(dest + index->keySize - GLOBAL_ID_WIDTH, &id, GLOBAL_ID_WIDTH);
+}
+
+static size_t getSplitSize(Index index, Node node, KeyId *key, unsigned pos,
+                           unsigned split, bool left) {
+    // Key goes to the left node if it is no greater than the separator
+    KeyId *leftKey = pos < split ? key : NULL;
+    KeyId *rightKey = pos < split ? NULL : key;
+
+    if (left) {
+        // Separators of internal nodes move up rather than staying in either
+        // node
+        unsigned end = node->type == LEAF ? split : split - 1;
+        return getEncodedSize(index, node, 0, end, leftKey);
+    }
+
+    return getEncodedSize(index, node, split, node->numKeys, rightKey);
+}
+
+static unsigned chooseSplit(Index index, Node node, KeyId *key) {
+    // Full fixed-width nodes split evenly
+    if (!isCompressed(index)) {
+        assert(node->numKeys == index->d * 2 - 1);
+        return index->d;
+    }
+
+    // Front-coded nodes split where both nodes take about as many bytes once
+    // the key is inserted. The left node only grows as the split moves right
+    // and the right node only shrinks, so the split is found by bisection
+    unsigned pos = searchKey(index, node, key);
+    unsigned first = node->type == LEAF ? 1 : 2;
+    unsigned lo = first;
+    unsigned hi = node->numKeys - 1;
+    assert(lo <= hi);
+
+    while (lo < hi) {
+        unsigned mid = (lo + hi) / 2;
+
+        if (getSplitSize(index, node, key, pos, mid, true) <
+            getSplitSize(index, node, key, pos, mid, false)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    // Split before the first one where the left node is larger may be more
+    // even
+    if (lo > first) {
+        size_t before = getSplitSize(index, node, key, pos, lo - 1, false);
+        size_t after = getSplitSize(index, node, key, pos, lo, true);
+        if (before < after) {
+            lo--;
+        }
+    }
+
+    return lo;
 }
 
-static void splitNode(Index index, Node node) {
-    assert(node->numKeys == index->d * 2 - 1);
+static Node splitNode(Index index, Node node, KeyId *key, KeyId *separator,
+                      uint8_t *separatorBuf) {
+    unsigned split = chooseSplit(index, node, key);
     Node nextNode =
         addNode(index, node->type, node->parent, node->id, node->next);
+
+    // Keeps the leaf chain linked in both directions
+    if (node->next != 0) {
+        Node oldNext = getNode(index, node->next);
+        oldNext->prev = nextNode->id;
+        oldNext->headerModified = true;
+        closeNode(index, oldNext);
+    }
     node->next = nextNode->id;
+    node->headerModified = true;
 
-    unsigned d = index->d;
-    for (unsigned i = d; i < d * 2 - 1; i++) {
+    for (unsigned i = split; i < node->numKeys; i++) {
         KeyId keyId;
         getInternalKey(index, node, i, &keyId);
         nextNode->numKeys++;
-        setInternalKey(index, nextNode, i - d, &keyId);
-        setKeyChild(index, nextNode, i - d,
-                    getKeyChild(index, node, i));
+        setInternalKey(index, nextNode, i - split, &keyId);
+        moveChild(index, node, i, nextNode, i - split);
     }
 
     if (node->type == INTERNAL) {
-        setKeyChild(index, nextNode, d, getKeyChild(index, node, d * 2 - 1));
+        moveChild(index, node, node->numKeys, nextNode, node->numKeys - split);
     }
 
-    node->numKeys = d;
-    uint16_t parent = node->parent;
+    node->numKeys = split;
 
-    KeyId keyId;
-    getInternalKey(index, node, node->numKeys - 1, &keyId);
+    // Largest key of the left node separates it from the right node, and is
+    // copied out as the node page changes on the next insertion
+    getInternalKey(index, node, split - 1, separator);
+    copyKey(index, separator, separatorBuf);
 
+    // Separators of internal nodes move up rather than being duplicated
     if (node->type != LEAF) {
         node->numKeys--;
     }
 
-    Node parentNode;
-    if (parent != 0) {
-        parentNode = getNode(index, parent);
-    } else {
-        parentNode = addNode(index, INTERNAL, 0, 0, 0);
-        nextNode->parent = parentNode->id;
-        node->parent = parentNode->id;
-        index->rootId = parentNode->id;
+    return nextNode;
+}
 
-        node->headerModified = true;
-        nextNode->headerModified = true;
-        index->modified = true;
+static size_t getMaxEntrySize(Index index) {
+    // Longest string of a key leaves room for its terminator
+    return ENTRY_HEADER_WIDTH + index->keySize - 1 + CHILD_WIDTH;
+}
+
+static bool isSafeForInsert(Index index, Node node) {
+    if (node->numKeys == index->d * 2 - 1) {
+        return false;
     }
 
-    InsertArgs args = {
-        .children = {.leftId = node->id, .rightId = nextNode->id}};
-    insertKey(index, parentNode, &keyId, args);
-    closeNode(index, nextNode);
+    // New entry may also stop the key after it sharing a prefix, which
+    // costs at most another entry
+    return !isCompressed(index) ||
+           getEncodedSize(index, node, 0, node->numKeys, NULL) +
+                   2 * getMaxEntrySize(index) <=
+               _PAGE_SIZE;
+}
+
+static bool isSafeForDelete(Index index, Node node) {
+    // Root only changes once it is left with no keys
+    if (node->id == index->rootId) {
+        return node->numKeys > 1;
+    }
 
-    closeNode(index, parentNode);
+    // Removing a key shrinks a front-coded node by at most one entry
+    if (isCompressed(index)) {
+        return getEncodedSize(index, node, 0, node->numKeys, NULL) >=
+               MIN_NODE_BYTES + getMaxEntrySize(index);
+    }
+
+    return node->numKeys > index->d - 1;
+}
+
+static void releaseAncestors(Index index, IndexPath *path) {
+    for (unsigned i = 0; i < path->height; i++) {
+        if (path->nodes[i] != NULL) {
+            closeNode(index, path->nodes[i]);
+            path->nodes[i] = NULL;
+        }
+    }
+
+    if (path->rootLatched) {
+        pthread_rwlock_unlock(&index->rootLatch);
+        path->rootLatched = false;
+    }
 }
 
-void addKeyToIndex(Index index, KeyId *key, unsigned offset) {
-    Node leaf;
+static Node traverseForWrite(Index index, KeyId *keyId, IndexPath *path,
+                             bool (*isSafe)(Index, Node)) {
+    pthread_rwlock_wrlock(&index->rootLatch);
+    path->rootLatched = true;
+    path->height = 0;
+    markIndexUnclean(index);
+
+    // Root latch is kept for the insertion of the first key
     if (index->rootId == 0) {
+        return NULL;
+    }
+
+    Node curr = getNode(index, index->rootId);
+    if (isSafe(index, curr)) {
+        releaseAncestors(index, path);
+    }
+
+    // Records latched internal nodes on the way down, as parents are not
+    // stored, and releases them once a node below can absorb the change
+    while (curr->type != LEAF) {
+        assert(path->height < MAX_INDEX_HEIGHT);
+        path->nodes[path->height++] = curr;
+
+        uint32_t nextId =
+            getKeyChild(index, curr, searchKey(index, curr, keyId));
+        curr = getNode(index, nextId);
+
+        if (isSafe(index, curr)) {
+            releaseAncestors(index, path);
+        }
+    }
+
+    return curr;
+}
+
+static void insertKey(Index index, IndexPath *path, unsigned height, Node node,
+                      KeyId *key, InsertArgs args) {
+    if (hasRoom(index, node, key)) {
+        insertIntoNode(index, node, key, args);
+        return;
+    }
+
+    KeyId separator;
+    uint8_t separatorBuf[index->keySize];
+    Node nextNode = splitNode(index, node, key, &separator, separatorBuf);
+
+    insertIntoNode(index, index->cmp(key, &separator) <= 0 ? node : nextNode,
+                   key, args);
+
+    // Separators of string leaves are truncated once both leaves are final,
+    // so that internal nodes hold as many of them as possible
+    if (node->type == LEAF && isCompressed(index)) {
+        shortenSeparator(index, KEY_PTR(index, node, node->numKeys - 1),
+                         KEY_PTR(index, nextNode, 0), separatorBuf);
+        readRawKey(index, separatorBuf, &separator);
+    }
+
+    InsertArgs parentArgs = {
+        .children = {.leftId = node->id, .rightId = nextNode->id}};
+
+    // Parents of nodes that could split are still latched
+    if (height == 0) {
+        // Splitting the root adds a new level to the tree
+        assert(path->rootLatched);
+        Node root = addNode(index, INTERNAL, 0, 0, 0);
+        index->rootId = root->id;
+        insertIntoNode(index, root, &separator, parentArgs);
+        closeNode(index, root);
+    } else {
+        Node parent = path->nodes[height - 1];
+        assert(parent != NULL);
+        insertKey(index, path, height - 1, parent, &separator, parentArgs);
+    }
+
+    closeNode(index, nextNode);
+}
+
+void addKeyToIndex(Index index, KeyId *key, RecordId rid) {
+    InsertArgs args = {.rid = rid};
+    IndexPath path;
+    Node leaf = traverseForWrite(index, key, &path, isSafeForInsert);
+
+    if (leaf == NULL) {
         Node root = addNode(index, LEAF, 0, 0, 0);
         index->rootId = root->id;
-        leaf = root;
+        insertIntoNode(index, root, key, args);
+        closeNode(index, root);
+    } else {
+        insertKey(index, &path, path.height, leaf, key, args);
+        closeNode(index, leaf);
+    }
+
+    releaseAncestors(index, &path);
+}
+
+static void moveKey(Index index, Node src, unsigned srcIdx, Node dest,
+                    unsigned destIdx) {
+    memmove(KEY_PTR(index, dest, destIdx), KEY_PTR(index, src, srcIdx),
+            index->keySize);
+    dest->nodeModified = true;
+}
+
+static void freeNode(Index index, Node node) {
+    // Page is added to the free list once the node is unlatched, as no other
+    // thread can reach it by then
+    node->numKeys = 0;
+    node->prev = 0;
+    node->headerModified = true;
+    node->frame->freed = true;
+}
+
+static void removeFromNode(Index index, Node node, unsigned keyIdx,
+                           unsigned childIdx) {
+    for (unsigned i = keyIdx; i + 1 < node->numKeys; i++) {
+        moveKey(index, node, i + 1, node, i);
+    }
+
+    // Leaves hold one record per key, and internal nodes one more child
+    unsigned numChildren = node->numKeys + (node->type == INTERNAL);
+    for (unsigned i = childIdx; i + 1 < numChildren; i++) {
+        moveChild(index, node, i + 1, node, i);
+    }
+
+    node->numKeys--;
+    node->headerModified = true;
+}
+
+static void setLeafSeparator(Index index, Node parent, unsigned idx, Node left,
+                             Node right) {
+    shortenSeparator(index, KEY_PTR(index, left, left->numKeys - 1),
+                     KEY_PTR(index, right, 0), KEY_PTR(index, parent, idx));
+    parent->nodeModified = true;
+}
+
+static void borrowFromLeft(Index index, Node parent, unsigned idx, Node left,
+                           Node node) {
+    unsigned numChildren = node->numKeys + (node->type == INTERNAL);
+
+    for (unsigned i = node->numKeys; i > 0; i--) {
+        moveKey(index, node, i - 1, node, i);
+    }
+    for (unsigned i = numChildren; i > 0; i--) {
+        moveChild(index, node, i - 1, node, i);
+    }
+
+    node->numKeys++;
+    node->headerModified = true;
+
+    if (node->type == LEAF) {
+        moveKey(index, left, left->numKeys - 1, node, 0);
+        moveChild(index, left, left->numKeys - 1, node, 0);
+        left->numKeys--;
+
+        // Separator stays between the left sibling and the node
+        setLeafSeparator(index, parent, idx - 1, left, node);
+    } else {
+        // Separator rotates down, and the largest key of the left sibling
+        // rotates up in its place
+        moveKey(index, parent, idx - 1, node, 0);
+        moveChild(index, left, left->numKeys, node, 0);
+        moveKey(index, left, left->numKeys - 1, parent, idx - 1);
+        left->numKeys--;
+    }
+
+    left->headerModified = true;
+}
+
+static void borrowFromRight(Index index, Node parent, unsigned idx, Node node,
+                            Node right) {
+    if (node->type == LEAF) {
+        moveKey(index, right, 0, node, node->numKeys);
+        moveChild(index, right, 0, node, node->numKeys);
+        node->numKeys++;
+    } else {
+        moveKey(index, parent, idx, node, node->numKeys);
+        moveChild(index, right, 0, node, node->numKeys + 1);
+        moveKey(index, right, 0, parent, idx);
+        node->numKeys++;
+    }
+
+    node->headerModified = true;
+    removeFromNode(index, right, 0, 0);
+
+    if (node->type == LEAF) {
+        setLeafSeparator(index, parent, idx, node, right);
+    }
+}
+
+static bool canTakeKeys(Index index, Node node, uint8_t *incoming,
+                        Node parent, uint8_t *separator) {
+    KeyId key, sep;
+    readRawKey(index, incoming, &key);
+    readRawKey(index, separator, &sep);
+
+    // Replaced separator is counted as an extra key of the parent, which
+    // overestimates its size
+    return hasRoom(index, node, &key) && hasRoom(index, parent, &sep);
+}
+
+static bool canBorrowFromLeft(Index index, Node parent, unsigned idx,
+                              Node left, Node node) {
+    if (!isCompressed(index)) {
+        return left->numKeys > index->d - 1;
+    }
+
+    // Left sibling must stay a quarter full
+    if (left->numKeys < 2 || getEncodedSize(index, left, 0, left->numKeys - 1,
+                                            NULL) < MIN_NODE_BYTES) {
+        return false;
+    }
+
+    uint8_t separator[index->keySize];
+    uint8_t *incoming;
+    if (node->type == LEAF) {
+        incoming = KEY_PTR(index, left, left->numKeys - 1);
+        shortenSeparator(index, KEY_PTR(index, left, left->numKeys - 2),
+                         incoming, separator);
+    } else {
+        incoming = KEY_PTR(index, parent, idx - 1);
+        memcpy(separator, KEY_PTR(index, left, left->numKeys - 1),
+               index->keySize);
+    }
+
+    return canTakeKeys(index, node, incoming, parent, separator);
+}
+
+static bool canBorrowFromRight(Index index, Node parent, unsigned idx,
+                               Node node, Node right) {
+    if (!isCompressed(index)) {
+        return right->numKeys > index->d - 1;
+    }
+
+    if (right->numKeys < 2 ||
+        getEncodedSize(index, right, 1, right->numKeys, NULL) <
+            MIN_NODE_BYTES) {
+        return false;
+    }
+
+    uint8_t separator[index->keySize];
+    uint8_t *incoming;
+    if (node->type == LEAF) {
+        incoming = KEY_PTR(index, right, 0);
+        shortenSeparator(index, incoming, KEY_PTR(index, right, 1), separator);
+    } else {
+        incoming = KEY_PTR(index, parent, idx);
+        memcpy(separator, KEY_PTR(index, right, 0), index->keySize);
+    }
+
+    return canTakeKeys(index, node, incoming, parent, separator);
+}
+
+static bool canMerge(Index index, Node parent, unsigned idx, Node left,
+                     Node right) {
+    if (!isCompressed(index)) {
+        return true;
+    }
+
+    // Keys of the right node share at least as much once they follow the
+    // left node, so the sum of both sizes bounds the merged size
+    size_t size = getEncodedSize(index, left, 0, left->numKeys, NULL) +
+                  getEncodedSize(index, right, 0, right->numKeys, NULL) -
+                  NODE_HEADER_WIDTH;
+
+    // Separator moving down between internal nodes takes no child of its own
+    if (left->type == INTERNAL) {
+        size += getEntrySize(index, NULL, KEY_PTR(index, parent, idx)) -
+                CHILD_WIDTH;
+    }
+
+    return size <= _PAGE_SIZE;
+}
+
+static bool isUnderfull(Index index, Node node) {
+    // Front-coded nodes are measured by the bytes they take in a page
+    if (isCompressed(index)) {
+        return getEncodedSize(index, node, 0, node->numKeys, NULL) <
+               MIN_NODE_BYTES;
+    }
+
+    // Nodes hold at least d - 1 keys, as left by a split
+    return node->numKeys < index->d - 1;
+}
+
+static void mergeNodes(Index index, Node parent, unsigned idx, Node left,
+                       Node right, Node next) {
+    // Separator moves down between the keys of merged internal nodes
+    if (left->type == INTERNAL) {
+        moveKey(index, parent, idx, left, left->numKeys);
+        left->numKeys++;
+    }
+
+    unsigned numChildren = right->numKeys + (right->type == INTERNAL);
+    for (unsigned i = 0; i < right->numKeys; i++) {
+        moveKey(index, right, i, left, left->numKeys + i);
+    }
+    for (unsigned i = 0; i < numChildren; i++) {
+        moveChild(index, right, i, left, left->numKeys + i);
+    }
+
+    left->numKeys += right->numKeys;
+    left->headerModified = true;
+
+    // Next node may already be latched by the caller as a sibling
+    left->next = right->next;
+    if (next != NULL) {
+        next->prev = left->id;
+        next->headerModified = true;
+    } else if (right->next != 0) {
+        next = getNode(index, right->next);
+        next->prev = left->id;
+        next->headerModified = true;
+        closeNode(index, next);
+    }
+
+    removeFromNode(index, parent, idx, idx + 1);
+    freeNode(index, right);
+}
+
+static unsigned findChild(Index index, Node parent, uint32_t id) {
+    for (unsigned i = 0; i <= parent->numKeys; i++) {
+        if (getKeyChild(index, parent, i) == id) {
+            return i;
+        }
+    }
+
+    assert(false);
+    return 0;
+}
+
+static void rebalanceNode(Index index, IndexPath *path, unsigned height,
+                          Node node) {
+    // Root shrinks the tree once it has a single child or no keys left, and
+    // the root latch is still held whenever it can
+    if (height == 0) {
+        if (node->type == INTERNAL && node->numKeys == 0) {
+            index->rootId = getKeyChild(index, node, 0);
+            freeNode(index, node);
+        } else if (node->type == LEAF && node->numKeys == 0) {
+            index->rootId = 0;
+            freeNode(index, node);
+        }
+        return;
+    }
+
+    if (!isUnderfull(index, node)) {
+        return;
+    }
+
+    Node parent = path->nodes[height - 1];
+    assert(parent != NULL);
+    unsigned idx = findChild(index, parent, node->id);
+
+    // Readers latch leaves from left to right, so the left sibling is only
+    // taken if no one holds it, leaving the node to the right sibling
+    // otherwise
+    Node left = idx > 0
+                    ? tryGetNode(index, getKeyChild(index, parent, idx - 1))
+                    : NULL;
+    Node right = idx < parent->numKeys
+                     ? getNode(index, getKeyChild(index, parent, idx + 1))
+                     : NULL;
+
+    // Front-coded nodes that can neither borrow nor merge within a page are
+    // left underfull
+    bool merged = false;
+    if (left != NULL && canBorrowFromLeft(index, parent, idx, left, node)) {
+        borrowFromLeft(index, parent, idx, left, node);
+    } else if (right != NULL &&
+               canBorrowFromRight(index, parent, idx, node, right)) {
+        borrowFromRight(index, parent, idx, node, right);
+    } else if (left != NULL && canMerge(index, parent, idx - 1, left, node)) {
+        mergeNodes(index, parent, idx - 1, left, node,
+                   right != NULL && node->next == right->id ? right : NULL);
+        merged = true;
+    } else if (right != NULL && canMerge(index, parent, idx, node, right)) {
+        mergeNodes(index, parent, idx, node, right, NULL);
+        merged = true;
+    }
+
+    if (left != NULL) {
+        closeNode(index, left);
+    }
+    if (right != NULL) {
+        closeNode(index, right);
+    }
+
+    // Merging removes a key from the parent, which may underflow in turn
+    if (merged) {
+        rebalanceNode(index, path, height - 1, parent);
+    }
+}
+
+bool removeKeyFromIndex(Index index, KeyId *key) {
+    IndexPath path;
+    Node leaf = traverseForWrite(index, key, &path, isSafeForDelete);
+
+    if (leaf == NULL) {
+        releaseAncestors(index, &path);
+        return false;
+    }
+
+    unsigned idx = searchKey(index, leaf, key);
+
+    KeyId keyId;
+    bool found = false;
+    if (idx < leaf->numKeys) {
+        getInternalKey(index, leaf, idx, &keyId);
+        found = index->cmp(key, &keyId) == 0;
+    }
+
+    if (found) {
+        removeFromNode(index, leaf, idx, idx);
+        rebalanceNode(index, &path, path.height, leaf);
+    }
+
+    closeNode(index, leaf);
+    releaseAncestors(index, &path);
+    return found;
+}
+
+static int compareKeyValues(Index index, KeyId *k1, KeyId *k2) {
+    // Compares keys ignoring the global index that makes them unique
+    switch (index->keyType) {
+        case INT_KEY: {
+            int i1, i2;
+            memcpy(&i1, k1->secKey.key, sizeof(int32_t));
+            memcpy(&i2, k2->secKey.key, sizeof(int32_t));
+            return intcmp(&i1, &i2);
+        }
+        case STR_KEY:
+            return strcmp(k1->secKey.key, k2->secKey.key);
+        default:
+            return intcmp(&k1->priKey, &k2->priKey);
+    }
+}
+
+static Node getFirstLeaf(Index index) {
+    Node curr = getRootShared(index);
+
+    while (curr != NULL && curr->type != LEAF) {
+        Node next = getNodeShared(index, getKeyChild(index, curr, 0));
+        closeNode(index, curr);
+        curr = next;
+    }
+
+    return curr;
+}
+
+struct IndexIterator {
+    Index index;
+    Node leaf;  // Current leaf, or NULL once the range is exhausted
+    unsigned idx;
+    bool bounded;
+    KeyId upper;
+    uint8_t *upperBuf;  // Copy of upper bound value for secondary keys
+};
+
+IndexIterator openIndexIterator(Index index, KeyId *lower, KeyId *upper) {
+    IndexIterator iterator = malloc(sizeof(struct IndexIterator));
+    assert(iterator != NULL);
+
+    iterator->index = index;
+    iterator->bounded = upper != NULL;
+    iterator->upperBuf = NULL;
+
+    if (upper != NULL) {
+        iterator->upper = *upper;
+
+        if (index->keyType != ID_KEY) {
+            iterator->upperBuf = malloc(index->keySize);
+            assert(iterator->upperBuf != NULL);
+            copyKey(index, &iterator->upper, iterator->upperBuf);
+        }
+    }
+
+    // Descends once to the lower bound, after which only leaves are read
+    iterator->idx = 0;
+    if (lower == NULL) {
+        iterator->leaf = getFirstLeaf(index);
     } else {
-        leaf = traverseTo(index, key);
+        iterator->leaf = traverseTo(index, lower);
+
+        if (iterator->leaf != NULL) {
+            iterator->idx = searchKey(index, iterator->leaf, lower);
+        }
+    }
+
+    return iterator;
+}
+
+bool nextIndexEntry(IndexIterator iterator, KeyId *key, RecordId *rid) {
+    Index index = iterator->index;
+
+    while (iterator->leaf != NULL) {
+        Node leaf = iterator->leaf;
+
+        // Moves along the leaf chain once the current leaf is exhausted,
+        // latching the next leaf before releasing the current one
+        if (iterator->idx == leaf->numKeys) {
+            uint32_t nextId = leaf->next;
+            iterator->leaf = nextId == 0 ? NULL : getNodeShared(index, nextId);
+            iterator->idx = 0;
+
+            closeNode(index, leaf);
+            continue;
+        }
+
+        getInternalKey(index, leaf, iterator->idx, key);
+
+        if (iterator->bounded &&
+            compareKeyValues(index, key, &iterator->upper) > 0) {
+            closeNode(index, leaf);
+            iterator->leaf = NULL;
+            return false;
+        }
+
+        *rid = getKeyRecord(index, leaf, iterator->idx++);
+        return true;
+    }
+
+    return false;
+}
+
+void closeIndexIterator(IndexIterator iterator) {
+    if (iterator->leaf != NULL) {
+        closeNode(iterator->index, iterator->leaf);
+    }
+
+    free(iterator->upperBuf);
+    free(iterator);
+}
+
+typedef struct BuildEntry BuildEntry;
+struct BuildEntry {
+    KeyId key;  // First member, so that entries sort with the index cmp
+    RecordId rid;
+};
+
+// Nodes of one level of a bulk build, in key order
+typedef struct IndexLevel IndexLevel;
+struct IndexLevel {
+    uint32_t *ids;
+    uint8_t *maxKeys;  // Largest key below each node, as held in nodes
+    uint8_t *minKeys;  // Smallest key below each node
+    size_t size;
+    size_t capacity;
+};
+
+struct IndexBuilder {
+    Index index;
+    double fillFactor;
+    BuildEntry *entries;
+    uint8_t *keyData;  // Keys of buffered entries, as held in nodes
+    size_t numEntries;
+    FILE **runs;       // Sorted runs spilled to temporary files
+    size_t numRuns;
+    size_t total;
+    Node leaf;         // Leaf being filled, or NULL before the first entry
+    size_t numLeaves;
+    size_t leafTarget;
+    size_t leafBytes;  // Encoded size of a front-coded leaf being filled
+    IndexLevel leaves;
+};
+
+IndexBuilder openIndexBuilder(Index index, double fillFactor) {
+    // Nodes are allocated in key order, so the index must be empty
+    assert(index->rootId == 0 && index->numPages == 0);
+    assert(fillFactor > 0 && fillFactor <= 1);
+
+    pthread_rwlock_wrlock(&index->rootLatch);
+    markIndexUnclean(index);
+    pthread_rwlock_unlock(&index->rootLatch);
+
+    IndexBuilder builder = calloc(1, sizeof(struct IndexBuilder));
+    assert(builder != NULL);
+
+    builder->index = index;
+    builder->fillFactor = fillFactor;
+    builder->entries = malloc(sizeof(BuildEntry) * BUILD_RUN_ENTRIES);
+    builder->keyData = malloc((size_t)index->keySize * BUILD_RUN_ENTRIES);
+    assert(builder->entries != NULL && builder->keyData != NULL);
+
+    return builder;
+}
+
+static void writeRun(IndexBuilder builder) {
+    Index index = builder->index;
+    FILE *run = tmpfile();
+    assert(run != NULL);
+
+    for (size_t i = 0; i < builder->numEntries; i++) {
+        BuildEntry *entry = &builder->entries[i];
+        uint8_t key[index->keySize];
+        writeRawKey(index, &entry->key, key);
+
+        fwrite(key, index->keySize, 1, run);
+        fwrite(&entry->rid.pageId, RID_PAGE_WIDTH, 1, run);
+        fwrite(&entry->rid.slotIdx, RID_SLOT_WIDTH, 1, run);
+    }
+
+    rewind(run);
+
+    builder->runs =
+        realloc(builder->runs, sizeof(FILE *) * (builder->numRuns + 1));
+    assert(builder->runs != NULL);
+    builder->runs[builder->numRuns++] = run;
+    builder->numEntries = 0;
+}
+
+static bool readRunEntry(Index index, FILE *run, BuildEntry *entry,
+                         uint8_t *keyBuf) {
+    if (fread(keyBuf, index->keySize, 1, run) != 1) {
+        return false;
+    }
+
+    fread(&entry->rid.pageId, RID_PAGE_WIDTH, 1, run);
+    fread(&entry->rid.slotIdx, RID_SLOT_WIDTH, 1, run);
+    readRawKey(index, keyBuf, &entry->key);
+    return true;
+}
+
+void addToIndexBuilder(IndexBuilder builder, KeyId *key, RecordId rid) {
+    Index index = builder->index;
+
+    // Spills sorted entries once the buffer is full, so that builds of any
+    // size use bounded memory
+    if (builder->numEntries == BUILD_RUN_ENTRIES) {
+        qsort(builder->entries, builder->numEntries, sizeof(BuildEntry),
+              index->cmp);
+        writeRun(builder);
+    }
+
+    uint8_t *keyBuf =
+        builder->keyData + (size_t)index->keySize * builder->numEntries;
+    writeRawKey(index, key, keyBuf);
+
+    BuildEntry *entry = &builder->entries[builder->numEntries++];
+    readRawKey(index, keyBuf, &entry->key);
+    entry->rid = rid;
+    builder->total++;
+}
+
+static uint8_t *getLevelKey(Index index, uint8_t *keys, size_t idx) {
+    return keys + (size_t)index->keySize * idx;
+}
+
+static void appendToLevel(Index index, IndexLevel *level, uint32_t id,
+                          uint8_t *minKey, uint8_t *maxKey) {
+    if (level->size == level->capacity) {
+        level->capacity = level->capacity == 0 ? 64 : level->capacity * 2;
+        level->ids = realloc(level->ids, sizeof(uint32_t) * level->capacity);
+        level->maxKeys =
+            realloc(level->maxKeys, (size_t)index->keySize * level->capacity);
+        level->minKeys =
+            realloc(level->minKeys, (size_t)index->keySize * level->capacity);
+        assert(level->ids != NULL && level->maxKeys != NULL &&
+               level->minKeys != NULL);
     }
 
-    InsertArgs args = {.offset = offset};
-    insertKey(index, leaf, key, args);
+    level->ids[level->size] = id;
+    memcpy(getLevelKey(index, level->maxKeys, level->size), maxKey,
+           index->keySize);
+    memcpy(getLevelKey(index, level->minKeys, level->size), minKey,
+           index->keySize);
+    level->size++;
+}
+
+static void freeLevel(IndexLevel *level) {
+    free(level->ids);
+    free(level->maxKeys);
+    free(level->minKeys);
+}
+
+static void finishLeaf(IndexBuilder builder) {
+    Index index = builder->index;
+    Node leaf = builder->leaf;
+
+    appendToLevel(index, &builder->leaves, leaf->id, KEY_PTR(index, leaf, 0),
+                  KEY_PTR(index, leaf, leaf->numKeys - 1));
     closeNode(index, leaf);
-}
\ No newline at end of file
+}
+
+static size_t getGroupSize(size_t total, size_t numGroups, size_t idx) {
+    // Spreads entries evenly so that the last node is never nearly empty
+    return total / numGroups + (idx < total % numGroups);
+}
+
+static uint8_t *getLastKey(Index index, Node node) {
+    return node->numKeys == 0 ? NULL : KEY_PTR(index, node, node->numKeys - 1);
+}
+
+static bool isLeafFull(IndexBuilder builder, KeyId *key) {
+    Index index = builder->index;
+    Node leaf = builder->leaf;
+
+    if (leaf == NULL) {
+        return true;
+    }
+
+    // Front-coded leaves take keys until their page reaches the fill factor
+    if (isCompressed(index)) {
+        size_t entrySize =
+            getEntrySize(index, getLastKey(index, leaf), key->secKey.key);
+
+        return leaf->numKeys == index->d * 2 - 1 ||
+               (leaf->numKeys > 0 &&
+                builder->leafBytes + entrySize >
+                    builder->fillFactor * _PAGE_SIZE);
+    }
+
+    size_t numLeaves = (builder->total + builder->leafTarget - 1) /
+                       builder->leafTarget;
+    return leaf->numKeys ==
+           getGroupSize(builder->total, numLeaves, builder->numLeaves - 1);
+}
+
+static void packEntry(IndexBuilder builder, BuildEntry *entry) {
+    Index index = builder->index;
+    Node leaf = builder->leaf;
+
+    if (isLeafFull(builder, &entry->key)) {
+        Node next = addNode(index, LEAF, 0, leaf == NULL ? 0 : leaf->id, 0);
+
+        if (leaf != NULL) {
+            leaf->next = next->id;
+            leaf->headerModified = true;
+            finishLeaf(builder);
+        }
+
+        builder->leaf = leaf = next;
+        builder->numLeaves++;
+        builder->leafBytes = NODE_HEADER_WIDTH;
+    }
+
+    if (isCompressed(index)) {
+        builder->leafBytes += getEntrySize(index, getLastKey(index, leaf),
+                                           entry->key.secKey.key);
+    }
+
+    leaf->numKeys++;
+    leaf->headerModified = true;
+    setInternalKey(index, leaf, leaf->numKeys - 1, &entry->key);
+    setKeyRecord(index, leaf, leaf->numKeys - 1, entry->rid);
+}
+
+static void mergeRuns(IndexBuilder builder) {
+    Index index = builder->index;
+    size_t numRuns = builder->numRuns;
+
+    BuildEntry heads[numRuns];
+    bool hasHead[numRuns];
+    uint8_t *headKeys = malloc((size_t)index->keySize * numRuns);
+    assert(headKeys != NULL);
+
+    for (size_t i = 0; i < numRuns; i++) {
+        hasHead[i] = readRunEntry(index, builder->runs[i], &heads[i],
+                                  headKeys + (size_t)index->keySize * i);
+    }
+
+    // Runs are few, so the smallest head is found by a linear scan
+    while (true) {
+        int min = -1;
+        for (size_t i = 0; i < numRuns; i++) {
+            if (hasHead[i] &&
+                (min < 0 || index->cmp(&heads[i].key, &heads[min].key) < 0)) {
+                min = i;
+            }
+        }
+
+        if (min < 0) {
+            break;
+        }
+
+        packEntry(builder, &heads[min]);
+        hasHead[min] = readRunEntry(index, builder->runs[min], &heads[min],
+                                    headKeys + (size_t)index->keySize * min);
+    }
+
+    free(headKeys);
+}
+
+static size_t getPackedGroupSize(IndexBuilder builder, IndexLevel *children,
+                                 size_t start) {
+    Index index = builder->index;
+    size_t remaining = children->size - start;
+    size_t maxChildren = index->d * 2;
+
+    uint8_t separators[2][index->keySize];
+    uint8_t *prev = NULL;
+    size_t size = NODE_HEADER_WIDTH + CHILD_WIDTH;
+    size_t count = 1;
+
+    // Takes children while the page stays within the fill factor, counting
+    // the truncated separator that each one adds
+    while (count < remaining && count < maxChildren) {
+        uint8_t *separator = separators[count % 2];
+        shortenSeparator(
+            index, getLevelKey(index, children->maxKeys, start + count - 1),
+            getLevelKey(index, children->minKeys, start + count), separator);
+
+        size_t entrySize = getEntrySize(index, prev, separator);
+        if (count >= 2 && size + entrySize > builder->fillFactor * _PAGE_SIZE) {
+            break;
+        }
+
+        size += entrySize;
+        prev = separator;
+        count++;
+    }
+
+    // Last node is given two children rather than one, which still fits as
+    // keys are at most a fifth of a page
+    if (count == remaining - 1 && count > 2) {
+        count--;
+    } else if (count == remaining - 1) {
+        count++;
+    }
+
+    return count;
+}
+
+static IndexLevel buildLevel(IndexBuilder builder, IndexLevel *children) {
+    Index index = builder->index;
+    IndexLevel level = {.size = 0};
+
+    // Internal nodes hold up to 2d children, and at least 3 so that every
+    // node still has at least two children once they are spread evenly
+    size_t maxChildren = index->d * 2;
+    size_t target = builder->fillFactor * maxChildren;
+    target = target < 3 ? 3 : target > maxChildren ? maxChildren : target;
+
+    size_t numNodes = (children->size + target - 1) / target;
+    size_t pos = 0;
+
+    // Front-coded nodes are packed by size rather than spread evenly
+    for (size_t i = 0; pos < children->size; i++) {
+        size_t count = isCompressed(index)
+                           ? getPackedGroupSize(builder, children, pos)
+                           : getGroupSize(children->size, numNodes, i);
+        Node node = addNode(index, INTERNAL, 0, 0, 0);
+        node->numKeys = count - 1;
+
+        // Each child but the last is separated from the next one by its
+        // largest key, truncated for string keys
+        for (size_t j = 0; j < count; j++) {
+            if (j < count - 1) {
+                shortenSeparator(
+                    index, getLevelKey(index, children->maxKeys, pos + j),
+                    getLevelKey(index, children->minKeys, pos + j + 1),
+                    KEY_PTR(index, node, j));
+            }
+            setKeyChild(index, node, j, children->ids[pos + j]);
+        }
+
+        appendToLevel(index, &level, node->id,
+                      getLevelKey(index, children->minKeys, pos),
+                      getLevelKey(index, children->maxKeys, pos + count - 1));
+        closeNode(index, node);
+        pos += count;
+    }
+
+    return level;
+}
+
+void finishIndexBuilder(IndexBuilder builder) {
+    Index index = builder->index;
+
+    // Leaves hold up to 2d - 1 keys
+    size_t maxKeys = index->d * 2 - 1;
+    builder->leafTarget = builder->fillFactor * maxKeys;
+    builder->leafTarget = builder->leafTarget < 1          ? 1
+                          : builder->leafTarget > maxKeys ? maxKeys
+                                                          : builder->leafTarget;
+
+    qsort(builder->entries, builder->numEntries, sizeof(BuildEntry),
+          index->cmp);
+
+    // Entries that all fit in memory are packed without a run file
+    if (builder->numRuns == 0) {
+        for (size_t i = 0; i < builder->numEntries; i++) {
+            packEntry(builder, &builder->entries[i]);
+        }
+    } else {
+        if (builder->numEntries > 0) {
+            writeRun(builder);
+        }
+        mergeRuns(builder);
+    }
+
+    if (builder->leaf != NULL) {
+        finishLeaf(builder);
+    }
+
+    // Packs each level of internal nodes above the previous one until a
+    // single root remains
+    IndexLevel level = builder->leaves;
+    while (level.size > 1) {
+        IndexLevel parents = buildLevel(builder, &level);
+        freeLevel(&level);
+        level = parents;
+    }
+
+    if (level.size == 1) {
+        index->rootId = level.ids[0];
+        index->modified = true;
+    }
+
+    freeLevel(&level);
+
+    for (size_t i = 0; i < builder->numRuns; i++) {
+        fclose(builder->runs[i]);
+    }
+
+    free(builder->runs);
+    free(builder->entries);
+    free(builder->keyData);
+    free(builder);
+}
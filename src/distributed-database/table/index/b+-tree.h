@@ -1,9 +1,29 @@
 #ifndef B_TREE_H
 #define B_TREE_H
 
+#include "table/core/table.h"
 #include "table/schema.h"
 
+// Version 1 widened node ids to 32 bits and stores (page, slot) in leaves,
+// version 2 added the free list of node pages and version 3 front codes the
+// keys of string nodes
+#define INDEX_FORMAT_VERSION 3
+
+// Version held by an index file while it has changes not yet synced
+#define INDEX_UNCLEAN_VERSION 0xFFFF
+
 typedef struct Index *Index;
+typedef struct IndexIterator *IndexIterator;
+typedef struct IndexBuilder *IndexBuilder;
+typedef struct NodeFrame *NodeFrame;
+
+typedef struct IndexCacheStats IndexCacheStats;
+struct IndexCacheStats {
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+    size_t writeBacks;
+};
 
 typedef enum {
     INT_KEY,
@@ -31,34 +51,192 @@ struct Node {
     uint8_t *ptr;
     bool headerModified;
     bool nodeModified;
-    uint16_t id;
-    AttributeType keyType;
+    uint32_t id;
+    KeyType keyType;
     NodeType type;
-    uint16_t parent;
+    uint32_t parent;
     uint16_t numKeys;
-    uint16_t prev;
-    uint16_t next;
+    uint32_t prev;
+    uint32_t next;
     uint16_t leafDirectoryId;
+    NodeFrame frame;  // Cache frame holding node and its latch
 };
 
 extern void createBIndex(size_t typeWidth, AttributeName attribute,
                          KeyType type);
 
+/**
+ * Opens index file in the current format
+ * @param attribute name under which index was created
+ * @return NULL if the file was written in another format version
+ */
 extern Index openIndex(AttributeName attribute);
 
+/**
+ * Reads format version of index file without opening the index
+ * @param indexName name under which index was created
+ * @return 0 for legacy files written before the format was versioned
+ */
+extern unsigned getIndexVersion(char *indexName);
+
+/**
+ * Checks whether index file exists
+ * @param indexName name under which index was created
+ */
+extern bool indexExists(char *indexName);
+
+/**
+ * Deletes index file, if present
+ * @param indexName name under which index was created
+ */
+extern void removeBIndex(char *indexName);
+
+/**
+ * Writes dirty cached nodes and index header back to the index file, as a
+ * checkpoint of the index
+ * @param index
+ */
+extern void flushIndex(Index index);
+
+/**
+ * Flushes index and forces it to disk, after which it is no longer rebuilt
+ * on opening if the process crashes
+ * @param index
+ */
+extern void syncIndex(Index index);
+
+/**
+ * Writes back dirty cached nodes, syncs and closes index
+ * @param index
+ */
 extern void closeIndex(Index index);
 
+/**
+ * Returns hit, miss and eviction counters of the node cache of index
+ * @param index
+ */
+extern IndexCacheStats getIndexCacheStats(Index index);
+
 unsigned getD(Index index);
 unsigned getKeySize(Index index);
 unsigned getRootId(Index index);
 unsigned getNumPages(Index index);
 
-Node getNode(Index index, uint16_t id);
+/**
+ * Pins node in the node cache of index, reading it from the file if not
+ * cached, and latches it exclusively for modification. Each call must be
+ * paired with closeNode
+ * @param index
+ * @param id id of node
+ */
+Node getNode(Index index, uint32_t id);
+
+/**
+ * Pins node as getNode does, but latches it shared with other readers
+ * @param index
+ * @param id id of node
+ */
+Node getNodeShared(Index index, uint32_t id);
+
+/**
+ * Releases latch on node and unpins it, recording any changes so that they
+ * are written back later
+ * @param index
+ * @param node
+ */
 void closeNode(Index index, Node node);
 
-uint16_t getNodeId(Node node);
+uint32_t getNodeId(Node node);
 void getInternalKey(Index index, Node node, unsigned idx, KeyId *dest);
-unsigned getKeyChild(Index index, Node node, unsigned idx);
-void addKeyToIndex(Index index, KeyId *key, unsigned offset);
+uint32_t getKeyChild(Index index, Node node, unsigned idx);
+
+/**
+ * Returns record id stored with key of leaf
+ * @param index
+ * @param node leaf node
+ * @param idx index of key in leaf
+ */
+RecordId getKeyRecord(Index index, Node node, unsigned idx);
+
+/**
+ * Returns position of first key in node that is not less than key, searching
+ * integer keys in place with the current key search mode
+ * @param index
+ * @param node
+ * @param key full key including global index
+ */
+unsigned searchKey(Index index, Node node, KeyId *key);
+
+/**
+ * Adds key to the leaf that should hold it, splitting nodes that are full.
+ * Lookups, iterators and other writers may use the index concurrently
+ * @param index
+ * @param key full key including global index
+ * @param rid record id stored with key
+ */
+void addKeyToIndex(Index index, KeyId *key, RecordId rid);
+
+/**
+ * Starts bulk build of an empty index, which packs nodes bottom-up rather
+ * than inserting keys one at a time
+ * @param index empty index
+ * @param fillFactor fraction of each node filled, leaving room for later
+ * insertions
+ */
+IndexBuilder openIndexBuilder(Index index, double fillFactor);
+
+/**
+ * Adds key to bulk build, in any order. Keys are sorted in memory and
+ * spilled to sorted run files for large builds
+ * @param builder
+ * @param key full key including global index
+ * @param rid record id stored with key
+ */
+void addToIndexBuilder(IndexBuilder builder, KeyId *key, RecordId rid);
+
+/**
+ * Merges sorted keys into packed leaves, builds internal levels above them
+ * and frees builder
+ * @param builder
+ */
+void finishIndexBuilder(IndexBuilder builder);
+
+/**
+ * Removes key from the leaf holding it. Nodes left with fewer than d - 1 keys
+ * borrow from or merge with a sibling, and freed node pages are reused by
+ * later insertions
+ * @param index
+ * @param key full key including global index
+ * @return true if key was found
+ */
+bool removeKeyFromIndex(Index index, KeyId *key);
+
+/**
+ * Opens iterator over keys in an inclusive range, descending from the root
+ * only once to find the lower bound. The current leaf stays latched shared
+ * until the iterator moves past it or is closed, so the same thread must not
+ * modify the index meanwhile
+ * @param index
+ * @param lower lower bound with global index 0, or NULL if unbounded
+ * @param upper upper bound compared by value only, or NULL if unbounded
+ * @return iterator positioned before the first key in range
+ */
+IndexIterator openIndexIterator(Index index, KeyId *lower, KeyId *upper);
+
+/**
+ * Advances iterator along the leaf chain to the next key in range
+ * @param iterator
+ * @param key set to next key, pointing into the current leaf until the next
+ * call
+ * @param rid set to record id stored with key
+ * @return false once no keys remain in range
+ */
+bool nextIndexEntry(IndexIterator iterator, KeyId *key, RecordId *rid);
+
+/**
+ * Releases leaf held by iterator and frees it
+ * @param iterator
+ */
+void closeIndexIterator(IndexIterator iterator);
 
 #endif  // B_TREE_H
@@ -0,0 +1,234 @@
+#include "keySearch.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAS_X86_SIMD
+#endif
+
+// Keys left for the linear compare once the binary search has narrowed the
+// range, so that a window spans a few vectors
+#define SEARCH_WINDOW 16
+
+#define INT_KEY_WIDTH (2 * sizeof(int32_t))
+#define ID_KEY_WIDTH sizeof(int32_t)
+
+static KeySearchMode mode;
+static bool modeChosen = false;
+
+static bool isSupported(KeySearchMode requested) {
+    switch (requested) {
+        case KEY_SEARCH_GENERIC:
+        case KEY_SEARCH_SCALAR:
+            return true;
+#ifdef HAS_X86_SIMD
+        case KEY_SEARCH_SSE2:
+            return __builtin_cpu_supports("sse2");
+        case KEY_SEARCH_AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+KeySearchMode getKeySearchMode(void) {
+    if (!modeChosen) {
+        mode = isSupported(KEY_SEARCH_AVX2)   ? KEY_SEARCH_AVX2
+               : isSupported(KEY_SEARCH_SSE2) ? KEY_SEARCH_SSE2
+                                              : KEY_SEARCH_SCALAR;
+        modeChosen = true;
+    }
+
+    return mode;
+}
+
+void setKeySearchMode(KeySearchMode requested) {
+    modeChosen = false;
+    getKeySearchMode();
+
+    if (isSupported(requested)) {
+        mode = requested;
+    }
+}
+
+static bool isVectorised(KeySearchMode curr) {
+    return curr == KEY_SEARCH_SSE2 || curr == KEY_SEARCH_AVX2;
+}
+
+static inline bool intKeyLess(uint8_t *keys, unsigned idx, int32_t value,
+                              int32_t id) {
+    int32_t key[2];
+    memcpy(key, keys + INT_KEY_WIDTH * idx, INT_KEY_WIDTH);
+    return key[0] < value || (key[0] == value && key[1] < id);
+}
+
+static inline bool idKeyLess(uint8_t *keys, unsigned idx, int32_t search) {
+    int32_t key;
+    memcpy(&key, keys + ID_KEY_WIDTH * idx, ID_KEY_WIDTH);
+    return key < search;
+}
+
+#ifdef HAS_X86_SIMD
+static unsigned countIntKeysSse2(uint8_t *keys, unsigned len, int32_t value,
+                                 int32_t id) {
+    // Each vector holds two keys, with the value in the low half of each
+    // 64-bit lane and the global index in the high half
+    __m128i search = _mm_set_epi32(id, value, id, value);
+    unsigned count = 0;
+
+    for (unsigned i = 0; i < len; i += 2) {
+        __m128i key =
+            _mm_loadu_si128((__m128i *)(keys + INT_KEY_WIDTH * i));
+        __m128i lt = _mm_cmpgt_epi32(search, key);
+        __m128i eq = _mm_cmpeq_epi32(search, key);
+
+        // Moves value comparisons into the high half to combine them with
+        // the global index comparison
+        __m128i less = _mm_or_si128(
+            _mm_slli_epi64(lt, 32), _mm_and_si128(_mm_slli_epi64(eq, 32), lt));
+        unsigned mask = _mm_movemask_pd(_mm_castsi128_pd(less));
+
+        // Keys are sorted, so lesser keys form a prefix of the mask
+        unsigned numLess = __builtin_ctz(~mask);
+        count += numLess < len - i ? numLess : len - i;
+        if (numLess < 2) {
+            break;
+        }
+    }
+
+    return count;
+}
+
+__attribute__((target("avx2"))) static unsigned countIntKeysAvx2(
+    uint8_t *keys, unsigned len, int32_t value, int32_t id) {
+    __m256i search = _mm256_set_epi32(id, value, id, value, id, value, id,
+                                      value);
+    unsigned count = 0;
+
+    for (unsigned i = 0; i < len; i += 4) {
+        __m256i key =
+            _mm256_loadu_si256((__m256i *)(keys + INT_KEY_WIDTH * i));
+        __m256i lt = _mm256_cmpgt_epi32(search, key);
+        __m256i eq = _mm256_cmpeq_epi32(search, key);
+
+        __m256i less = _mm256_or_si256(
+            _mm256_slli_epi64(lt, 32),
+            _mm256_and_si256(_mm256_slli_epi64(eq, 32), lt));
+        unsigned mask = _mm256_movemask_pd(_mm256_castsi256_pd(less));
+
+        unsigned numLess = __builtin_ctz(~mask);
+        count += numLess < len - i ? numLess : len - i;
+        if (numLess < 4) {
+            break;
+        }
+    }
+
+    return count;
+}
+
+static unsigned countIdKeysSse2(uint8_t *keys, unsigned len, int32_t key) {
+    __m128i search = _mm_set1_epi32(key);
+    unsigned count = 0;
+
+    for (unsigned i = 0; i < len; i += 4) {
+        __m128i curr = _mm_loadu_si128((__m128i *)(keys + ID_KEY_WIDTH * i));
+        unsigned mask = _mm_movemask_ps(
+            _mm_castsi128_ps(_mm_cmpgt_epi32(search, curr)));
+
+        unsigned numLess = __builtin_ctz(~mask);
+        count += numLess < len - i ? numLess : len - i;
+        if (numLess < 4) {
+            break;
+        }
+    }
+
+    return count;
+}
+
+__attribute__((target("avx2"))) static unsigned countIdKeysAvx2(
+    uint8_t *keys, unsigned len, int32_t key) {
+    __m256i search = _mm256_set1_epi32(key);
+    unsigned count = 0;
+
+    for (unsigned i = 0; i < len; i += 8) {
+        __m256i curr =
+            _mm256_loadu_si256((__m256i *)(keys + ID_KEY_WIDTH * i));
+        unsigned mask = _mm256_movemask_ps(
+            _mm256_castsi256_ps(_mm256_cmpgt_epi32(search, curr)));
+
+        unsigned numLess = __builtin_ctz(~mask);
+        count += numLess < len - i ? numLess : len - i;
+        if (numLess < 8) {
+            break;
+        }
+    }
+
+    return count;
+}
+#endif
+
+// Vector loads may read a few keys past the window, which stay within the
+// node page as the key array is followed by the children
+unsigned searchIntKeys(uint8_t *keys, unsigned numKeys, int32_t value,
+                       int32_t id) {
+    KeySearchMode curr = getKeySearchMode();
+    unsigned lo = 0;
+    unsigned len = numKeys;
+
+    // Branchless binary search, where the first key not less than the
+    // search key always lies in [lo, lo + len]
+    unsigned window = isVectorised(curr) ? SEARCH_WINDOW : 1;
+    while (len > window) {
+        unsigned half = len / 2;
+        lo += intKeyLess(keys, lo + half - 1, value, id) ? half : 0;
+        len -= half;
+    }
+
+    uint8_t *start = keys + INT_KEY_WIDTH * lo;
+
+#ifdef HAS_X86_SIMD
+    if (curr == KEY_SEARCH_AVX2) {
+        return lo + countIntKeysAvx2(start, len, value, id);
+    }
+    if (curr == KEY_SEARCH_SSE2) {
+        return lo + countIntKeysSse2(start, len, value, id);
+    }
+#endif
+
+    for (unsigned i = 0; i < len; i++) {
+        lo += intKeyLess(start, i, value, id);
+    }
+    return lo;
+}
+
+unsigned searchIdKeys(uint8_t *keys, unsigned numKeys, int32_t key) {
+    KeySearchMode curr = getKeySearchMode();
+    unsigned lo = 0;
+    unsigned len = numKeys;
+
+    unsigned window = isVectorised(curr) ? SEARCH_WINDOW : 1;
+    while (len > window) {
+        unsigned half = len / 2;
+        lo += idKeyLess(keys, lo + half - 1, key) ? half : 0;
+        len -= half;
+    }
+
+    uint8_t *start = keys + ID_KEY_WIDTH * lo;
+
+#ifdef HAS_X86_SIMD
+    if (curr == KEY_SEARCH_AVX2) {
+        return lo + countIdKeysAvx2(start, len, key);
+    }
+    if (curr == KEY_SEARCH_SSE2) {
+        return lo + countIdKeysSse2(start, len, key);
+    }
+#endif
+
+    for (unsigned i = 0; i < len; i++) {
+        lo += idKeyLess(start, i, key);
+    }
+    return lo;
+}
@@ -0,0 +1,46 @@
+#ifndef KEY_SEARCH_H
+#define KEY_SEARCH_H
+
+#include <stdint.h>
+
+typedef enum {
+    KEY_SEARCH_GENERIC,  // Binary search through the index comparator
+    KEY_SEARCH_SCALAR,
+    KEY_SEARCH_SSE2,
+    KEY_SEARCH_AVX2,
+} KeySearchMode;
+
+/**
+ * Returns the fastest key search supported by the CPU, unless another mode
+ * has been set
+ */
+extern KeySearchMode getKeySearchMode(void);
+
+/**
+ * Overrides the key search used for integer keys, falling back to the
+ * fastest supported mode if the CPU lacks the requested instructions
+ * @param mode
+ */
+extern void setKeySearchMode(KeySearchMode mode);
+
+/**
+ * Finds position of first INT_KEY key not less than the search key, where
+ * keys are held as pairs of 32-bit value and global index
+ * @param keys start of key array of node
+ * @param numKeys number of keys in node
+ * @param value value of search key
+ * @param id global index of search key
+ */
+extern unsigned searchIntKeys(uint8_t *keys, unsigned numKeys, int32_t value,
+                              int32_t id);
+
+/**
+ * Finds position of first ID_KEY key not less than the search key, where
+ * keys are held as 32-bit values
+ * @param keys start of key array of node
+ * @param numKeys number of keys in node
+ * @param key search key
+ */
+extern unsigned searchIdKeys(uint8_t *keys, unsigned numKeys, int32_t key);
+
+#endif  // KEY_SEARCH_H
@@ -0,0 +1,473 @@
+#include "tableIndexes.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "b+-tree.h"
+#include "log.h"
+#include "table/core/field.h"
+#include "table/core/pages.h"
+
+// Keeps at least four keys per node so that nodes can be split, and keeps
+// both halves of a split string node within a page with the key inserted
+#define MAX_KEY_WIDTH 800
+
+// Leaves room in bulk-built nodes for keys inserted afterwards
+#define INDEX_FILL_FACTOR 0.9
+
+typedef struct IndexedAttribute IndexedAttribute;
+struct IndexedAttribute {
+    Index index;
+    unsigned attrIdx;
+    char name[MAX_FILE_NAME_LEN];
+};
+
+struct TableIndexes {
+    Schema *schema;
+    unsigned numIndexes;
+    IndexedAttribute *indexes;
+};
+
+// Range of values admitted by an indexed comparison, with inclusive bounds
+typedef struct IndexRange IndexRange;
+struct IndexRange {
+    IndexedAttribute *indexed;
+    Operand lower;  // NULL if unbounded
+    Operand upper;  // NULL if unbounded
+    int rank;       // Lower ranks narrow the range more
+};
+
+static void getIndexName(char *tableName, AttributeName attribute,
+                         char *dest) {
+    int len = snprintf(dest, MAX_FILE_NAME_LEN, "%s-%s", tableName, attribute);
+    assert(len < MAX_FILE_NAME_LEN);
+}
+
+static bool getKeyFormat(AttrInfo *info, KeyType *type, unsigned *width) {
+    switch (info->type) {
+        case INT:
+            *type = INT_KEY;
+            *width = INT_WIDTH + GLOBAL_ID_WIDTH;
+            return true;
+        case STR:
+        case VARSTR:
+            // Strings are held with their terminator
+            *type = STR_KEY;
+            *width = info->size + 1 + GLOBAL_ID_WIDTH;
+            return *width <= MAX_KEY_WIDTH;
+        default:
+            return false;
+    }
+}
+
+static int findAttribute(Schema *schema, AttributeName attribute) {
+    for (unsigned i = 0; i < schema->numAttrs; i++) {
+        if (strcmp(schema->attrInfos[i].name, attribute) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static IndexedAttribute *findIndexed(TableIndexes indexes,
+                                     AttributeName attribute) {
+    for (unsigned i = 0; i < indexes->numIndexes; i++) {
+        IndexedAttribute *indexed = &indexes->indexes[i];
+        AttrInfo *info = &indexes->schema->attrInfos[indexed->attrIdx];
+
+        if (strcmp(info->name, attribute) == 0) {
+            return indexed;
+        }
+    }
+
+    return NULL;
+}
+
+static IndexedAttribute *appendIndexed(TableIndexes indexes, Index index,
+                                       unsigned attrIdx, char *name) {
+    indexes->indexes =
+        realloc(indexes->indexes,
+                sizeof(IndexedAttribute) * (indexes->numIndexes + 1));
+    assert(indexes->indexes != NULL);
+
+    IndexedAttribute *indexed = &indexes->indexes[indexes->numIndexes++];
+    indexed->index = index;
+    indexed->attrIdx = attrIdx;
+    strcpy(indexed->name, name);
+
+    return indexed;
+}
+
+static void setStrKey(uint8_t *dest, unsigned width, char *str,
+                      unsigned len) {
+    memset(dest, 0, width);
+
+    // Truncation preserves order, so ranges over truncated keys still cover
+    // every matching record
+    len = strnlen(str, len);
+    if (len > width - 1) {
+        len = width - 1;
+    }
+
+    memcpy(dest, str, len);
+}
+
+static void getRecordKey(IndexedAttribute *indexed, RecordView *view,
+                         uint8_t *dest, KeyId *key) {
+    unsigned size;
+    uint8_t *field = getViewField(view, indexed->attrIdx, &size);
+
+    if (view->schema->attrInfos[indexed->attrIdx].type == INT) {
+        memcpy(dest, field, INT_WIDTH);
+    } else {
+        setStrKey(dest, getKeySize(indexed->index) - GLOBAL_ID_WIDTH,
+                  (char *)field, size);
+    }
+
+    key->secKey.key = dest;
+    key->secKey.id = getViewGlobalIdx(view);
+}
+
+static void getOperandKey(IndexedAttribute *indexed, Operand op,
+                          uint8_t *dest, KeyId *key) {
+    if (op->type == INT) {
+        memcpy(dest, &op->value.intOp, INT_WIDTH);
+    } else {
+        setStrKey(dest, getKeySize(indexed->index) - GLOBAL_ID_WIDTH,
+                  op->value.strOp, strlen(op->value.strOp));
+    }
+
+    // Smallest global index, so that the bound precedes all equal values
+    key->secKey.key = dest;
+    key->secKey.id = 0;
+}
+
+static void addRecordKey(IndexedAttribute *indexed, RecordView *view,
+                         RecordId rid) {
+    uint8_t buf[getKeySize(indexed->index)];
+    KeyId key;
+    getRecordKey(indexed, view, buf, &key);
+
+    addKeyToIndex(indexed->index, &key, rid);
+}
+
+static void addRecordToBuilder(IndexedAttribute *indexed,
+                               IndexBuilder builder, RecordView *view,
+                               RecordId rid) {
+    uint8_t buf[getKeySize(indexed->index)];
+    KeyId key;
+    getRecordKey(indexed, view, buf, &key);
+
+    addToIndexBuilder(builder, &key, rid);
+}
+
+static bool buildIndex(TableIndexes indexes, TableInfo tableInfo,
+                       unsigned attrIdx, char *name) {
+    KeyType type;
+    unsigned width;
+    if (!getKeyFormat(&indexes->schema->attrInfos[attrIdx], &type, &width)) {
+        return false;
+    }
+
+    createBIndex(width, name, type);
+    IndexedAttribute *indexed =
+        appendIndexed(indexes, openIndex(name), attrIdx, name);
+
+    // Builds index from records already in the table in a single pass,
+    // packing nodes bottom-up once all keys are sorted
+    IndexBuilder builder = openIndexBuilder(indexed->index, INDEX_FILL_FACTOR);
+    struct RecordIterator iterator;
+    initialiseRecordIterator(&iterator);
+
+    bool canContinue = iterateRecords(tableInfo, &iterator, true);
+    while (canContinue) {
+        RecordView view = getRecordView(
+            iterator.page->ptr + iterator.lastSlot->offset, indexes->schema);
+        RecordId rid = {.pageId = iterator.page->pageId,
+                        .slotIdx = iterator.slotIdx - 1};
+        addRecordToBuilder(indexed, builder, &view, rid);
+
+        canContinue = iterateRecords(tableInfo, &iterator, true);
+    }
+
+    freeRecordIterator(&iterator);
+    finishIndexBuilder(builder);
+
+    // Index built from the whole relation is synced at once, so that a crash
+    // does not leave it to be built again
+    syncIndex(indexed->index);
+
+    return true;
+}
+
+TableIndexes openTableIndexes(TableInfo tableInfo, Schema *schema) {
+    TableIndexes indexes = malloc(sizeof(struct TableIndexes));
+    assert(indexes != NULL);
+
+    indexes->schema = schema;
+    indexes->numIndexes = 0;
+    indexes->indexes = NULL;
+
+    for (unsigned i = 0; i < schema->numAttrs; i++) {
+        char name[MAX_FILE_NAME_LEN];
+        getIndexName(tableInfo->name, schema->attrInfos[i].name, name);
+
+        if (!indexExists(name)) {
+            continue;
+        }
+
+        unsigned version = getIndexVersion(name);
+        if (version == INDEX_FORMAT_VERSION) {
+            appendIndexed(indexes, openIndex(name), i, name);
+            continue;
+        }
+
+        // Leaves of older formats lack record slots and indexes left unclean
+        // may miss changes, so the index is rebuilt from the relation
+        if (version == INDEX_UNCLEAN_VERSION) {
+            LOG("Rebuilding index %s left unclean by a crash", name);
+        } else {
+            LOG("Rebuilding index %s from format version %u", name, version);
+        }
+        removeBIndex(name);
+        buildIndex(indexes, tableInfo, i, name);
+    }
+
+    return indexes;
+}
+
+void flushTableIndexes(TableIndexes indexes) {
+    if (indexes == NULL) {
+        return;
+    }
+
+    for (unsigned i = 0; i < indexes->numIndexes; i++) {
+        flushIndex(indexes->indexes[i].index);
+    }
+}
+
+void syncTableIndexes(TableIndexes indexes) {
+    if (indexes == NULL) {
+        return;
+    }
+
+    for (unsigned i = 0; i < indexes->numIndexes; i++) {
+        syncIndex(indexes->indexes[i].index);
+    }
+}
+
+void closeTableIndexes(TableIndexes indexes) {
+    if (indexes == NULL) {
+        return;
+    }
+
+    for (unsigned i = 0; i < indexes->numIndexes; i++) {
+        closeIndex(indexes->indexes[i].index);
+    }
+
+    free(indexes->indexes);
+    free(indexes);
+}
+
+void dropTableIndex(char *tableName, AttributeName attribute) {
+    char name[MAX_FILE_NAME_LEN];
+    getIndexName(tableName, attribute, name);
+
+    removeBIndex(name);
+}
+
+bool addTableIndex(TableIndexes indexes, TableInfo tableInfo,
+                   AttributeName attribute) {
+    int attrIdx = findAttribute(indexes->schema, attribute);
+    if (attrIdx < 0) {
+        LOG("Attribute %s does not exist", attribute);
+        return false;
+    }
+
+    if (findIndexed(indexes, attribute) != NULL) {
+        LOG("Attribute %s is already indexed", attribute);
+        return true;
+    }
+
+    char name[MAX_FILE_NAME_LEN];
+    getIndexName(tableInfo->name, attribute, name);
+
+    if (!buildIndex(indexes, tableInfo, attrIdx, name)) {
+        LOG("Attribute %s cannot be indexed", attribute);
+        return false;
+    }
+
+    return true;
+}
+
+void indexRecord(TableIndexes indexes, uint8_t *recordPtr, RecordId rid) {
+    if (indexes == NULL) {
+        return;
+    }
+
+    RecordView view = getRecordView(recordPtr, indexes->schema);
+
+    for (unsigned i = 0; i < indexes->numIndexes; i++) {
+        addRecordKey(&indexes->indexes[i], &view, rid);
+    }
+}
+
+void unindexRecord(TableIndexes indexes, RecordView *view) {
+    if (indexes == NULL) {
+        return;
+    }
+
+    for (unsigned i = 0; i < indexes->numIndexes; i++) {
+        IndexedAttribute *indexed = &indexes->indexes[i];
+        uint8_t buf[getKeySize(indexed->index)];
+        KeyId key;
+        getRecordKey(indexed, view, buf, &key);
+
+        removeKeyFromIndex(indexed->index, &key);
+    }
+}
+
+static bool operandMatches(AttrInfo *info, Operand op) {
+    if (info->type == INT) {
+        return op->type == INT;
+    }
+
+    return op->type == STR || op->type == VARSTR;
+}
+
+static void considerRange(TableIndexes indexes, Operand attr, Operand lower,
+                          Operand upper, int rank, IndexRange *best) {
+    if (attr->type != ATTR) {
+        return;
+    }
+
+    IndexedAttribute *indexed = findIndexed(indexes, attr->value.strOp);
+    if (indexed == NULL) {
+        return;
+    }
+
+    AttrInfo *info = &indexes->schema->attrInfos[indexed->attrIdx];
+    if ((lower != NULL && !operandMatches(info, lower)) ||
+        (upper != NULL && !operandMatches(info, upper))) {
+        return;
+    }
+
+    if (best->indexed == NULL || rank < best->rank) {
+        best->indexed = indexed;
+        best->lower = lower;
+        best->upper = upper;
+        best->rank = rank;
+    }
+}
+
+static void chooseRange(TableIndexes indexes, Condition condition,
+                        IndexRange *best) {
+    Operand attr = condition->value.twoArg.op1;
+    Operand value = condition->value.twoArg.op2;
+
+    // Only comparisons that every matching record satisfies restrict the
+    // records to visit, so OR and NOT are not looked into
+    switch (condition->type) {
+        case AND:
+            chooseRange(indexes, condition->value.binary.left, best);
+            chooseRange(indexes, condition->value.binary.right, best);
+            break;
+        case EQUALS:
+            considerRange(indexes, attr, value, value, 0, best);
+            break;
+        case BETWEEN:
+            considerRange(indexes, condition->value.between.op1,
+                          condition->value.between.op2,
+                          condition->value.between.op3, 1, best);
+            break;
+        case LESS_THAN:
+        case LESS_EQUALS:
+            considerRange(indexes, attr, NULL, value, 2, best);
+            break;
+        case GREATER_THAN:
+        case GREATER_EQUALS:
+            considerRange(indexes, attr, value, NULL, 2, best);
+            break;
+        default:
+            break;
+    }
+}
+
+static int compareRecordIds(const void *x, const void *y) {
+    RecordId *id1 = (RecordId *)x;
+    RecordId *id2 = (RecordId *)y;
+
+    if (id1->pageId != id2->pageId) {
+        return (id1->pageId > id2->pageId) - (id1->pageId < id2->pageId);
+    }
+    return (id1->slotIdx > id2->slotIdx) - (id1->slotIdx < id2->slotIdx);
+}
+
+void restrictToIndexedPages(TableIndexes indexes, Condition condition,
+                            RecordIterator iterator) {
+    if (indexes == NULL || condition == NULL) {
+        return;
+    }
+
+    IndexRange range = {.indexed = NULL};
+    chooseRange(indexes, condition, &range);
+
+    if (range.indexed == NULL) {
+        return;
+    }
+
+    Index index = range.indexed->index;
+    uint8_t lowerBuf[getKeySize(index)];
+    uint8_t upperBuf[getKeySize(index)];
+    KeyId lower, upper;
+
+    if (range.lower != NULL) {
+        getOperandKey(range.indexed, range.lower, lowerBuf, &lower);
+    }
+    if (range.upper != NULL) {
+        getOperandKey(range.indexed, range.upper, upperBuf, &upper);
+    }
+
+    IndexIterator indexIterator =
+        openIndexIterator(index, range.lower != NULL ? &lower : NULL,
+                          range.upper != NULL ? &upper : NULL);
+
+    size_t numRids = 0;
+    size_t capacity = 16;
+    RecordId *rids = malloc(sizeof(RecordId) * capacity);
+    assert(rids != NULL);
+
+    KeyId key;
+    RecordId rid;
+    while (nextIndexEntry(indexIterator, &key, &rid)) {
+        if (numRids == capacity) {
+            capacity *= 2;
+            rids = realloc(rids, sizeof(RecordId) * capacity);
+            assert(rids != NULL);
+        }
+
+        rids[numRids++] = rid;
+    }
+
+    closeIndexIterator(indexIterator);
+
+    // Visits each page holding a match once, in file order
+    qsort(rids, numRids, sizeof(RecordId), compareRecordIds);
+
+    uint32_t *pageIds = malloc(sizeof(uint32_t) * (numRids + 1));
+    assert(pageIds != NULL);
+
+    size_t numPageIds = 0;
+    for (size_t i = 0; i < numRids; i++) {
+        if (numPageIds == 0 || pageIds[numPageIds - 1] != rids[i].pageId) {
+            pageIds[numPageIds++] = rids[i].pageId;
+        }
+    }
+
+    free(rids);
+    restrictRecordIterator(iterator, pageIds, numPageIds);
+}
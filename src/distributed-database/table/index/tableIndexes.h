@@ -0,0 +1,85 @@
+#ifndef TABLE_INDEXES_H
+#define TABLE_INDEXES_H
+
+#include <stdbool.h>
+
+#include "table/core/record.h"
+#include "table/core/table.h"
+#include "table/operations/operation.h"
+#include "table/schema.h"
+
+/**
+ * Opens the index of every attribute of relation that has an index file,
+ * rebuilding index files written in an older format from the relation
+ * @param tableInfo relation table
+ * @param schema schema of relation, which must outlive the indexes
+ * @return open indexes of relation, possibly none
+ */
+extern TableIndexes openTableIndexes(TableInfo tableInfo, Schema *schema);
+
+/**
+ * Writes index headers and buffered nodes back to the index files
+ * @param indexes indexes of relation, or NULL
+ */
+extern void flushTableIndexes(TableIndexes indexes);
+
+/**
+ * Writes back and forces index files to disk, marking them as consistent
+ * @param indexes indexes of relation, or NULL
+ */
+extern void syncTableIndexes(TableIndexes indexes);
+
+/**
+ * Closes index files and frees indexes
+ * @param indexes indexes of relation, or NULL
+ */
+extern void closeTableIndexes(TableIndexes indexes);
+
+/**
+ * Creates index on attribute of relation from its existing records and adds
+ * it to the open indexes
+ * @param indexes open indexes of relation
+ * @param tableInfo relation table
+ * @param attribute name of attribute to index
+ * @return false if attribute does not exist or cannot be indexed
+ */
+extern bool addTableIndex(TableIndexes indexes, TableInfo tableInfo,
+                          AttributeName attribute);
+
+/**
+ * Deletes the index file of attribute of relation, if present
+ * @param tableName name of relation table
+ * @param attribute name of attribute
+ */
+extern void dropTableIndex(char *tableName, AttributeName attribute);
+
+/**
+ * Adds keys of record written in page to all indexes
+ * @param indexes indexes of relation, or NULL
+ * @param recordPtr start of record in page
+ * @param rid page and slot holding record
+ */
+extern void indexRecord(TableIndexes indexes, uint8_t *recordPtr,
+                        RecordId rid);
+
+/**
+ * Removes keys of record from all indexes, before the record is removed or
+ * modified
+ * @param indexes indexes of relation, or NULL
+ * @param view view of record in its page
+ */
+extern void unindexRecord(TableIndexes indexes, RecordView *view);
+
+/**
+ * Restricts iterator to pages that may hold records satisfying condition,
+ * using the index of the most selective indexed comparison that every
+ * matching record must satisfy. The iterator is left unchanged if no index
+ * applies, and conditions must still be evaluated on each record
+ * @param indexes indexes of relation, or NULL
+ * @param condition condition of query, or NULL
+ * @param iterator initialised iterator that has not yet been advanced
+ */
+extern void restrictToIndexedPages(TableIndexes indexes, Condition condition,
+                                   RecordIterator iterator);
+
+#endif  // TABLE_INDEXES_H
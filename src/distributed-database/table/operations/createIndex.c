@@ -0,0 +1,19 @@
+#include "createIndex.h"
+
+#include "log.h"
+#include "table/index/tableIndexes.h"
+
+void createIndex(TableInfo tableInfo, Operation operation) {
+    AttributeName attribute = operation->query.createIndex.attribute;
+
+    // Only relations have their indexes loaded
+    if (tableInfo->indexes == NULL) {
+        LOG("Indexes can only be created on relations");
+        return;
+    }
+
+    if (!addTableIndex(tableInfo->indexes, tableInfo, attribute)) {
+        LOG("Could not create index on %s of %s", attribute,
+            operation->tableName);
+    }
+}
@@ -0,0 +1,14 @@
+#ifndef CREATE_INDEX_H
+#define CREATE_INDEX_H
+
+#include "table/operations/operation.h"
+
+/**
+ * Creates B+ tree index on attribute of relation from its existing records,
+ * which is then maintained by later writes and used by queries
+ * @param tableInfo relation table with its indexes loaded
+ * @param operation operation parameters
+ */
+extern void createIndex(TableInfo tableInfo, Operation operation);
+
+#endif  // CREATE_INDEX_H
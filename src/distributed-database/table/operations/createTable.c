@@ -6,6 +6,7 @@
 #include <string.h>
 
 #include "../core/field.h"
+#include "../index/tableIndexes.h"
 #include "../schema.h"
 #include "insert.h"
 #include "sqlToOperation.h"
@@ -48,6 +49,9 @@ void createTable(Operation operation) {
         if (type->type != VARSTR && type->type != STR) {
             type->size = getStaticTypeWidth(type->type);
         }
+
+        // Indexes left from a previous table of the same name are stale
+        dropTableIndex(operation->tableName, type->name);
     }
 
     // Writes the schema of the table
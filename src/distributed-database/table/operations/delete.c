@@ -2,21 +2,26 @@
 #include "../core/pages.h"
 #include "../core/record.h"
 #include "table/core/table.h"
+#include "table/index/tableIndexes.h"
 #include "table/operations/operation.h"
 
 void deleteFrom(TableInfo table, TableInfo spaceMap, Schema *schema,
                 Condition condition) {
     struct RecordIterator iterator;
     initialiseRecordIterator(&iterator);
+    restrictToIndexedPages(table->indexes, condition, &iterator);
 
+    ConditionPlan plan = compileCondition(condition, schema);
     bool canIterate = iterateRecords(table, &iterator, false);
     while (canIterate) {
-        Record record = parseRecord(iterator.page->ptr + iterator.lastSlot->offset, schema);
-        if (evaluate(record, condition)) {
-            removeRecord(iterator.page, iterator.lastSlot, record->size);
+        RecordView view = getRecordView(
+            iterator.page->ptr + iterator.lastSlot->offset, schema);
+        if (evaluate(plan, &view)) {
+            unindexRecord(table->indexes, &view);
+            removeRecord(iterator.page, iterator.lastSlot,
+                         iterator.lastSlot->size);
         }
 
-        freeRecord(record);
         Page oldPage = iterator.page;
         canIterate = iterateRecords(table, &iterator, false);
 
@@ -30,6 +35,7 @@ void deleteFrom(TableInfo table, TableInfo spaceMap, Schema *schema,
     }
 
     updateTableHeader(table);
+    freeConditionPlan(plan);
     freeRecordIterator(&iterator);
 }
 
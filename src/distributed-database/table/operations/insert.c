@@ -9,6 +9,7 @@
 #include "log.h"
 #include "table/core/recordArray.h"
 #include "table/core/table.h"
+#include "table/index/tableIndexes.h"
 
 void insertInto(TableInfo tableInfo, TableInfo spaceMap, Schema *schema,
                 QueryAttributes attributes, QueryValues values,
@@ -41,7 +42,8 @@ void insertInto(TableInfo tableInfo, TableInfo spaceMap, Schema *schema,
     }
 }
 
-void insertRecord(TableInfo tableInfo, TableInfo spaceMap, Record record, TableType type) {
+RecordId insertRecord(TableInfo tableInfo, TableInfo spaceMap, Record record,
+                      TableType type) {
     Page page = nextFreePage(tableInfo, spaceMap, record->size, type);
 
     // Increment global index
@@ -50,19 +52,24 @@ void insertRecord(TableInfo tableInfo, TableInfo spaceMap, Record record, TableT
 
     // Calculates position at which to insert record
     uint16_t recordStart = page->header->recordStart - record->size;
+    beginPageUpdate(page);
     writeRecord(
         page->ptr + recordStart, record);
 
-    updatePageHeaderInsert(record, page, recordStart);
+    RecordId id = {.pageId = page->pageId,
+                   .slotIdx = updatePageHeaderInsert(record, page, recordStart)};
     updatePage(tableInfo, page);
 
     if (type == RELATION) {
         // Updates free space in page if table is a relation
         updateSpaceInventory(spaceMap, page);
+        indexRecord(tableInfo->indexes, page->ptr + recordStart, id);
     }
 
     freePage(page);
     updateTableHeader(tableInfo);
+
+    return id;
 }
 
 void insertOperation(TableInfo tableInfo, TableInfo spaceMap, Schema *schema,
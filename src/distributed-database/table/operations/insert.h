@@ -12,6 +12,11 @@ extern void insertInto(TableInfo tableInfo, TableInfo spaceMap, Schema *schema,
                        QueryAttributes attributes, QueryValues values,
                        TableType type);
 
-extern void insertRecord(TableInfo tableInfo, TableInfo spaceMap, Record record, TableType type);
+/**
+ * Inserts record into first page with enough free space
+ * @return location of inserted record
+ */
+extern RecordId insertRecord(TableInfo tableInfo, TableInfo spaceMap,
+                             Record record, TableType type);
 
 #endif  // INSERT_H
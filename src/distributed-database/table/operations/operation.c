@@ -5,7 +5,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "../catalog.h"
 #include "../schema.h"
+#include "createIndex.h"
 #include "createTable.h"
 #include "delete.h"
 #include "insert.h"
@@ -15,28 +17,43 @@
 #include "table/core/record.h"
 #include "table/core/recordArray.h"
 #include "table/core/table.h"
+#include "table/core/wal.h"
 #include "update.h"
 
-QueryResult executeQualifiedOperation(Operation operation, TableType tableType) {
+static QueryResult runOperation(Operation operation, TableType tableType,
+                                int logIndex) {
+    // Reads share the table handles, as pages and index nodes are latched
+    // where they are cached
+    if (isWriteOperation(operation)) {
+        lockCatalog();
+    } else {
+        lockCatalogShared();
+    }
+
     if (operation->queryType == CREATE_TABLE) {
+        // Files being recreated are written directly, so no logged change to
+        // the cached tables may be left to replay over them
+        checkpointCatalog();
+
+        // Cached handles and schema refer to the files being recreated
+        invalidateCatalogRelation(operation->tableName);
         createTable(operation);
+        commitCatalogOperation(logIndex);
+        unlockCatalog();
         return NULL;
     }
 
-    TableInfo tableInfo = openTable(operation->tableName);
+    TableInfo tableInfo = getCatalogTable(operation->tableName);
     Schema schema;
     TableInfo spaceInfo = NULL;
 
     if (tableType == RELATION) {
-        char schemaName[100];
-        snprintf(schemaName, sizeof(schemaName), "%s-schema", operation->tableName);
-        TableInfo schemaInfo = openTable(schemaName);
-        schema = *getSchema(schemaInfo);
-        closeTable(schemaInfo);
+        schema = *getCatalogSchema(operation->tableName);
+        getCatalogIndexes(operation->tableName);
 
         char spaceName[100];
         snprintf(spaceName, sizeof(spaceName), "%s-space-inventory", operation->tableName);
-        spaceInfo = openTable(spaceName);
+        spaceInfo = getCatalogTable(spaceName);
     } else if (tableType == SCHEMA) {
         Schema dictSchema = getDictSchema();
         schema = dictSchema;
@@ -47,6 +64,10 @@ QueryResult executeQualifiedOperation(Operation operation, TableType tableType)
 
     QueryResult res = NULL;
 
+    if (isWriteOperation(operation)) {
+        beginPageChanges();
+    }
+
     switch (operation->queryType) {
         case SELECT:
             res = selectOperation(tableInfo, &schema, operation);
@@ -60,22 +81,36 @@ QueryResult executeQualifiedOperation(Operation operation, TableType tableType)
         case DELETE:
             deleteOperation(tableInfo, spaceInfo, &schema, operation);
             break;
+        case CREATE_INDEX:
+            createIndex(tableInfo, operation);
+            break;
         default:
             LOG_ERROR("Unexpected operation\n");
     }
 
-    if (spaceInfo != NULL) {
-        closeTable(spaceInfo);
+    // Tables stay open, so writes are made durable through the WAL at the
+    // end of each operation and reach the table files at checkpoints
+    if (isWriteOperation(operation)) {
+        commitCatalogOperation(logIndex);
     }
-    closeTable(tableInfo);
+
+    unlockCatalog();
 
     return res;
 }
 
+QueryResult executeQualifiedOperation(Operation operation, TableType tableType) {
+    return runOperation(operation, tableType, NO_LOG_INDEX);
+}
+
 QueryResult executeOperation(Operation operation) {
     return executeQualifiedOperation(operation, RELATION);
 }
 
+QueryResult applyOperation(Operation operation, int logIndex) {
+    return runOperation(operation, RELATION, logIndex);
+}
+
 void initDatabasePath(size_t nodeId) {
     int pathLen = snprintf(DB_DIRECTORY, MAX_FILE_NAME_LEN, "%s/%ld/data",
                            DB_BASE_DIRECTORY, nodeId);
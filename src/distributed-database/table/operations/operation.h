@@ -10,7 +10,14 @@
 // uint8_t is used to represent enums within the struct to make parsing and
 // encoding easier
 typedef enum { INT = 0, STR, VARSTR, FLOAT, BOOL, ATTR } AttributeType;
-typedef enum { SELECT, INSERT, UPDATE, DELETE, CREATE_TABLE } QueryType;
+typedef enum {
+    SELECT,
+    INSERT,
+    UPDATE,
+    DELETE,
+    CREATE_TABLE,
+    CREATE_INDEX
+} QueryType;
 typedef enum {
     EQUALS,
     LESS_THAN,
@@ -23,6 +30,9 @@ typedef enum {
     NOT
 } ConditionType;
 
+// Maximum nesting of parenthesised and negated subconditions
+#define MAX_CONDITION_DEPTH 32
+
 typedef char *AttributeName;
 typedef struct QueryResult *QueryResult;
 
@@ -67,7 +77,8 @@ struct Condition {
     ConditionType type;
     union {
         struct {
-            Operand op1;
+            Operand op1;      // Negated boolean attribute, or NULL
+            Condition child;  // Negated subcondition when op1 is NULL
         } oneArg;
         struct {
             Operand op1;
@@ -78,6 +89,10 @@ struct Condition {
             Operand op2;
             Operand op3;
         } between;
+        struct {
+            Condition left;
+            Condition right;
+        } binary;
     } value;
 };
 
@@ -105,6 +120,9 @@ struct Operation {
         struct {
             QueryTypes types;
         } createTable;
+        struct {
+            AttributeName attribute;
+        } createIndex;
     } query;
 };
 
@@ -122,6 +140,14 @@ extern QueryResult executeQualifiedOperation(Operation operation, TableType tabl
  */
 extern QueryResult executeOperation(Operation operation);
 
+/**
+ * Executes operation of a committed raft log entry, recording its index with
+ * the changes so that recovery knows which entries the tables hold
+ * @param operation
+ * @param logIndex index of entry in raft log
+ */
+extern QueryResult applyOperation(Operation operation, int logIndex);
+
 /**
  * Determines whether operation is read (select) or write (any other operation)
  * @param operation
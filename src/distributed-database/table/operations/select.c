@@ -9,6 +9,7 @@
 #include "../core/recordArray.h"
 #include "../core/table.h"
 #include "log.h"
+#include "table/index/tableIndexes.h"
 
 static void formatRecord(Record record, QueryAttributes attributes) {
     // Filters out fields that are not specified in Operation
@@ -60,14 +61,20 @@ QueryResult selectFrom(TableInfo tableInfo, Schema *schema, Condition cond,
 
     struct RecordIterator iterator;
     initialiseRecordIterator(&iterator);
+    restrictToIndexedPages(tableInfo->indexes, cond, &iterator);
 
+    ConditionPlan plan = compileCondition(cond, schema);
     bool canContinue = iterateRecords(tableInfo, &iterator, true);
 
     while (canContinue) {
-        Record record = parseRecord(iterator.page->ptr + iterator.lastSlot->offset, schema);
+        RecordView view = getRecordView(
+            iterator.page->ptr + iterator.lastSlot->offset, schema);
+
         // Selects record if there is either no condition or the condition
-        // evaluates to true
-        if (cond == NULL || evaluate(record, cond)) {
+        // evaluates to true, only then copying it out of the page
+        if (evaluate(plan, &view)) {
+            Record record = materialiseRecord(&view);
+
             // If attribute list is empty, then * was supplied so record does
             // not need to be formatted
             if (attributes->numAttributes > 0) {
@@ -75,14 +82,12 @@ QueryResult selectFrom(TableInfo tableInfo, Schema *schema, Condition cond,
             }
 
             addRecord(recordArray, record);
-        } else {
-            // Frees records that are not selected
-            freeRecord(record);
         }
 
         canContinue = iterateRecords(tableInfo, &iterator, true);
     }
 
+    freeConditionPlan(plan);
     freeRecordIterator(&iterator);
     return result;
 }
@@ -20,6 +20,8 @@
 
 #define CREATE_START "create"
 #define CREATE_END "table"
+#define CREATE_INDEX_END "index"
+#define ON "on"
 
 #define FROM "from"
 #define WHERE "where"
@@ -77,7 +79,7 @@ static bool isValidStrToken(const char *token) {
 static QueryAttributes parseSelectAttributes(char **cmd) {
     char *sql = *cmd;
 
-    QueryAttributes attrs = malloc(sizeof(QueryAttributes));
+    QueryAttributes attrs = malloc(sizeof(struct QueryAttributes));
     assert(attrs != NULL);
 
     attrs->numAttributes = 0;
@@ -398,91 +400,266 @@ static QueryTypeDescriptor getQueryType(char *cmd) {
     return descriptor;
 }
 
-static bool parseOneArg(Condition condition, Operand op, ConditionType type) {
-    condition->type = type;
-    condition->value.oneArg.op1 = op;
+static void freeOperand(Operand op) {
+    if (op == NULL) {
+        return;
+    }
 
-    return true;
+    if (op->type == STR || op->type == VARSTR || op->type == ATTR) {
+        free(op->value.strOp);
+    }
+    free(op);
 }
 
-static bool parseTwoArg(Condition condition, char **cmd, ConditionType type,
-                        Operand op1) {
-    condition->type = type;
-    condition->value.twoArg.op1 = op1;
-    condition->value.twoArg.op2 = getOperand(cmd, "; ");
+static void freeCondition(Condition condition) {
+    if (condition == NULL) {
+        return;
+    }
 
-    return true;
+    switch (condition->type) {
+        case AND:
+        case OR:
+            freeCondition(condition->value.binary.left);
+            freeCondition(condition->value.binary.right);
+            break;
+        case NOT:
+            freeOperand(condition->value.oneArg.op1);
+            freeCondition(condition->value.oneArg.child);
+            break;
+        case BETWEEN:
+            freeOperand(condition->value.between.op1);
+            freeOperand(condition->value.between.op2);
+            freeOperand(condition->value.between.op3);
+            break;
+        default:
+            freeOperand(condition->value.twoArg.op1);
+            freeOperand(condition->value.twoArg.op2);
+    }
+
+    free(condition);
 }
 
-static bool parseThreeArg(Condition condition, char **token, ConditionType type,
-                          Operand op1) {
-    condition->type = type;
-    condition->value.between.op1 = op1;
-    condition->value.between.op2 = getOperand(token, "; ");
+static char *padParentheses(char *sql) {
+    // Each parenthesis may need a space on either side
+    char *padded = malloc(3 * strlen(sql) + 1);
+    assert(padded != NULL);
 
-    // Enforces AND as separator for values of BETWEEN
-    ConditionType sepOperator = getOperator(token);
-    if (sepOperator != AND) {
-        free(condition->value.between.op2);
+    char *dest = padded;
+    char quote = '\0';
+
+    for (; *sql != '\0'; sql++) {
+        // Parentheses within string literals are left untouched
+        if (quote == '\0' && (*sql == '\"' || *sql == '\'')) {
+            quote = *sql;
+        } else if (*sql == quote) {
+            quote = '\0';
+        }
+
+        if (quote == '\0' && (*sql == '(' || *sql == ')')) {
+            *dest++ = ' ';
+            *dest++ = *sql;
+            *dest++ = ' ';
+        } else {
+            *dest++ = *sql;
+        }
+    }
+
+    *dest = '\0';
+    return padded;
+}
+
+static char *skipSpaces(char *sql) {
+    while (*sql == ' ') {
+        sql++;
+    }
+    return sql;
+}
+
+static bool peekToken(char *sql, char *token) {
+    sql = skipSpaces(sql);
+    size_t len = strlen(token);
+
+    return strncmp(sql, token, len) == 0 &&
+           (sql[len] == ' ' || sql[len] == ';' || sql[len] == '\0');
+}
+
+static bool parseToken(char **cmd, char *token) {
+    if (!peekToken(*cmd, token)) {
         return false;
     }
 
-    condition->value.between.op3 = getOperand(token, "; ");
+    *cmd = skipSpaces(*cmd) + strlen(token);
     return true;
 }
 
-static Condition parseCondition(char **cmd) {
-    Condition condition = malloc(sizeof(Condition));
-    assert(condition != NULL);
+static bool atConditionEnd(char *sql) {
+    sql = skipSpaces(sql);
+    return *sql == '\0' || *sql == ';' || peekToken(sql, ")") ||
+           peekToken(sql, AND_) || peekToken(sql, OR_);
+}
 
-    // Parses the first token manually to determine if it is an operator or
-    // operand
-    char *saveptr;
-    char *initial = strtok_r(*cmd, " ", &saveptr);
+static Condition parseComparison(char **cmd, Operand op1) {
+    // Left-hand side of a comparison must be an attribute
+    if (op1 == NULL || op1->type != ATTR) {
+        freeOperand(op1);
+        return NULL;
+    }
+
+    ConditionType type = getOperator(cmd);
 
-    if (initial == NULL) {
-        free(condition);
+    if (type == -1 || type == AND || type == OR || type == NOT) {
+        freeOperand(op1);
         return NULL;
     }
 
-    if (strcmp(initial, NOT_) == 0) {
-        Operand op1 = getOperand(&saveptr, "; ");
+    Condition condition = malloc(sizeof(struct Condition));
+    assert(condition != NULL);
 
-        if (op1 == NULL || saveptr[0] != '\0') {
-            free(condition);
-            free(op1);
+    condition->type = type;
+
+    if (type != BETWEEN) {
+        condition->value.twoArg.op1 = op1;
+        *cmd = skipSpaces(*cmd);
+        condition->value.twoArg.op2 = getOperand(cmd, "; ");
+
+        if (condition->value.twoArg.op2 == NULL) {
+            freeCondition(condition);
             return NULL;
         }
 
-        parseOneArg(condition, op1, NOT);
-        *cmd = saveptr;
         return condition;
     }
 
-    Operand op1 = getOperand(&initial, "; ");
-    *cmd = saveptr;
-    ConditionType type = getOperator(cmd);
+    condition->value.between.op1 = op1;
+    condition->value.between.op3 = NULL;
+    *cmd = skipSpaces(*cmd);
+    condition->value.between.op2 = getOperand(cmd, "; ");
 
-    if (type == -1) {
-        free(op1);
-        free(condition);
+    // Enforces AND as separator for values of BETWEEN
+    if (condition->value.between.op2 == NULL || !parseToken(cmd, AND_)) {
+        freeCondition(condition);
+        return NULL;
+    }
+
+    *cmd = skipSpaces(*cmd);
+    condition->value.between.op3 = getOperand(cmd, "; ");
+
+    if (condition->value.between.op3 == NULL) {
+        freeCondition(condition);
+        return NULL;
+    }
+
+    return condition;
+}
+
+static Condition parseLogical(char **cmd, ConditionType type, unsigned depth);
+
+static Condition parseUnary(char **cmd, unsigned depth) {
+    if (depth > MAX_CONDITION_DEPTH) {
         return NULL;
     }
 
-    if (type == BETWEEN) {
-        parseThreeArg(condition, cmd, BETWEEN, op1);
+    if (parseToken(cmd, "(")) {
+        Condition condition = parseLogical(cmd, OR, depth + 1);
+
+        if (condition == NULL || !parseToken(cmd, ")")) {
+            freeCondition(condition);
+            return NULL;
+        }
+
+        return condition;
+    }
+
+    if (!parseToken(cmd, NOT_)) {
+        *cmd = skipSpaces(*cmd);
+        return parseComparison(cmd, getOperand(cmd, "; "));
+    }
+
+    Condition condition = malloc(sizeof(struct Condition));
+    assert(condition != NULL);
+
+    condition->type = NOT;
+    condition->value.oneArg.op1 = NULL;
+    condition->value.oneArg.child = NULL;
+
+    if (peekToken(*cmd, "(") || peekToken(*cmd, NOT_)) {
+        condition->value.oneArg.child = parseUnary(cmd, depth + 1);
     } else {
-        parseTwoArg(condition, cmd, type, op1);
+        *cmd = skipSpaces(*cmd);
+        Operand op1 = getOperand(cmd, "; ");
+
+        // NOT applied directly to an attribute negates a boolean field
+        if (op1 != NULL && atConditionEnd(*cmd)) {
+            condition->value.oneArg.op1 = op1;
+            if (op1->type == ATTR) {
+                return condition;
+            }
+        } else {
+            condition->value.oneArg.child = parseComparison(cmd, op1);
+        }
     }
 
-    if (*cmd[0] != '\0' && *cmd[0] != ';') {
-        free(condition);
+    if (condition->value.oneArg.child == NULL) {
+        freeCondition(condition);
         return NULL;
     }
 
     return condition;
 }
 
+static Condition parseLogical(char **cmd, ConditionType type, unsigned depth) {
+    // Operands of OR are conjunctions, so that AND binds more tightly
+    Condition root = type == OR ? parseLogical(cmd, AND, depth)
+                                : parseUnary(cmd, depth);
+    if (root == NULL) {
+        return NULL;
+    }
+
+    // Chains are built leaning right, keeping the stack shallow when the tree
+    // is serialised
+    Condition *tail = &root;
+
+    while (parseToken(cmd, type == OR ? OR_ : AND_)) {
+        Condition right = type == OR ? parseLogical(cmd, AND, depth)
+                                     : parseUnary(cmd, depth);
+        if (right == NULL) {
+            freeCondition(root);
+            return NULL;
+        }
+
+        Condition node = malloc(sizeof(struct Condition));
+        assert(node != NULL);
+
+        node->type = type;
+        node->value.binary.left = *tail;
+        node->value.binary.right = right;
+
+        *tail = node;
+        tail = &node->value.binary.right;
+    }
+
+    return root;
+}
+
+static Condition parseCondition(char **cmd) {
+    // Parentheses are separated into their own tokens before parsing
+    char *padded = padParentheses(*cmd);
+    char *sql = padded;
+
+    Condition condition = parseLogical(&sql, OR, 0);
+
+    sql = skipSpaces(sql);
+    if (condition != NULL && *sql != '\0' && *sql != ';') {
+        freeCondition(condition);
+        condition = NULL;
+    }
+
+    free(padded);
+    *cmd += strlen(*cmd);
+
+    return condition;
+}
+
 static QueryAttributes createUpdateQueryAttributes(AttributeName *names,
                                                    unsigned size) {
     QueryAttributes attributes = malloc(sizeof(struct QueryAttributes));
@@ -867,6 +1044,58 @@ static Operation createCreateTable(char *sql) {
     return operation;
 }
 
+static char *parseSingleToken(char *sql) {
+    char *saveptr = NULL;
+    char *token = strtok_r(sql, " ", &saveptr);
+
+    if (token == NULL || !isValidStrToken(token) ||
+        strtok_r(NULL, " ", &saveptr) != NULL) {
+        return NULL;
+    }
+
+    return token;
+}
+
+static Operation createCreateIndex(char *sql) {
+    if (!parseKeyword(&sql, CREATE_INDEX_END) || !parseKeyword(&sql, ON)) {
+        return NULL;
+    }
+
+    // Expects table name followed by parenthesised attribute
+    char *listStart = strchr(sql, '(');
+    char *listEnd = strrchr(sql, ')');
+
+    if (listStart == NULL || listEnd == NULL || listEnd < listStart) {
+        return NULL;
+    }
+
+    char *rest = skipSpaces(listEnd + 1);
+    if (*rest == ';') {
+        rest = skipSpaces(rest + 1);
+    }
+    if (*rest != '\0') {
+        return NULL;
+    }
+
+    *listStart = '\0';
+    *listEnd = '\0';
+
+    char *tableName = parseSingleToken(sql);
+    char *attribute = parseSingleToken(listStart + 1);
+    if (tableName == NULL || attribute == NULL) {
+        return NULL;
+    }
+
+    Operation operation = malloc(sizeof(struct Operation));
+    assert(operation != NULL);
+
+    operation->queryType = CREATE_INDEX;
+    operation->tableName = strdup(tableName);
+    operation->query.createIndex.attribute = strdup(attribute);
+
+    return operation;
+}
+
 Operation sqlToOperation(char *sql) {
     char *saveToken;
     char *token = strtok_r(sql, " ", &saveToken);
@@ -888,6 +1117,9 @@ Operation sqlToOperation(char *sql) {
     }
 
     if (strcmp(token, CREATE_START) == 0) {
+        if (peekToken(saveToken, CREATE_INDEX_END)) {
+            return createCreateIndex(saveToken);
+        }
         return createCreateTable(saveToken);
     }
 
@@ -12,6 +12,7 @@
 #include "log.h"
 #include "operation.h"
 #include "table/core/recordArray.h"
+#include "table/index/tableIndexes.h"
 
 static void updateField(Field *field, Operand op) {
     switch (field->type) {
@@ -38,7 +39,7 @@ static void updateField(Field *field, Operand op) {
     }
 }
 
-static void updateRecord(Record record, Page page,
+static void updateRecord(TableInfo tableInfo, Record record, Page page,
                          QueryAttributes queryAttributes,
                          QueryValues queryValues, RecordIterator iterator,
                          RecordArray buffer) {
@@ -78,18 +79,36 @@ static void updateRecord(Record record, Page page,
 
     if (record->size > oldSize) {
         // Record cannot fit in old position so needs to be removed
-        removeRecord(page, iterator->lastSlot, record->size);
+        removeRecord(page, iterator->lastSlot, oldSize);
         addRecord(buffer, record);
         return;
     }
 
     uint8_t *recordPtr = page->ptr + iterator->lastSlot->offset;
+    beginPageUpdate(page);
     writeRecord(recordPtr, record);
+    RecordId rid = {.pageId = page->pageId, .slotIdx = iterator->slotIdx - 1};
+    indexRecord(tableInfo->indexes, recordPtr, rid);
 
     // Record takes up less space than before so page needs to be defragmented
     if (record->size < oldSize) {
         iterator->lastSlot->size = record->size;
     }
+
+    freeRecord(record);
+}
+
+static bool atEndOfPage(RecordIterator iterator) {
+    PageHeader header = iterator->page->header;
+
+    // Trailing empty slots are skipped by the iterator
+    for (unsigned i = iterator->slotIdx; i < header->slots.size; i++) {
+        if (header->slots.slots[i].size != 0) {
+            return false;
+        }
+    }
+
+    return true;
 }
 
 void updateTable(TableInfo tableInfo, TableInfo spaceMap,
@@ -97,23 +116,30 @@ void updateTable(TableInfo tableInfo, TableInfo spaceMap,
                  Condition cond, Schema *schema) {
     struct RecordIterator iterator;
     initialiseRecordIterator(&iterator);
+    restrictToIndexedPages(tableInfo->indexes, cond, &iterator);
+
+    ConditionPlan plan = compileCondition(cond, schema);
 
     // Iterates through records, updating those that satisfy condition
     bool canContinue = iterateRecords(tableInfo, &iterator, true);
     RecordArray recordBuffer = createRecordArray();
 
     while (canContinue) {
-        Record record =
-            parseRecord(iterator.page->ptr + iterator.lastSlot->offset, schema);
+        RecordView view = getRecordView(
+            iterator.page->ptr + iterator.lastSlot->offset, schema);
 
         // Updates record that satisfies condition
-        if (evaluate(record, cond)) {
-            updateRecord(record, iterator.page, queryAttributes, queryValues,
-                         &iterator, recordBuffer);
+        if (evaluate(plan, &view)) {
+            // Keys are added back once the record is rewritten or relocated
+            unindexRecord(tableInfo->indexes, &view);
+
+            Record record = materialiseRecord(&view);
+            updateRecord(tableInfo, record, iterator.page, queryAttributes,
+                         queryValues, &iterator, recordBuffer);
         }
 
         Page oldPage = iterator.page;
-        if (iterator.slotIdx == oldPage->header->slots.size) {
+        if (atEndOfPage(&iterator)) {
             // Defragments page to remove extra space
             defragmentRecords(oldPage);
             updatePage(tableInfo, oldPage);
@@ -136,6 +162,7 @@ void updateTable(TableInfo tableInfo, TableInfo spaceMap,
         canContinue = iterateRecords(tableInfo, &iterator, true);
     }
 
+    freeConditionPlan(plan);
     freeRecordIterator(&iterator);
 }
 
@@ -0,0 +1,87 @@
+#include "bulkLoadIndex.h"
+
+#include "table/index/b+-tree.h"
+#include "test-library.h"
+
+// Spans two sorted runs, so that the build merges run files
+#define NUM_KEYS 300000
+
+static bool checkOrder(Index index, unsigned *count) {
+    IndexIterator iterator = openIndexIterator(index, NULL, NULL);
+    bool ordered = true;
+    int prev = -1;
+    *count = 0;
+
+    KeyId key;
+    RecordId rid;
+    while (nextIndexEntry(iterator, &key, &rid)) {
+        int value = *(int *)key.secKey.key;
+        if (value <= prev || rid.pageId != value / 10 ||
+            rid.slotIdx != value % 10 || key.secKey.id != value) {
+            ordered = false;
+        }
+        prev = value;
+        (*count)++;
+    }
+
+    closeIndexIterator(iterator);
+    return ordered;
+}
+
+static bool lookup(Index index, int value) {
+    KeyId bound = {.secKey = {.key = &value, .id = 0}};
+    IndexIterator iterator = openIndexIterator(index, &bound, &bound);
+
+    KeyId key;
+    RecordId rid;
+    bool found = nextIndexEntry(iterator, &key, &rid) &&
+                 *(int *)key.secKey.key == value;
+
+    closeIndexIterator(iterator);
+    return found;
+}
+
+void testBulkLoadIndex() {
+    createBIndex(8, "code", INT_KEY);
+    Index index = openIndex("code");
+
+    // Adds keys in a scattered order, as a table scan would
+    IndexBuilder builder = openIndexBuilder(index, 0.75);
+    for (int i = 0; i < NUM_KEYS; i++) {
+        int value = (int)(((long)i * 7919) % NUM_KEYS);
+        KeyId id = {.secKey = {.key = &value, .id = value}};
+        RecordId rid = {.pageId = value / 10, .slotIdx = value % 10};
+        addToIndexBuilder(builder, &id, rid);
+    }
+    finishIndexBuilder(builder);
+
+    closeIndex(index);
+    index = openIndex("code");
+
+    START_OUTER_TEST("Test bottom-up bulk build of an index")
+    unsigned count;
+    ASSERT_EQ(checkOrder(index, &count), true)
+    ASSERT_EQ(count, NUM_KEYS)
+
+    // Leaves are filled to three quarters of 2d - 1 keys
+    unsigned leafKeys = (getD(index) * 2 - 1) * 3 / 4;
+    unsigned numLeaves = (NUM_KEYS + leafKeys - 1) / leafKeys;
+    TEST(getNumPages(index) < numLeaves + numLeaves / 100 + 4)
+
+    ASSERT_EQ(lookup(index, 0), true)
+    ASSERT_EQ(lookup(index, NUM_KEYS / 2), true)
+    ASSERT_EQ(lookup(index, NUM_KEYS - 1), true)
+    ASSERT_EQ(lookup(index, NUM_KEYS), false)
+
+    // Nodes left with free space take later insertions
+    for (int i = NUM_KEYS; i < NUM_KEYS + 1000; i++) {
+        KeyId id = {.secKey = {.key = &i, .id = i}};
+        addKeyToIndex(index, &id, (RecordId){.pageId = i / 10, .slotIdx = i % 10});
+    }
+    ASSERT_EQ(checkOrder(index, &count), true)
+    ASSERT_EQ(count, NUM_KEYS + 1000)
+    ASSERT_EQ(lookup(index, NUM_KEYS + 500), true)
+    FINISH_OUTER_TEST
+    PRINT_SUMMARY
+    closeIndex(index);
+}
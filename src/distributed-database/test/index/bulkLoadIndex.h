@@ -0,0 +1,6 @@
+#ifndef BULKLOADINDEX_H
+#define BULKLOADINDEX_H
+
+void testBulkLoadIndex();
+
+#endif //BULKLOADINDEX_H
@@ -0,0 +1,115 @@
+#include "concurrentIndexAccess.h"
+
+#include <pthread.h>
+
+#include "table/index/b+-tree.h"
+#include "test-library.h"
+
+#define NUM_KEYS 20000
+#define NUM_READERS 4
+#define NUM_LOOKUPS 20000
+
+typedef struct {
+    Index index;
+    unsigned missed;
+} ReaderArgs;
+
+static bool lookup(Index index, int value) {
+    KeyId lower = {.secKey = {.key = &value, .id = 0}};
+    KeyId upper = {.secKey = {.key = &value, .id = 0}};
+    IndexIterator iterator = openIndexIterator(index, &lower, &upper);
+
+    KeyId key;
+    RecordId rid;
+    bool found = nextIndexEntry(iterator, &key, &rid) &&
+                 *(int *)key.secKey.key == value && rid.pageId == value;
+
+    closeIndexIterator(iterator);
+    return found;
+}
+
+static void *readKeys(void *arg) {
+    ReaderArgs *args = arg;
+
+    // Even keys are never removed, so every lookup must find them
+    for (int i = 0; i < NUM_LOOKUPS; i++) {
+        int value = (int)(((long)i * 7919) % NUM_KEYS) & ~1;
+        if (!lookup(args->index, value)) {
+            args->missed++;
+        }
+    }
+
+    return NULL;
+}
+
+static void addKey(Index index, int value) {
+    KeyId key = {.secKey = {.key = &value, .id = value}};
+    addKeyToIndex(index, &key, (RecordId){.pageId = value});
+}
+
+static void removeKey(Index index, int value) {
+    KeyId key = {.secKey = {.key = &value, .id = value}};
+    removeKeyFromIndex(index, &key);
+}
+
+static bool checkOrder(Index index, unsigned *count) {
+    IndexIterator iterator = openIndexIterator(index, NULL, NULL);
+    bool ordered = true;
+    int prev = -1;
+    *count = 0;
+
+    KeyId key;
+    RecordId rid;
+    while (nextIndexEntry(iterator, &key, &rid)) {
+        int value = *(int *)key.secKey.key;
+        if (value <= prev || value % 2 != 0) {
+            ordered = false;
+        }
+        prev = value;
+        (*count)++;
+    }
+
+    closeIndexIterator(iterator);
+    return ordered;
+}
+
+void testConcurrentIndexAccess() {
+    createBIndex(8, "code", INT_KEY);
+    Index index = openIndex("code");
+
+    for (int i = 0; i < NUM_KEYS; i += 2) {
+        addKey(index, i);
+    }
+
+    ReaderArgs args[NUM_READERS];
+    pthread_t readers[NUM_READERS];
+    for (int i = 0; i < NUM_READERS; i++) {
+        args[i] = (ReaderArgs){.index = index, .missed = 0};
+        pthread_create(&readers[i], NULL, readKeys, &args[i]);
+    }
+
+    // Odd keys split and merge nodes under the readers
+    for (int i = 1; i < NUM_KEYS; i += 2) {
+        addKey(index, i);
+    }
+    for (int i = 1; i < NUM_KEYS; i += 2) {
+        removeKey(index, i);
+    }
+
+    unsigned missed = 0;
+    for (int i = 0; i < NUM_READERS; i++) {
+        pthread_join(readers[i], NULL);
+        missed += args[i].missed;
+    }
+
+    START_OUTER_TEST("Test index lookups during concurrent updates")
+    ASSERT_EQ(missed, 0)
+    unsigned count;
+    ASSERT_EQ(checkOrder(index, &count), true)
+    ASSERT_EQ(count, NUM_KEYS / 2)
+    ASSERT_EQ(lookup(index, NUM_KEYS - 2), true)
+    ASSERT_EQ(lookup(index, 1), false)
+    FINISH_OUTER_TEST
+    PRINT_SUMMARY
+    closeIndex(index);
+}
@@ -0,0 +1,6 @@
+#ifndef CONCURRENTINDEXACCESS_H
+#define CONCURRENTINDEXACCESS_H
+
+void testConcurrentIndexAccess();
+
+#endif //CONCURRENTINDEXACCESS_H
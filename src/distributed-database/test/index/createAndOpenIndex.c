@@ -8,7 +8,7 @@ void testCreateAndOpenIndex() {
     Index index = openIndex("code");
 
     START_OUTER_TEST("Test creation and opening of index")
-    ASSERT_EQ(getD(index), 341)
+    ASSERT_EQ(getD(index), 203)
     ASSERT_EQ(getRootId(index), 0)
     ASSERT_EQ(getKeySize(index), 4)
     FINISH_OUTER_TEST
@@ -0,0 +1,116 @@
+#include "deleteFromIndex.h"
+
+#include "table/index/b+-tree.h"
+#include "test-library.h"
+
+#define NUM_KEYS 20000
+
+// Checks that non-root nodes hold at least d - 1 keys and that all leaves
+// are at the same depth
+static bool checkNode(Index index, uint32_t id, unsigned depth,
+                      int *leafDepth) {
+    Node node = getNode(index, id);
+    bool valid = id == getRootId(index) || node->numKeys >= getD(index) - 1;
+
+    if (node->type == LEAF) {
+        if (*leafDepth < 0) {
+            *leafDepth = depth;
+        }
+        valid &= *leafDepth == depth;
+    } else {
+        for (unsigned i = 0; i <= node->numKeys && valid; i++) {
+            valid &= checkNode(index, getKeyChild(index, node, i), depth + 1,
+                               leafDepth);
+        }
+    }
+
+    closeNode(index, node);
+    return valid;
+}
+
+static unsigned countKeys(Index index, bool *ordered) {
+    IndexIterator iterator = openIndexIterator(index, NULL, NULL);
+    unsigned count = 0;
+    int prev = -1;
+    *ordered = true;
+
+    KeyId key;
+    RecordId rid;
+    while (nextIndexEntry(iterator, &key, &rid)) {
+        int value = *(int *)key.secKey.key;
+        *ordered &= value > prev && rid.pageId == value;
+        prev = value;
+        count++;
+    }
+
+    closeIndexIterator(iterator);
+    return count;
+}
+
+static void addKey(Index index, int value) {
+    KeyId id = {.secKey = {.key = &value, .id = value}};
+    addKeyToIndex(index, &id, (RecordId){.pageId = value});
+}
+
+static bool removeKey(Index index, int value) {
+    KeyId id = {.secKey = {.key = &value, .id = value}};
+    return removeKeyFromIndex(index, &id);
+}
+
+void testDeleteFromIndex() {
+    createBIndex(8, "code", INT_KEY);
+    Index index = openIndex("code");
+
+    for (int i = 0; i < NUM_KEYS; i++) {
+        addKey(index, (int)(((long)i * 7919) % NUM_KEYS));
+    }
+    unsigned fullPages = getNumPages(index);
+
+    START_OUTER_TEST("Test deletion of keys with borrowing and merging")
+    bool ordered;
+    int leafDepth = -1;
+
+    // Removes odd keys from the front half and every key from the back half
+    bool removed = true;
+    for (int i = 0; i < NUM_KEYS; i++) {
+        if (i >= NUM_KEYS / 2 || i % 2 == 1) {
+            removed &= removeKey(index, i);
+        }
+    }
+    ASSERT_EQ(removed, true)
+    ASSERT_EQ(removeKey(index, 1), false)
+    ASSERT_EQ(countKeys(index, &ordered), NUM_KEYS / 4)
+    ASSERT_EQ(ordered, true)
+    ASSERT_EQ(checkNode(index, getRootId(index), 0, &leafDepth), true)
+
+    // Reinserted keys reuse the pages freed by merges
+    for (int i = NUM_KEYS / 2; i < NUM_KEYS; i++) {
+        addKey(index, i);
+    }
+    TEST(getNumPages(index) <= fullPages)
+
+    // Emptying the tree frees every node, including the root
+    for (int i = 0; i < NUM_KEYS; i++) {
+        if (i >= NUM_KEYS / 2 || i % 2 == 0) {
+            removeKey(index, i);
+        }
+    }
+    ASSERT_EQ(countKeys(index, &ordered), 0)
+    ASSERT_EQ(getRootId(index), 0)
+
+    // Free list survives reopening the index
+    unsigned numPages = getNumPages(index);
+    closeIndex(index);
+    index = openIndex("code");
+    for (int i = 0; i < NUM_KEYS / 2; i++) {
+        addKey(index, (int)(((long)i * 7919) % NUM_KEYS));
+    }
+    leafDepth = -1;
+    ASSERT_EQ(getNumPages(index), numPages)
+    ASSERT_EQ(countKeys(index, &ordered), NUM_KEYS / 2)
+    ASSERT_EQ(ordered, true)
+    ASSERT_EQ(checkNode(index, getRootId(index), 0, &leafDepth), true)
+    FINISH_OUTER_TEST
+    PRINT_SUMMARY
+    closeIndex(index);
+}
@@ -0,0 +1,6 @@
+#ifndef DELETEFROMINDEX_H
+#define DELETEFROMINDEX_H
+
+void testDeleteFromIndex();
+
+#endif //DELETEFROMINDEX_H
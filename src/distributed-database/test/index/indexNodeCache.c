@@ -0,0 +1,52 @@
+#include "indexNodeCache.h"
+
+#include "table/index/b+-tree.h"
+#include "test-library.h"
+
+#define NUM_KEYS 30000
+#define NUM_LOOKUPS 200
+
+static bool lookup(Index index, int value) {
+    KeyId lower = {.secKey = {.key = &value, .id = 0}};
+    KeyId upper = {.secKey = {.key = &value, .id = 0}};
+    IndexIterator iterator = openIndexIterator(index, &lower, &upper);
+
+    KeyId key;
+    RecordId rid;
+    bool found = nextIndexEntry(iterator, &key, &rid) &&
+                 *(int *)key.secKey.key == value && rid.pageId == value % 1000;
+
+    closeIndexIterator(iterator);
+    return found;
+}
+
+void testIndexNodeCache() {
+    createBIndex(8, "code", INT_KEY);
+    Index index = openIndex("code");
+
+    for (int i = 0; i < NUM_KEYS; i++) {
+        KeyId id = {.secKey = {.key = &i, .id = i}};
+        addKeyToIndex(index, &id, (RecordId){.pageId = i % 1000});
+    }
+
+    // Reopens index so that lookups start from a cold cache
+    closeIndex(index);
+    index = openIndex("code");
+    lookup(index, 0);
+
+    IndexCacheStats before = getIndexCacheStats(index);
+    unsigned found = 0;
+    for (int i = 0; i < NUM_LOOKUPS; i++) {
+        found += lookup(index, (i * 7919) % NUM_KEYS);
+    }
+    IndexCacheStats after = getIndexCacheStats(index);
+
+    START_OUTER_TEST("Test node cache keeps upper levels of the index resident")
+    ASSERT_EQ(found, NUM_LOOKUPS)
+    TEST(after.misses - before.misses <= NUM_LOOKUPS)
+    TEST(after.hits - before.hits >= NUM_LOOKUPS)
+    TEST(after.evictions > 0)
+    FINISH_OUTER_TEST
+    PRINT_SUMMARY
+    closeIndex(index);
+}
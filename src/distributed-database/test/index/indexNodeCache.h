@@ -0,0 +1,6 @@
+#ifndef INDEXNODECACHE_H
+#define INDEXNODECACHE_H
+
+void testIndexNodeCache();
+
+#endif //INDEXNODECACHE_H
@@ -11,7 +11,8 @@ void testInsertToRoot() {
 
     for (int i = 0; i < 100; i++) {
         KeyId key = {.secKey = {.key = &i, .id = 30 + i}};
-        addKeyToIndex(index, &key, 50 + i);
+        RecordId rid = {.pageId = UINT16_MAX + i, .slotIdx = 50 + i};
+        addKeyToIndex(index, &key, rid);
     }
 
     closeIndex(index);
@@ -23,14 +24,15 @@ void testInsertToRoot() {
     ASSERT_EQ(node->numKeys, 100)
     ASSERT_EQ(node->type, LEAF)
     ASSERT_EQ(node->parent, 0)
-    ASSERT_EQ(node->keyType, INT)
+    ASSERT_EQ(node->keyType, INT_KEY)
     for (int i = 0; i < 100; i++) {
         KeyId keyId;
         getInternalKey(index, node, i, &keyId);
-        unsigned offset = getKeyChild(index, node, i);
+        RecordId rid = getKeyRecord(index, node, i);
         ASSERT_EQ(*(int *)keyId.secKey.key, i);
         ASSERT_EQ(keyId.secKey.id, 30 + i);
-        ASSERT_EQ(offset, 50 + i)
+        ASSERT_EQ(rid.pageId, UINT16_MAX + i)
+        ASSERT_EQ(rid.slotIdx, 50 + i)
     }
     FINISH_OUTER_TEST
     PRINT_SUMMARY
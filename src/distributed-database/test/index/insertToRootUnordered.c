@@ -10,11 +10,11 @@ void testInsertToRootUnordered() {
 
     for (int i = 0; i < 100; i += 2) {
         KeyId id = {.secKey = {.key = &i, .id = 50 + i}};
-        addKeyToIndex(index, &id, 30 + i);
+        addKeyToIndex(index, &id, (RecordId){.pageId = 30 + i});
     }
     for (int i = 1; i < 100; i += 2) {
         KeyId id = {.secKey = {.key = &i, .id = 50 + i}};
-        addKeyToIndex(index, &id, 30 + i);
+        addKeyToIndex(index, &id, (RecordId){.pageId = 30 + i});
     }
 
     closeIndex(index);
@@ -27,12 +27,12 @@ void testInsertToRootUnordered() {
     ASSERT_EQ(node->numKeys, 100)
     ASSERT_EQ(node->type, LEAF)
     ASSERT_EQ(node->parent, 0)
-    ASSERT_EQ(node->keyType, INT)
+    ASSERT_EQ(node->keyType, INT_KEY)
 
     for (int i = 0; i < 100; i++) {
         KeyId id;
         getInternalKey(index, node, i, &id);
-        unsigned offset = getKeyChild(index, node, i);
+        unsigned offset = getKeyRecord(index, node, i).pageId;
         ASSERT_EQ(*(int *)id.secKey.key, i);
         ASSERT_EQ(id.secKey.id, 50 + i)
         ASSERT_EQ(offset, 30 + i)
@@ -7,9 +7,10 @@ void testInsertWithOverflow() {
     createBIndex(8, "code", INT_KEY);
     Index index = openIndex("code");
 
-    for (int i = 0; i < 700; i++) {
+    // Fills three leaves at the fanout of 8-byte keys
+    for (int i = 0; i < 500; i++) {
         KeyId id = {.secKey = {.key = &i, .id = 50 + i}};
-        addKeyToIndex(index, &id, 30 + i);
+        addKeyToIndex(index, &id, (RecordId){.pageId = 30 + i});
     }
 
     closeIndex(index);
@@ -29,7 +30,7 @@ void testInsertWithOverflow() {
         ASSERT_EQ(node->type, LEAF)
         closeNode(index, node);
     }
-    ASSERT_EQ(leafKeys, 700)
+    ASSERT_EQ(leafKeys, 500)
     FINISH_OUTER_TEST
     PRINT_SUMMARY
 }
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "iterateIndexRange.h"
+
+#include "table/index/b+-tree.h"
+#include "test-library.h"
+
+static unsigned countRange(Index index, KeyId *lower, KeyId *upper,
+                           int *first, int *last, bool *ordered) {
+    IndexIterator iterator = openIndexIterator(index, lower, upper);
+    unsigned count = 0;
+    int prev = -1;
+    *ordered = true;
+
+    KeyId key;
+    RecordId rid;
+    while (nextIndexEntry(iterator, &key, &rid)) {
+        int keyValue = *(int *)key.secKey.key;
+        if (keyValue <= prev || rid.pageId != keyValue + 30) {
+            *ordered = false;
+        }
+        if (count == 0) {
+            *first = keyValue;
+        }
+        *last = keyValue;
+        prev = keyValue;
+        count++;
+    }
+
+    closeIndexIterator(iterator);
+    return count;
+}
+
+void testIterateIndexRange() {
+    createBIndex(8, "code", INT_KEY);
+    Index index = openIndex("code");
+
+    // Inserts keys out of order so that the leaf chain spans several splits
+    for (int i = 0; i < 2000; i += 2) {
+        KeyId id = {.secKey = {.key = &i, .id = i}};
+        addKeyToIndex(index, &id, (RecordId){.pageId = 30 + i});
+    }
+    for (int i = 1999; i > 0; i -= 2) {
+        KeyId id = {.secKey = {.key = &i, .id = i}};
+        addKeyToIndex(index, &id, (RecordId){.pageId = 30 + i});
+    }
+
+    int lowerValue = 250;
+    int upperValue = 1450;
+    KeyId lower = {.secKey = {.key = &lowerValue, .id = 0}};
+    KeyId upper = {.secKey = {.key = &upperValue, .id = 0}};
+
+    int first, last;
+    bool ordered;
+
+    START_OUTER_TEST("Test iteration over key ranges along the leaf chain")
+    ASSERT_EQ(countRange(index, &lower, &upper, &first, &last, &ordered), 1201)
+    ASSERT_EQ(first, 250)
+    ASSERT_EQ(last, 1450)
+    ASSERT_EQ(ordered, true)
+    ASSERT_EQ(countRange(index, NULL, &upper, &first, &last, &ordered), 1451)
+    ASSERT_EQ(first, 0)
+    ASSERT_EQ(countRange(index, &lower, NULL, &first, &last, &ordered), 1750)
+    ASSERT_EQ(last, 1999)
+    ASSERT_EQ(ordered, true)
+    ASSERT_EQ(countRange(index, &upper, &lower, &first, &last, &ordered), 0)
+    FINISH_OUTER_TEST
+    PRINT_SUMMARY
+    closeIndex(index);
+}
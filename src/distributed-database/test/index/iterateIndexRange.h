@@ -0,0 +1,6 @@
+#ifndef ITERATEINDEXRANGE_H
+#define ITERATEINDEXRANGE_H
+
+void testIterateIndexRange();
+
+#endif //ITERATEINDEXRANGE_H
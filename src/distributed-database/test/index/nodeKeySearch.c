@@ -0,0 +1,106 @@
+#include "nodeKeySearch.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "table/index/b+-tree.h"
+#include "table/index/keySearch.h"
+#include "test-library.h"
+
+#define NUM_KEYS 289
+
+static const KeySearchMode modes[] = {KEY_SEARCH_GENERIC, KEY_SEARCH_SCALAR,
+                                      KEY_SEARCH_SSE2, KEY_SEARCH_AVX2};
+static const char *modeNames[] = {"generic", "scalar", "sse2", "avx2"};
+
+static unsigned countMismatches(void) {
+    // Padded as a node page is, so that vector loads past the keys are safe
+    uint8_t intKeys[_PAGE_SIZE] = {0};
+    uint8_t idKeys[_PAGE_SIZE] = {0};
+
+    // Values repeat with ascending global indexes, and include negatives
+    for (int i = 0; i < NUM_KEYS; i++) {
+        int32_t key[2] = {i / 3 * 2 - 100, i};
+        memcpy(intKeys + sizeof(key) * i, key, sizeof(key));
+
+        int32_t id = i * 2 - 100;
+        memcpy(idKeys + sizeof(id) * i, &id, sizeof(id));
+    }
+
+    unsigned mismatches = 0;
+    for (int n = 0; n <= NUM_KEYS; n += 17) {
+        for (int value = -110; value < NUM_KEYS - 80; value++) {
+            for (int id = -1; id <= NUM_KEYS; id += 7) {
+                int expected = 0;
+                while (expected < n) {
+                    int32_t key[2];
+                    memcpy(key, intKeys + sizeof(key) * expected, sizeof(key));
+                    if (key[0] > value || (key[0] == value && key[1] >= id)) {
+                        break;
+                    }
+                    expected++;
+                }
+                mismatches += searchIntKeys(intKeys, n, value, id) != expected;
+            }
+
+            int expected = 0;
+            while (expected < n && expected * 2 - 100 < value) {
+                expected++;
+            }
+            mismatches += searchIdKeys(idKeys, n, value) != expected;
+        }
+    }
+
+    return mismatches;
+}
+
+static unsigned countNodeMismatches(Index index, Node node) {
+    unsigned mismatches = 0;
+
+    // Leaf holds key i with global index i, so each key is found at its value
+    for (uint32_t i = 0; i <= node->numKeys; i++) {
+        int32_t value = (int32_t)i;
+        KeyId key = {.secKey = {.key = &value, .id = i}};
+        mismatches += searchKey(index, node, &key) != i;
+    }
+
+    return mismatches;
+}
+
+void testNodeKeySearch() {
+    KeySearchMode previous = getKeySearchMode();
+    createBIndex(8, "code", INT_KEY);
+    Index index = openIndex("code");
+
+    // Fills a single 4 KB leaf
+    unsigned numKeys = getD(index) * 2 - 1;
+    for (int i = 0; i < numKeys; i++) {
+        KeyId id = {.secKey = {.key = &i, .id = i}};
+        addKeyToIndex(index, &id, (RecordId){.pageId = i});
+    }
+
+    START_OUTER_TEST("Test vectorised search of integer keys in nodes")
+    Node node = getNode(index, getRootId(index));
+    ASSERT_EQ(node->type, LEAF)
+    ASSERT_EQ(node->numKeys, numKeys)
+
+    for (int i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        setKeySearchMode(modes[i]);
+
+        // Unsupported modes fall back to the best available
+        if (getKeySearchMode() != modes[i]) {
+            printf("%s search is not supported\n", modeNames[i]);
+            continue;
+        }
+
+        ASSERT_EQ(countMismatches(), 0)
+        ASSERT_EQ(countNodeMismatches(index, node), 0)
+    }
+
+    closeNode(index, node);
+    FINISH_OUTER_TEST
+    PRINT_SUMMARY
+
+    setKeySearchMode(previous);
+    closeIndex(index);
+}
@@ -0,0 +1,6 @@
+#ifndef NODEKEYSEARCH_H
+#define NODEKEYSEARCH_H
+
+void testNodeKeySearch();
+
+#endif //NODEKEYSEARCH_H
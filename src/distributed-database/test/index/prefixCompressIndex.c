@@ -0,0 +1,145 @@
+#include "prefixCompressIndex.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "table/index/b+-tree.h"
+#include "test-library.h"
+
+#define NUM_KEYS 20000
+
+// Width of a VARSTR(255) key with its terminator and global index
+#define KEY_WIDTH 260
+
+// Keys of a fixed-width node of that width, as held before front coding
+#define FIXED_NODE_KEYS 13
+
+static void getKey(int value, char *dest) {
+    snprintf(dest, KEY_WIDTH, "customer/%06d/orders", value);
+}
+
+static unsigned getHeight(Index index) {
+    Node node = getNode(index, getRootId(index));
+    unsigned height = 1;
+
+    while (node->type != LEAF) {
+        uint32_t childId = getKeyChild(index, node, 0);
+        closeNode(index, node);
+        node = getNode(index, childId);
+        height++;
+    }
+
+    closeNode(index, node);
+    return height;
+}
+
+static bool checkOrder(Index index, unsigned *count) {
+    IndexIterator iterator = openIndexIterator(index, NULL, NULL);
+    bool ordered = true;
+    char prev[KEY_WIDTH] = "";
+    *count = 0;
+
+    KeyId key;
+    RecordId rid;
+    while (nextIndexEntry(iterator, &key, &rid)) {
+        char expected[KEY_WIDTH];
+        getKey(key.secKey.id, expected);
+
+        if (strcmp(prev, key.secKey.key) >= 0 ||
+            strcmp(expected, key.secKey.key) != 0 ||
+            rid.pageId != key.secKey.id) {
+            ordered = false;
+        }
+
+        strcpy(prev, key.secKey.key);
+        (*count)++;
+    }
+
+    closeIndexIterator(iterator);
+    return ordered;
+}
+
+static bool lookup(Index index, int value) {
+    char str[KEY_WIDTH];
+    getKey(value, str);
+    KeyId bound = {.secKey = {.key = str, .id = 0}};
+    IndexIterator iterator = openIndexIterator(index, &bound, &bound);
+
+    KeyId key;
+    RecordId rid;
+    bool found = nextIndexEntry(iterator, &key, &rid) &&
+                 key.secKey.id == value && rid.pageId == value;
+
+    closeIndexIterator(iterator);
+    return found;
+}
+
+static KeyId makeKey(int value, char *buf) {
+    getKey(value, buf);
+    return (KeyId){.secKey = {.key = buf, .id = value}};
+}
+
+void testPrefixCompressIndex() {
+    createBIndex(KEY_WIDTH, "email", STR_KEY);
+    Index index = openIndex("email");
+
+    for (int i = 0; i < NUM_KEYS; i++) {
+        int value = (int)(((long)i * 7919) % NUM_KEYS);
+        char buf[KEY_WIDTH];
+        KeyId key = makeKey(value, buf);
+        addKeyToIndex(index, &key, (RecordId){.pageId = value});
+    }
+
+    // Reopening decodes every node from its front-coded page
+    closeIndex(index);
+    index = openIndex("email");
+
+    START_OUTER_TEST("Test front coding of string index nodes")
+    unsigned count;
+    ASSERT_EQ(checkOrder(index, &count), true)
+    ASSERT_EQ(count, NUM_KEYS)
+    ASSERT_EQ(lookup(index, 0), true)
+    ASSERT_EQ(lookup(index, NUM_KEYS - 1), true)
+    ASSERT_EQ(lookup(index, NUM_KEYS), false)
+
+    // Pages hold ten times the keys of fixed-width nodes, which would need
+    // five levels for as many keys
+    TEST(NUM_KEYS / getNumPages(index) >= FIXED_NODE_KEYS * 10)
+    TEST(getHeight(index) <= 3)
+
+    // Deleting merges nodes without losing the keys left
+    for (int i = 0; i < NUM_KEYS; i++) {
+        if (i % 4 != 0) {
+            char buf[KEY_WIDTH];
+            KeyId key = makeKey(i, buf);
+            removeKeyFromIndex(index, &key);
+        }
+    }
+    ASSERT_EQ(checkOrder(index, &count), true)
+    ASSERT_EQ(count, NUM_KEYS / 4)
+    ASSERT_EQ(lookup(index, 4), true)
+    ASSERT_EQ(lookup(index, 5), false)
+    FINISH_OUTER_TEST
+    closeIndex(index);
+
+    // Bulk builds pack pages by their encoded size
+    createBIndex(KEY_WIDTH, "email", STR_KEY);
+    index = openIndex("email");
+
+    IndexBuilder builder = openIndexBuilder(index, 0.9);
+    for (int i = 0; i < NUM_KEYS; i++) {
+        char buf[KEY_WIDTH];
+        KeyId key = makeKey(i, buf);
+        addToIndexBuilder(builder, &key, (RecordId){.pageId = i});
+    }
+    finishIndexBuilder(builder);
+
+    START_OUTER_TEST("Test bulk build of a front-coded string index")
+    ASSERT_EQ(checkOrder(index, &count), true)
+    ASSERT_EQ(count, NUM_KEYS)
+    ASSERT_EQ(lookup(index, NUM_KEYS / 2), true)
+    ASSERT_EQ(getHeight(index), 2)
+    FINISH_OUTER_TEST
+    PRINT_SUMMARY
+    closeIndex(index);
+}
@@ -0,0 +1,6 @@
+#ifndef PREFIXCOMPRESSINDEX_H
+#define PREFIXCOMPRESSINDEX_H
+
+void testPrefixCompressIndex();
+
+#endif //PREFIXCOMPRESSINDEX_H
@@ -0,0 +1,78 @@
+#include "concurrentSelect.h"
+
+#include <pthread.h>
+#include <stdio.h>
+
+#include "table/catalog.h"
+#include "table/core/recordArray.h"
+#include "table/operations/operation.h"
+#include "table/operations/sqlToOperation.h"
+#include "test-library.h"
+
+#define NUM_ROWS 1000
+#define NUM_READERS 4
+#define NUM_QUERIES 200
+
+static size_t countQuery(char *query) {
+    char sql[200];
+    snprintf(sql, sizeof(sql), "%s", query);
+    return executeOperation(sqlToOperation(sql))->records->size;
+}
+
+static void *runQueries(void *arg) {
+    unsigned *wrong = arg;
+
+    // Index lookups and full scans of tables opened by whichever reader
+    // reaches them first
+    for (int i = 0; i < NUM_QUERIES; i++) {
+        int id = (i * 37) % NUM_ROWS;
+        char sql[100];
+        snprintf(sql, sizeof(sql), "select * from sessions where id = %d;", id);
+        *wrong += countQuery(sql) != 1;
+
+        if (i % 20 == 0) {
+            *wrong += countQuery("select * from sessions where room = 'b';") !=
+                      NUM_ROWS / 2;
+        }
+    }
+
+    return NULL;
+}
+
+void testConcurrentSelect() {
+    char create[] = "create table sessions (id int, room varstr(20));";
+    char createIndex[] = "create index on sessions (id);";
+
+    executeOperation(sqlToOperation(create));
+    executeOperation(sqlToOperation(createIndex));
+
+    for (int i = 0; i < NUM_ROWS; i++) {
+        char sql[100];
+        snprintf(sql, sizeof(sql), "insert into sessions values (%d, '%s');",
+                 i, i % 2 == 0 ? "a" : "b");
+        executeOperation(sqlToOperation(sql));
+    }
+
+    // Readers start from an empty catalog and page cache
+    closeCatalog();
+
+    pthread_t readers[NUM_READERS];
+    unsigned wrong[NUM_READERS] = {0};
+    for (int i = 0; i < NUM_READERS; i++) {
+        pthread_create(&readers[i], NULL, runQueries, &wrong[i]);
+    }
+
+    unsigned totalWrong = 0;
+    for (int i = 0; i < NUM_READERS; i++) {
+        pthread_join(readers[i], NULL);
+        totalWrong += wrong[i];
+    }
+
+    START_OUTER_TEST("Test selects sharing the catalog")
+    ASSERT_EQ(totalWrong, 0)
+    ASSERT_EQ(countQuery("select * from sessions;"), NUM_ROWS)
+    FINISH_OUTER_TEST
+    PRINT_SUMMARY
+
+    closeCatalog();
+}
@@ -0,0 +1,6 @@
+#ifndef CONCURRENTSELECT_H
+#define CONCURRENTSELECT_H
+
+void testConcurrentSelect();
+
+#endif //CONCURRENTSELECT_H
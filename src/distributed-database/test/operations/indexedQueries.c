@@ -0,0 +1,63 @@
+#include "indexedQueries.h"
+
+#include <stdio.h>
+
+#include "table/core/recordArray.h"
+#include "table/index/b+-tree.h"
+#include "table/operations/operation.h"
+#include "table/operations/sqlToOperation.h"
+#include "test-library.h"
+
+static void insertEnrolments(int start, int end) {
+    for (int i = start; i < end; i++) {
+        char sql[100];
+        snprintf(sql, sizeof(sql),
+                 "insert into enrolments values (%d, 'student%d', %d);", i,
+                 i % 50, 2000 + i % 10);
+        executeOperation(sqlToOperation(sql));
+    }
+}
+
+static size_t countQuery(char *query) {
+    char sql[200];
+    snprintf(sql, sizeof(sql), "%s", query);
+    return executeOperation(sqlToOperation(sql))->records->size;
+}
+
+void testIndexedQueries() {
+    char create[] = "create table enrolments (id int, name varstr(20), year int);";
+    char createIdIndex[] = "create index on enrolments (id);";
+    char createNameIndex[] = "create index on enrolments(name);";
+    char update[] = "update enrolments set id = 1000 where id = 10;";
+    char delete[] = "delete from enrolments where id < 50;";
+
+    executeOperation(sqlToOperation(create));
+
+    // Half of the records are indexed when the index is built, the rest as
+    // they are inserted
+    insertEnrolments(0, 300);
+    executeOperation(sqlToOperation(createIdIndex));
+    executeOperation(sqlToOperation(createNameIndex));
+    insertEnrolments(300, 600);
+
+    START_OUTER_TEST("Test queries using B+ tree indexes")
+    ASSERT_EQ(indexExists("enrolments-id"), true)
+    ASSERT_EQ(indexExists("enrolments-name"), true)
+    ASSERT_EQ(countQuery("select * from enrolments where id = 450;"), 1)
+    ASSERT_EQ(countQuery("select * from enrolments where id between 100 and 199;"), 100)
+    ASSERT_EQ(countQuery("select * from enrolments where id >= 590;"), 10)
+    ASSERT_EQ(countQuery("select * from enrolments where id < 0;"), 0)
+    ASSERT_EQ(countQuery("select * from enrolments where name = 'student7' and year > 2003;"), 12)
+    ASSERT_EQ(countQuery("select * from enrolments where name = 'student7' or id = 8;"), 13)
+
+    executeOperation(sqlToOperation(update));
+    ASSERT_EQ(countQuery("select * from enrolments where id = 10;"), 0)
+    ASSERT_EQ(countQuery("select * from enrolments where id = 1000;"), 1)
+
+    executeOperation(sqlToOperation(delete));
+    ASSERT_EQ(countQuery("select * from enrolments where id < 100;"), 50)
+    ASSERT_EQ(countQuery("select * from enrolments where id = 1000;"), 1)
+    ASSERT_EQ(countQuery("select * from enrolments where name = 'student7';"), 11)
+    FINISH_OUTER_TEST
+    PRINT_SUMMARY
+}
@@ -0,0 +1,6 @@
+#ifndef INDEXEDQUERIES_H
+#define INDEXEDQUERIES_H
+
+void testIndexedQueries();
+
+#endif //INDEXEDQUERIES_H
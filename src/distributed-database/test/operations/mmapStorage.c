@@ -0,0 +1,44 @@
+#include "mmapStorage.h"
+
+#include <stdio.h>
+
+#include "table/catalog.h"
+#include "table/core/recordArray.h"
+#include "table/operations/operation.h"
+#include "table/operations/sqlToOperation.h"
+#include "test-library.h"
+
+void testMmapStorage() {
+    TABLE_STORAGE_MODE = STORAGE_MMAP;
+
+    char create[] = "create table lectures (title varstr(50), room int);";
+    executeOperation(sqlToOperation(create));
+
+    // Spans several pages so that the mapping has to grow
+    char template[] = "insert into lectures values ('Networks', %d);";
+    for (int i = 0; i < 600; i++) {
+        char sql[100];
+        snprintf(sql, sizeof(sql), template, i);
+        executeOperation(sqlToOperation(sql));
+    }
+
+    char select1[] = "select * from lectures;";
+    QueryResult res1 = executeOperation(sqlToOperation(select1));
+
+    // Reopens tables through stdio to check the mapped writes reached disk
+    closeCatalog();
+    TABLE_STORAGE_MODE = STORAGE_STDIO;
+
+    char select2[] = "select * from lectures where room >= 300;";
+    QueryResult res2 = executeOperation(sqlToOperation(select2));
+
+    START_OUTER_TEST("Test table access through memory-mapped files")
+    ASSERT_EQ(res1->records->size, 600)
+    ASSERT_EQ(res1->records->records[599]->fields[1].intValue, 599)
+    ASSERT_EQ(res2->records->size, 300)
+    ASSERT_STR_EQ(res2->records->records[0]->fields[0].stringValue, "Networks")
+    FINISH_OUTER_TEST
+    PRINT_SUMMARY
+
+    closeCatalog();
+}
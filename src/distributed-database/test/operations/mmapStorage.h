@@ -0,0 +1,6 @@
+#ifndef MMAPSTORAGE_H
+#define MMAPSTORAGE_H
+
+void testMmapStorage();
+
+#endif //MMAPSTORAGE_H
@@ -0,0 +1,37 @@
+#include "recreateTable.h"
+
+#include "table/core/recordArray.h"
+#include "table/operations/operation.h"
+#include "table/operations/sqlToOperation.h"
+#include "test-library.h"
+
+void testRecreateTable() {
+    char create1[] = "create table courses (name varstr(20), credits int);";
+    char insert1[] = "insert into courses values ('Databases', 10);";
+    char create2[] = "create table courses (name varstr(20), credits int, core bool);";
+    char insert2[] = "insert into courses values ('Compilers', 5, true);";
+    char select1[] = "select * from courses;";
+    char select2[] = "select * from courses;";
+    char select3[] = "select * from courses;";
+
+    executeOperation(sqlToOperation(create1));
+    executeOperation(sqlToOperation(insert1));
+    QueryResult res1 = executeOperation(sqlToOperation(select1));
+
+    // Cached handles and schema must not outlive the original table
+    executeOperation(sqlToOperation(create2));
+    QueryResult res2 = executeOperation(sqlToOperation(select2));
+    executeOperation(sqlToOperation(insert2));
+    QueryResult res3 = executeOperation(sqlToOperation(select3));
+
+    START_OUTER_TEST("Test recreation of a table invalidates cached handles")
+    ASSERT_EQ(res1->records->size, 1)
+    ASSERT_EQ(res1->records->records[0]->numValues, 2)
+    ASSERT_EQ(res2->records->size, 0)
+    ASSERT_EQ(res3->records->size, 1)
+    ASSERT_EQ(res3->records->records[0]->numValues, 3)
+    ASSERT_STR_EQ(res3->records->records[0]->fields[0].stringValue, "Compilers")
+    ASSERT_EQ(res3->records->records[0]->fields[2].boolValue, true)
+    FINISH_OUTER_TEST
+    PRINT_SUMMARY
+}
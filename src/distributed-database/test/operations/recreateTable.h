@@ -0,0 +1,6 @@
+#ifndef RECREATETABLE_H
+#define RECREATETABLE_H
+
+void testRecreateTable();
+
+#endif //RECREATETABLE_H
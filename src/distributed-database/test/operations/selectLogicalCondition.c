@@ -0,0 +1,54 @@
+#include "selectLogicalCondition.h"
+
+#include "table/core/field.h"
+#include "table/core/recordArray.h"
+#include "table/core/table.h"
+#include "table/operations/select.h"
+#include "table/operations/sqlToOperation.h"
+#include "table/schema.h"
+#include "test-library.h"
+#include "test/table/multiplePageDummy.h"
+
+#define CREATE_ATTR(schema, idx, name_, type_, size_, loc_) \
+    do {                                                    \
+        schema->attrInfos[idx].name = name_;                \
+        schema->attrInfos[idx].type = type_;                \
+        schema->attrInfos[idx].size = size_;                \
+        schema->attrInfos[idx].loc = loc_;                  \
+    } while (0)
+
+void testSelectLogicalCondition() {
+    createMultiplePageDummy();
+
+    Schema schema;
+
+    schema.numAttrs = 7;
+    schema.attrInfos = malloc(sizeof(AttrInfo) * schema.numAttrs);
+
+    Schema *s = &schema;
+    CREATE_ATTR(s, 0, "id", INT, INT_WIDTH, 0);
+    CREATE_ATTR(s, 1, "age", INT, INT_WIDTH, INT_WIDTH);
+    CREATE_ATTR(s, 2, "height", FLOAT, FLOAT_WIDTH, INT_WIDTH * 2);
+    CREATE_ATTR(s, 3, "student", BOOL, BOOL_WIDTH, INT_WIDTH * 2 + FLOAT_WIDTH);
+    CREATE_ATTR(s, 4, "num", INT, INT_WIDTH, INT_WIDTH * 2 + FLOAT_WIDTH + BOOL_WIDTH);
+    CREATE_ATTR(s, 5, "email", VARSTR, 50, 0);
+    CREATE_ATTR(s, 6, "name", VARSTR, 50, 1);
+
+    TableInfo table = openTable("testdb");
+
+    char conjunctionSql[] = "select id from testdb where (id < 10 or id >= 490) and not id = 5 and name = 'Dinu';";
+    QueryResult conjunction = selectOperation(table, &schema, sqlToOperation(conjunctionSql));
+
+    char disjunctionSql[] = "select id from testdb where id = 300 or not (id > 1) or not student;";
+    QueryResult disjunction = selectOperation(table, &schema, sqlToOperation(disjunctionSql));
+
+    START_OUTER_TEST("Test selecting with AND, OR and NOT conditions")
+    ASSERT_EQ(conjunction->records->size, 19)
+    ASSERT_EQ(conjunction->records->records[0]->fields[0].intValue, 0)
+    ASSERT_EQ(conjunction->records->records[5]->fields[0].intValue, 6)
+    ASSERT_EQ(conjunction->records->records[18]->fields[0].intValue, 499)
+    ASSERT_EQ(disjunction->records->size, 3)
+    ASSERT_EQ(disjunction->records->records[2]->fields[0].intValue, 300)
+    FINISH_OUTER_TEST
+    PRINT_SUMMARY
+}
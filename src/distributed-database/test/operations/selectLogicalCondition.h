@@ -0,0 +1,6 @@
+#ifndef SELECTLOGICALCONDITION_H
+#define SELECTLOGICALCONDITION_H
+
+void testSelectLogicalCondition();
+
+#endif //SELECTLOGICALCONDITION_H
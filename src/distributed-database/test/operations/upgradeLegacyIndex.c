@@ -0,0 +1,55 @@
+#include "upgradeLegacyIndex.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "table/catalog.h"
+#include "table/core/recordArray.h"
+#include "table/index/b+-tree.h"
+#include "table/operations/operation.h"
+#include "table/operations/sqlToOperation.h"
+#include "test-library.h"
+
+static size_t countQuery(char *query) {
+    char sql[200];
+    snprintf(sql, sizeof(sql), "%s", query);
+    return executeOperation(sqlToOperation(sql))->records->size;
+}
+
+static void clearIndexMagic(char *indexName) {
+    char path[MAX_FILE_NAME_LEN];
+    snprintf(path, sizeof(path), "%s/%s-index.idx", DB_BASE_DIRECTORY,
+             indexName);
+
+    // Files written before the format was versioned start with the root id
+    FILE *file = fopen(path, "rb+");
+    uint32_t magic = 0;
+    fwrite(&magic, sizeof(magic), 1, file);
+    fclose(file);
+}
+
+void testUpgradeLegacyIndex() {
+    char create[] = "create table modules (id int, title varstr(20));";
+    char createIndex[] = "create index on modules (id);";
+
+    executeOperation(sqlToOperation(create));
+    for (int i = 0; i < 200; i++) {
+        char sql[100];
+        snprintf(sql, sizeof(sql),
+                 "insert into modules values (%d, 'module%d');", i, i);
+        executeOperation(sqlToOperation(sql));
+    }
+    executeOperation(sqlToOperation(createIndex));
+
+    // Closes the index so that it is reopened from the file
+    closeCatalog();
+    clearIndexMagic("modules-id");
+
+    START_OUTER_TEST("Test rebuilding of index files in an older format")
+    ASSERT_EQ(getIndexVersion("modules-id"), 0)
+    ASSERT_EQ(countQuery("select * from modules where id = 150;"), 1)
+    ASSERT_EQ(countQuery("select * from modules where id between 20 and 69;"), 50)
+    ASSERT_EQ(getIndexVersion("modules-id"), INDEX_FORMAT_VERSION)
+    FINISH_OUTER_TEST
+    PRINT_SUMMARY
+}
@@ -0,0 +1,6 @@
+#ifndef UPGRADELEGACYINDEX_H
+#define UPGRADELEGACYINDEX_H
+
+void testUpgradeLegacyIndex();
+
+#endif //UPGRADELEGACYINDEX_H
@@ -0,0 +1,70 @@
+#include "walRecovery.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "table/core/recordArray.h"
+#include "table/core/wal.h"
+#include "table/index/b+-tree.h"
+#include "table/operations/operation.h"
+#include "table/operations/sqlToOperation.h"
+#include "test-library.h"
+
+#define NUM_ROWS 300
+
+static size_t countQuery(char *query) {
+    char sql[200];
+    snprintf(sql, sizeof(sql), "%s", query);
+    return executeOperation(sqlToOperation(sql))->records->size;
+}
+
+static void applyEntries(void) {
+    char create[] = "create table enrolments (id int, student varstr(20));";
+    char createIndex[] = "create index on enrolments (id);";
+
+    applyOperation(sqlToOperation(create), 0);
+    applyOperation(sqlToOperation(createIndex), 1);
+
+    for (int i = 0; i < NUM_ROWS; i++) {
+        char sql[100];
+        snprintf(sql, sizeof(sql),
+                 "insert into enrolments values (%d, 'student%d');", i, i);
+        applyOperation(sqlToOperation(sql), i + 2);
+    }
+}
+
+static void tearWal(void) {
+    char path[MAX_FILE_NAME_LEN];
+    snprintf(path, sizeof(path), "%s/wal.log", DB_BASE_DIRECTORY);
+
+    // Record cut short while being appended when the process died
+    FILE *file = fopen(path, "ab");
+    uint8_t torn[] = {0x40, 0x00, 0x00, 0x00, 0x12, 0x34, 0x56};
+    fwrite(torn, sizeof(uint8_t), sizeof(torn), file);
+    fclose(file);
+}
+
+void testWalRecovery() {
+    // Child exits without writing back cached pages or closing tables, as if
+    // it had crashed after committing every entry
+    pid_t pid = fork();
+    if (pid == 0) {
+        applyEntries();
+        _exit(0);
+    }
+    waitpid(pid, NULL, 0);
+
+    tearWal();
+    int appliedIndex = recoverTables(NO_LOG_INDEX);
+
+    START_OUTER_TEST("Test recovery of tables from the write-ahead log")
+    ASSERT_EQ(appliedIndex, NUM_ROWS + 1)
+    ASSERT_EQ(countQuery("select * from enrolments;"), NUM_ROWS)
+    ASSERT_EQ(countQuery("select * from enrolments where id = 299;"), 1)
+    ASSERT_EQ(countQuery("select * from enrolments where id between 50 and 99;"), 50)
+    ASSERT_EQ(getIndexVersion("enrolments-id"), INDEX_FORMAT_VERSION)
+    FINISH_OUTER_TEST
+    PRINT_SUMMARY
+}
@@ -0,0 +1,6 @@
+#ifndef WALRECOVERY_H
+#define WALRECOVERY_H
+
+void testWalRecovery();
+
+#endif //WALRECOVERY_H
@@ -0,0 +1,68 @@
+#include "logStoreSegmentRoll.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "raft/log-entry.h"
+#include "raft/log-store.h"
+#include "raft/log-table.h"
+#include "raft/persistent-store.h"
+#include "table/operations/sqlToOperation.h"
+#include "test-library.h"
+
+#define NODE_ID 7
+#define NUM_ENTRIES 6000
+#define NAME_LENGTH 900
+#define LOG_DIRECTORY "raft-db/7/log"
+
+static void removeLogDirectory(void) {
+    DIR *dir = opendir(LOG_DIRECTORY);
+    if (dir == NULL) return;
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') continue;
+
+        char path[300];
+        snprintf(path, sizeof(path), "%s/%s", LOG_DIRECTORY, entry->d_name);
+        unlink(path);
+    }
+    closedir(dir);
+}
+
+void testLogStoreSegmentRoll() {
+    mkdir("raft-db", 0755);
+    mkdir("raft-db/7", 0755);
+    removeLogDirectory();
+
+    initFilePaths(NODE_ID);
+    setLogSyncPolicy(LOG_SYNC_BATCH, DEFAULT_LOG_SYNC_INTERVAL_MS);
+    LogTable l = createLogTable();
+
+    char name[NAME_LENGTH + 1];
+    memset(name, 'x', NAME_LENGTH);
+    name[NAME_LENGTH] = '\0';
+
+    // Batch is larger than a segment, so the store rolls part way through it
+    LogEntry entries[NUM_ENTRIES];
+    for (int i = 0; i < NUM_ENTRIES; i++) {
+        char sql[NAME_LENGTH + 100];
+        snprintf(sql, sizeof(sql), "insert into students values (%d, '%s');",
+                 i, name);
+        entries[i] = createLogEntry(1, i, sqlToOperation(sql));
+    }
+
+    LogStoreStats before = getLogStoreStats();
+    logTablePushBatch(l, entries, NUM_ENTRIES);
+    LogStoreStats after = getLogStoreStats();
+
+    START_OUTER_TEST("Test segment is synced before the log store rolls")
+    ASSERT_EQ(logTableLength(l), NUM_ENTRIES)
+    ASSERT_EQ(after.rolls - before.rolls, 2)
+    ASSERT_EQ(after.syncs - before.syncs, 2)
+    FINISH_OUTER_TEST
+    PRINT_SUMMARY
+}
@@ -0,0 +1,6 @@
+#ifndef LOGSTORESEGMENTROLL_H
+#define LOGSTORESEGMENTROLL_H
+
+void testLogStoreSegmentRoll();
+
+#endif //LOGSTORESEGMENTROLL_H
@@ -0,0 +1,35 @@
+#include "selectNestedCondition.h"
+
+#include "table/operations/operation.h"
+#include "table/operations/sqlToOperation.h"
+#include "test-library.h"
+
+void testSelectNestedCondition() {
+    char sql[] = "select name from students where age > 18 and (name = 'Dinu' or not student) and not (age between 20 and 30);";
+
+    Operation operation = sqlToOperation(sql);
+    Condition condition = operation->query.select.condition;
+
+    START_OUTER_TEST("Test select with nested logical condition")
+    ASSERT_EQ(condition->type, AND)
+    ASSERT_EQ(condition->value.binary.left->type, GREATER_THAN)
+    ASSERT_STR_EQ(condition->value.binary.left->value.twoArg.op1->value.strOp, "age")
+
+    Condition rest = condition->value.binary.right;
+    ASSERT_EQ(rest->type, AND)
+
+    Condition disjunction = rest->value.binary.left;
+    ASSERT_EQ(disjunction->type, OR)
+    ASSERT_EQ(disjunction->value.binary.left->type, EQUALS)
+    ASSERT_STR_EQ(disjunction->value.binary.left->value.twoArg.op2->value.strOp, "Dinu")
+    ASSERT_EQ(disjunction->value.binary.right->type, NOT)
+    ASSERT_STR_EQ(disjunction->value.binary.right->value.oneArg.op1->value.strOp, "student")
+
+    Condition negation = rest->value.binary.right;
+    ASSERT_EQ(negation->type, NOT)
+    ASSERT_EQ(negation->value.oneArg.op1, NULL)
+    ASSERT_EQ(negation->value.oneArg.child->type, BETWEEN)
+    ASSERT_EQ(negation->value.oneArg.child->value.between.op3->value.intOp, 30)
+    FINISH_OUTER_TEST
+    PRINT_SUMMARY
+}
@@ -0,0 +1,6 @@
+#ifndef SELECTNESTEDCONDITION_H
+#define SELECTNESTEDCONDITION_H
+
+void testSelectNestedCondition();
+
+#endif //SELECTNESTEDCONDITION_H
@@ -0,0 +1,39 @@
+#include "bufferPoolHitRate.h"
+
+#include "multiplePageDummy.h"
+#include "table/core/bufferPool.h"
+#include "table/core/record.h"
+#include "table/core/table.h"
+#include "test-library.h"
+
+static unsigned countRecords(TableInfo table) {
+    struct RecordIterator iterator;
+    initialiseRecordIterator(&iterator);
+    unsigned numRecords = 0;
+
+    while (iterateRecords(table, &iterator, true)) {
+        numRecords++;
+    }
+
+    return numRecords;
+}
+
+void testBufferPoolHitRate() {
+    createMultiplePageDummy();
+
+    TableInfo table = openTable("testdb");
+
+    START_OUTER_TEST("Test repeated scans are served from the buffer pool")
+    ASSERT_EQ(countRecords(table), 500);
+    BufferPoolStats first = getBufferPoolStats();
+
+    ASSERT_EQ(countRecords(table), 500);
+    BufferPoolStats second = getBufferPoolStats();
+
+    ASSERT_EQ(second.misses, first.misses);
+    ASSERT_EQ(second.hits - first.hits, table->header->numPages);
+    FINISH_OUTER_TEST
+    PRINT_SUMMARY
+
+    closeTable(table);
+}
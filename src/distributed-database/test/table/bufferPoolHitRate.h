@@ -0,0 +1,6 @@
+#ifndef BUFFERPOOLHITRATE_H
+#define BUFFERPOOLHITRATE_H
+
+void testBufferPoolHitRate();
+
+#endif //BUFFERPOOLHITRATE_H
@@ -0,0 +1,39 @@
+#include "freeSpaceMapPersist.h"
+
+#include "table/core/freeSpaceMap.h"
+#include "table/core/table.h"
+#include "test-library.h"
+
+void testFreeSpaceMapPersist() {
+    initialiseTable("testdb-space-inventory");
+    TableInfo spaceInfo = openTable("testdb-space-inventory");
+
+    // Spans several segment tree resizes
+    for (int i = 1; i <= 200; i++) {
+        setPageFreeSpace(spaceInfo, i, i % 50);
+    }
+
+    START_OUTER_TEST("Test lookup and persistence of free space map")
+    ASSERT_EQ(findFreePage(spaceInfo, 49), 49);
+    ASSERT_EQ(findFreePage(spaceInfo, 50), NO_FREE_PAGE);
+
+    setPageFreeSpace(spaceInfo, 120, 1000);
+    ASSERT_EQ(findFreePage(spaceInfo, 50), 120);
+    closeTable(spaceInfo);
+
+    spaceInfo = openTable("testdb-space-inventory");
+    ASSERT_EQ(findFreePage(spaceInfo, 49), 49);
+    ASSERT_EQ(findFreePage(spaceInfo, 50), 120);
+
+    // Updates existing inventory record in place
+    setPageFreeSpace(spaceInfo, 49, 0);
+    closeTable(spaceInfo);
+
+    spaceInfo = openTable("testdb-space-inventory");
+    ASSERT_EQ(findFreePage(spaceInfo, 49), 99);
+    ASSERT_EQ(spaceInfo->header->globalIdx, 200);
+    FINISH_OUTER_TEST
+    PRINT_SUMMARY
+
+    closeTable(spaceInfo);
+}
@@ -0,0 +1,6 @@
+#ifndef FREESPACEMAPPERSIST_H
+#define FREESPACEMAPPERSIST_H
+
+void testFreeSpaceMapPersist();
+
+#endif //FREESPACEMAPPERSIST_H
@@ -0,0 +1,85 @@
+#include "recordView.h"
+
+#include <string.h>
+
+#include "singlePageDummy.h"
+#include "table/conditions.h"
+#include "table/core/field.h"
+#include "table/core/record.h"
+#include "table/core/table.h"
+#include "table/operations/sqlToOperation.h"
+#include "test-library.h"
+
+#define ATTR_CREATE(schema, idx, name_, type_, size_, loc_) \
+    do {                                                    \
+        schema->attrInfos[idx].name = name_;                \
+        schema->attrInfos[idx].type = type_;                \
+        schema->attrInfos[idx].size = size_;                \
+        schema->attrInfos[idx].loc = loc_;                  \
+    } while (0)
+
+static bool matches(RecordView *view, Schema *schema, char *sql) {
+    ConditionPlan plan = compileCondition(sqlToOperation(sql)->query.select.condition, schema);
+    bool res = evaluate(plan, view);
+    freeConditionPlan(plan);
+    return res;
+}
+
+void testRecordView() {
+    createSinglePageDummy();
+
+    Schema schema;
+
+    schema.numAttrs = 7;
+    schema.attrInfos = malloc(sizeof(AttrInfo) * schema.numAttrs);
+
+    Schema *s = &schema;
+    ATTR_CREATE(s, 0, "id", INT, INT_WIDTH, 0);
+    ATTR_CREATE(s, 1, "age", INT, INT_WIDTH, INT_WIDTH);
+    ATTR_CREATE(s, 2, "height", FLOAT, FLOAT_WIDTH, INT_WIDTH * 2);
+    ATTR_CREATE(s, 3, "student", BOOL, BOOL_WIDTH, INT_WIDTH * 2 + FLOAT_WIDTH);
+    ATTR_CREATE(s, 4, "num", INT, INT_WIDTH, INT_WIDTH * 2 + FLOAT_WIDTH + BOOL_WIDTH);
+    ATTR_CREATE(s, 5, "email", VARSTR, 50, 0);
+    ATTR_CREATE(s, 6, "name", VARSTR, 50, 1);
+
+    TableInfo table = openTable("testdb");
+    Page page = getPage(table, 1);
+    RecordView view = getRecordView(page->ptr + page->header->slots.slots[7].offset, &schema);
+
+    char select1[] = "select * from testdb where id = 7;";
+    char select2[] = "select * from testdb where name = 'Dinu';";
+    char select3[] = "select * from testdb where height > 200.0;";
+    char select4[] = "select * from testdb where email < 'e';";
+    char select5[] = "select * from testdb where id between 5 and 6;";
+    char select6[] = "select * from testdb where missing = 7;";
+
+    START_OUTER_TEST("Test reading fields in place through a record view")
+    unsigned size;
+    int32_t id;
+    memcpy(&id, getViewField(&view, 0, &size), INT_WIDTH);
+    ASSERT_EQ(id, 7)
+    ASSERT_EQ(size, INT_WIDTH)
+
+    uint8_t *email = getViewField(&view, 5, &size);
+    ASSERT_EQ(size, 25)
+    ASSERT_EQ(memcmp(email, "dinu.filip.self@gmail.com", size), 0)
+
+    ASSERT_EQ(matches(&view, &schema, select1), true)
+    ASSERT_EQ(matches(&view, &schema, select2), true)
+    ASSERT_EQ(matches(&view, &schema, select3), false)
+    ASSERT_EQ(matches(&view, &schema, select4), true)
+    ASSERT_EQ(matches(&view, &schema, select5), false)
+    ASSERT_EQ(matches(&view, &schema, select6), false)
+    ASSERT_EQ(evaluate(NULL, &view), true)
+
+    Record record = materialiseRecord(&view);
+    ASSERT_EQ(record->fields[4].intValue, -10)
+    ASSERT_STR_EQ(record->fields[6].stringValue, "Dinu")
+    FINISH_OUTER_TEST
+    PRINT_SUMMARY
+
+    freeRecord(record);
+    freePage(page);
+    closeTable(table);
+    free(schema.attrInfos);
+}
@@ -0,0 +1,6 @@
+#ifndef RECORDVIEW_H
+#define RECORDVIEW_H
+
+void testRecordView();
+
+#endif //RECORDVIEW_H